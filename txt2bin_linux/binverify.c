@@ -0,0 +1,303 @@
+#define _GNU_SOURCE				//nftw
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "libtxt2bin.h"
+
+#define WORKER_MAX				64
+#define BIN_EXT					".bin"
+#define NFTW_FD_MAX				32
+#define KEY_MAX					2				//每种SigType一个公钥
+
+//一个bin文件的校验任务
+typedef struct
+{
+	char *path;
+	int code;							//txt2bin_verify_code，-1为无法读取
+	txt2bin_result_t result;
+	char submodel[POWER_CHIP_MODEL_INFO_LEN + 1];
+	char msg[TXT2BIN_ERR_MSG_LEN];
+}verify_job_t;
+
+static txt2bin_key_t *g_keys[KEY_MAX];	//只读取一次公钥，所有线程共用，下标为SigType
+static verify_job_t *g_jobs = NULL;
+static int g_job_count = 0;
+static int g_job_size = 0;
+static int g_job_next = 0;				//下一个待校验的任务，工作线程原子地领取
+
+static int add_job(const char *path)
+{
+	verify_job_t *jobs;
+
+	if(g_job_count == g_job_size)
+	{
+		g_job_size = g_job_size ? g_job_size * 2 : 256;
+		jobs = realloc(g_jobs, sizeof(verify_job_t) * g_job_size);
+		if(NULL == jobs)
+			return -1;
+		g_jobs = jobs;
+	}
+	memset(&g_jobs[g_job_count], 0, sizeof(verify_job_t));
+	g_jobs[g_job_count].path = strdup(path);
+	g_jobs[g_job_count].code = -1;
+	if(NULL == g_jobs[g_job_count].path)
+		return -1;
+	g_job_count++;
+	return 0;
+}
+
+//目录中扩展名为.bin的普通文件都需要校验
+static int walk_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+	size_t len = strlen(path);
+
+	(void)st;
+	(void)ftw;
+	if(FTW_F != type || len <= strlen(BIN_EXT) || 0 != strcmp(path + len - strlen(BIN_EXT), BIN_EXT))
+		return 0;
+	return add_job(path);
+}
+
+static int job_cmp(const void *a, const void *b)
+{
+	return strcmp(((const verify_job_t *)a)->path, ((const verify_job_t *)b)->path);
+}
+
+static void verify_one(verify_job_t *job)
+{
+	const power_chip_hd_t *head;
+	txt2bin_key_t *key = NULL;
+	struct stat st;
+	txt2bin_err_t err;
+	uint8_t *map;
+	int fd;
+
+	fd = open(job->path, O_RDONLY);
+	if(fd < 0)
+	{
+		snprintf(job->msg, sizeof(job->msg), "open fail");
+		return;
+	}
+	if(0 != fstat(fd, &st) || 0 == st.st_size)
+	{
+		close(fd);
+		job->code = TXT2BIN_VERIFY_SIZE_INVALID;
+		snprintf(job->msg, sizeof(job->msg), "file is empty");
+		return;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(MAP_FAILED == map)
+	{
+		snprintf(job->msg, sizeof(job->msg), "mmap fail");
+		return;
+	}
+
+	//按镜像头的SigType选择公钥，镜像头不完整时由txt2bin_verify报告大小错误
+	head = (const power_chip_hd_t *)map;
+	if((size_t)st.st_size >= sizeof(power_chip_hd_t))
+	{
+		memcpy(job->submodel, head->SubModel, POWER_CHIP_MODEL_INFO_LEN);
+		if(head->SigType < KEY_MAX)
+			key = g_keys[head->SigType];
+	}
+	memset(&err, 0, sizeof(err));
+	job->code = txt2bin_verify(key, map, st.st_size, &job->result, &err);
+	if(TXT2BIN_VERIFY_OK != job->code)
+		snprintf(job->msg, sizeof(job->msg), "%s", err.msg);
+	munmap(map, st.st_size);
+}
+
+static void *verify_worker(void *arg)
+{
+	int i;
+
+	(void)arg;
+	while((i = __sync_fetch_and_add(&g_job_next, 1)) < g_job_count)
+		verify_one(&g_jobs[i]);
+	return NULL;
+}
+
+//输出JSON字符串，转义引号、反斜杠和控制字符
+static void json_str(FILE *fp, const char *s)
+{
+	fputc('"', fp);
+	for(; *s; s++)
+	{
+		if('"' == *s || '\\' == *s)
+			fprintf(fp, "\\%c", *s);
+		else if((unsigned char)*s < 0x20)
+			fprintf(fp, "\\u%04x", (unsigned char)*s);
+		else
+			fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+//报告每行一个JSON对象，按输入顺序输出
+static void report_job(FILE *fp, verify_job_t *job)
+{
+	int i;
+
+	fprintf(fp, "{\"file\":");
+	json_str(fp, job->path);
+	fprintf(fp, ",\"ok\":%s,\"code\":", TXT2BIN_VERIFY_OK == job->code ? "true" : "false");
+	json_str(fp, job->code < 0 ? "CC_ERR_FILE_READ" : txt2bin_verify_name(job->code));
+	fprintf(fp, ",\"size\":%zu,\"submodel\":", job->result.bin_len);
+	json_str(fp, job->submodel);
+	fprintf(fp, ",\"img_type\":%u,\"base_fw_rev\":%u,\"sig_type\":%u", job->result.img_type, job->result.base_fw_rev, job->result.sig_type);
+	if(POWER_IMG_TYPE_DELTA == job->result.img_type)
+	{
+		fprintf(fp, ",\"base_digest\":\"");
+		for(i = 0; i < POWER_BASE_DIGEST_SIZE; i++)
+			fprintf(fp, "%02x", job->result.base_digest[i]);
+		fprintf(fp, "\",\"base_masks\":%u", job->result.base_mask_size);
+	}
+	fprintf(fp, ",\"fw_rev\":%u,\"images\":%u,\"registers\":%u,\"img_crc\":\"%08X\",\"hdr_crc\":\"%08X\",\"msg\":",
+		job->result.fw_rev, job->result.image_count, job->result.register_num, job->result.img_crc, job->result.hdr_crc);
+	json_str(fp, job->msg);
+	fprintf(fp, "}\n");
+}
+
+static void keys_free(void)
+{
+	int i;
+
+	for(i = 0; i < KEY_MAX; i++)
+		txt2bin_key_free(g_keys[i]);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-j jobs] [-p public_key] [-r report] path...\n", prog);
+	printf("  -j jobs         number of worker threads, default is the number of cpus\n");
+	printf("  -p public_key   public key, default is %s, give twice for both RSA and Ed25519 keys\n", PUBLIC_KEY_PATH);
+	printf("  -r report       write report to file, default is stdout\n");
+	printf("path is a bin file or a directory, %s files in directories are verified recursively.\n", BIN_EXT);
+	printf("Bins are verified with the same rules as the BMC, report has one JSON object per line.\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, i, first, worker_count = 0, fail_count = 0, key_count = 0, type;
+	char *public_path[KEY_MAX] = {PUBLIC_KEY_PATH}, *report = NULL;
+	txt2bin_key_t *key;
+	pthread_t workers[WORKER_MAX];
+	struct stat st;
+	txt2bin_err_t err;
+	FILE *fp = stdout;
+
+	while(-1 != (opt = getopt(argc, argv, "j:p:r:h")))
+	{
+		switch(opt)
+		{
+		case 'j':
+			worker_count = atoi(optarg);
+			break;
+		case 'p':
+			if(key_count >= KEY_MAX)
+			{
+				usage(argv[0]);
+				return -1;
+			}
+			public_path[key_count++] = optarg;
+			break;
+		case 'r':
+			report = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	if(optind >= argc)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+
+	for(i = optind; i < argc; i++)
+	{
+		if(0 == stat(argv[i], &st) && S_ISDIR(st.st_mode))
+		{
+			first = g_job_count;
+			if(0 != nftw(argv[i], walk_entry, NFTW_FD_MAX, FTW_PHYS))
+			{
+				fprintf(stderr, "Walk %s fail.\n", argv[i]);
+				return -1;
+			}
+			//目录中的文件按路径排序，同一个归档每次生成的报告顺序相同
+			qsort(g_jobs + first, g_job_count - first, sizeof(verify_job_t), job_cmp);
+		}
+		else if(0 != add_job(argv[i]))
+			return -1;
+	}
+
+	if(0 == key_count)
+		key_count = 1;
+	for(i = 0; i < key_count; i++)
+	{
+		memset(&err, 0, sizeof(err));
+		key = txt2bin_key_load_public(public_path[i], &err);
+		if(NULL == key)
+		{
+			fprintf(stderr, "Load public key %s fail, %s.\n", public_path[i], err.msg);
+			keys_free();
+			return -1;
+		}
+		type = txt2bin_key_sig_type(key);
+		if(NULL != g_keys[type])
+		{
+			fprintf(stderr, "Public key %s has the same type as the previous one.\n", public_path[i]);
+			txt2bin_key_free(key);
+			keys_free();
+			return -1;
+		}
+		g_keys[type] = key;
+	}
+
+	if(worker_count <= 0)
+		worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+	if(worker_count > g_job_count)
+		worker_count = g_job_count;
+	if(worker_count > WORKER_MAX)
+		worker_count = WORKER_MAX;
+	for(i = 0; i < worker_count; i++)
+	{
+		if(0 != pthread_create(&workers[i], NULL, verify_worker, NULL))
+			break;
+	}
+	//线程创建失败时由主线程完成剩余任务
+	worker_count = i;
+	verify_worker(NULL);
+	for(i = 0; i < worker_count; i++)
+		pthread_join(workers[i], NULL);
+
+	if(NULL != report)
+	{
+		fp = fopen(report, "w");
+		if(NULL == fp)
+		{
+			fprintf(stderr, "Create report %s fail.\n", report);
+			keys_free();
+			return -1;
+		}
+	}
+	for(i = 0; i < g_job_count; i++)
+	{
+		report_job(fp, &g_jobs[i]);
+		if(TXT2BIN_VERIFY_OK != g_jobs[i].code)
+			fail_count++;
+	}
+	if(stdout != fp)
+		fclose(fp);
+	fprintf(stderr, "%d verified, %d passed, %d failed\n", g_job_count, g_job_count - fail_count, fail_count);
+	keys_free();
+	return fail_count ? 1 : 0;
+}
@@ -0,0 +1,929 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/bio.h>
+#include "libtxt2bin.h"
+
+struct txt2bin_key
+{
+	EVP_PKEY *private_key;
+	EVP_PKEY *public_key;
+	int sig_type;					//POWER_SIG_TYPE_RSA1024或POWER_SIG_TYPE_ED25519
+};
+
+typedef struct
+{
+	uint16_t start;
+	uint16_t end;
+}power_section_t;
+
+//与BMC中irps5401_sec的地址范围和顺序一致，差分镜像的基线摘要按该顺序计算
+static const power_section_t power_sec[] = {
+	{0x0000, 0x0001}, {0x0020, 0x003B}, {0x0420, 0x042B}, {0x0600, 0x06FF},
+	{0x0700, 0x07FF}, {0x0820, 0x082B}, {0x0A00, 0x0AFF}, {0x0B00, 0x0BFF},
+	{0x0C20, 0x0C2B}, {0x0E00, 0x0EFF}, {0x0F00, 0x0FFF}, {0x1020, 0x102B},
+	{0x1200, 0x12FF}, {0x1300, 0x13FF}, {0x1420, 0x1421}, {0x1600, 0x16FF},
+	{0x1700, 0x17FF},
+};
+
+//与BMC中的verify_ignored_reg一致，这些寄存器的值不固定，不计入基线摘要
+static const uint16_t digest_ignored_reg[] = {0x16F9, 0x16FB, 0x16FD, 0x17B0, 0x17BC};
+
+static const unsigned long CrcLookUpTable[256] =
+{
+	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
+	0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+	0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
+	0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE,
+	0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,
+	0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
+	0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+	0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940,
+	0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116,
+	0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+	0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
+	0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+
+	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A,
+	0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818,
+	0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
+	0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+	0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C,
+	0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2,
+	0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+	0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
+	0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086,
+	0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4,
+	0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+
+	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
+	0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+	0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8,
+	0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE,
+	0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+	0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
+	0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252,
+	0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60,
+	0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
+	0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+	0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04,
+	0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+
+	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A,
+	0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+	0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
+	0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E,
+	0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C,
+	0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
+	0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+	0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0,
+	0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6,
+	0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+	0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
+	0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
+};
+
+unsigned int CalculateCRC32(unsigned char *Buffer, unsigned int Size)
+{
+	unsigned int i,crc32 = 0xFFFFFFFF;
+
+	/* Read the data and calculate crc32 */	
+	for(i = 0; i < Size; i++)
+	crc32 = ((crc32) >> 8) ^ CrcLookUpTable[(Buffer[i]) ^ ((crc32) & 0x000000FF)];
+	
+	return ~crc32;
+}
+
+static void DoCRC32(unsigned int *crc32, unsigned char Data)
+{
+	*crc32=((*crc32) >> 8) ^ CrcLookUpTable[Data ^ ((*crc32) & 0x000000FF)];
+	return;
+}
+
+static void set_err(txt2bin_err_t *err, int line, int col, const char *fmt, ...)
+{
+	va_list ap;
+
+	if(NULL == err)
+		return;
+	err->line = line;
+	err->col = col;
+	va_start(ap, fmt);
+	vsnprintf(err->msg, sizeof(err->msg), fmt, ap);
+	va_end(ap);
+}
+
+static int hex_value(char c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+//读取最多max_digits位十六进制数，前面的空格和制表符被跳过，*col随读取位置移动
+static int parse_hex(const char *line, int len, int *col, int max_digits, uint32_t *value)
+{
+	int digits = 0, v;
+
+	while(*col < len && (line[*col] == ' ' || line[*col] == '\t'))
+		(*col)++;
+	*value = 0;
+	while(*col < len && digits < max_digits && (v = hex_value(line[*col])) >= 0)
+	{
+		*value = (*value << 4) | v;
+		(*col)++;
+		digits++;
+	}
+	return digits ? 0 : -1;
+}
+
+/*
+ * 一次遍历txt内容，同时完成CRC32校验和寄存器解析：
+ * "//CRC32 : "行之后的每一行（去掉行尾的"\r\n"两个字节）参与CRC计算，与英飞凌工具生成的方式一致；
+ * 不以"//"开头的行是"寄存器 值 掩码"格式的记录，写入image。
+ * 格式错误时err中返回行号和列号。
+ */
+int txt2bin_parse(const char *txt, size_t len, uint8_t *image, uint32_t image_max, txt2bin_result_t *result, txt2bin_err_t *err)
+{
+	const char *line, *end, *next;
+	int line_len, col, line_no = 0;
+	int start_crc = 0;
+	unsigned int crc32 = 0xFFFFFFFF;
+	uint32_t reg, value, mask;
+	power_chip_data_t data;
+
+	memset(result, 0, sizeof(txt2bin_result_t));
+	if(NULL == txt || 0 == len)
+	{
+		set_err(err, 0, 0, "empty input");
+		return -1;
+	}
+
+	end = txt + len;
+	for(line = txt; line < end; line = next)
+	{
+		next = memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+		line_len = next - line;			//包含行尾的换行符
+		line_no++;
+
+		if(start_crc)
+		{
+			if(line_len < 3)
+			{
+				set_err(err, line_no, 1, "invaild line length %d", line_len);
+				return -1;
+			}
+			for(col = 0; col < line_len - 2; col++)
+				DoCRC32(&crc32, line[col]);
+		}
+		if(line_len >= 2 && 0 == memcmp(line, "//", 2))
+		{
+			if(!start_crc && line_len >= 10 && 0 == memcmp(line, "//CRC32 : ", 10))
+			{
+				start_crc = 1;
+				result->crc_expect = strtoul(&line[10], NULL, 0);
+			}
+			continue;
+		}
+
+		//去掉行尾换行符后解析记录
+		while(line_len > 0 && (line[line_len - 1] == '\n' || line[line_len - 1] == '\r'))
+			line_len--;
+		if(line_len < 6)
+		{
+			set_err(err, line_no, 1, "invaild line length %d", line_len);
+			return -1;
+		}
+		col = 0;
+		if(0 != parse_hex(line, line_len, &col, 4, &reg))
+		{
+			set_err(err, line_no, col + 1, "expect register address, got '%c'", col < line_len ? line[col] : ' ');
+			return -1;
+		}
+		if(0 != parse_hex(line, line_len, &col, 2, &value))
+		{
+			set_err(err, line_no, col + 1, "expect register value, got '%c'", col < line_len ? line[col] : ' ');
+			return -1;
+		}
+		if(0 != parse_hex(line, line_len, &col, 2, &mask))
+		{
+			set_err(err, line_no, col + 1, "expect register mask, got '%c'", col < line_len ? line[col] : ' ');
+			return -1;
+		}
+		if((result->register_num + 1) * sizeof(data) > image_max)
+		{
+			set_err(err, line_no, 1, "too many registers");
+			return -1;
+		}
+		data.reg = reg;
+		data.value = value;
+		data.mask = mask;
+		if(IRPS5401_VERSION_ADDR == data.reg)
+			result->fw_rev = data.value;
+		memcpy(image + result->register_num * sizeof(data), &data, sizeof(data));
+		result->register_num++;
+	}
+
+	if(!start_crc)
+	{
+		set_err(err, 0, 0, "no \"//CRC32 : \" line");
+		return -1;
+	}
+	result->crc_calc = ~crc32;
+	if(result->crc_expect != result->crc_calc)
+	{
+		set_err(err, 0, 0, "CRC32 verify fail, %08X vs %08X", result->crc_expect, result->crc_calc);
+		return -1;
+	}
+	return 0;
+}
+
+static void build_header(power_chip_hd_t *head, const char *submodel, uint8_t img_type, uint32_t img_size, uint8_t fw_rev, uint8_t base_fw_rev,
+						const uint8_t *base_digest, uint32_t base_mask_size, uint8_t sig_type)
+{
+	memset(head, 0, sizeof(power_chip_hd_t));
+	memcpy(&head->Signature, POWER_SIGNATURE, strlen(POWER_SIGNATURE));
+	memcpy(&head->DevModel, POWER_MODEL, strlen(POWER_MODEL));
+	memcpy(&head->SubModel, submodel, strlen(submodel));
+	head->FwRev = fw_rev;
+	head->ImgType = img_type;
+	head->BaseFwRev = base_fw_rev;
+	if(NULL != base_digest)
+		memcpy(head->BaseDigest, base_digest, POWER_BASE_DIGEST_SIZE);
+	head->BaseMaskSize = base_mask_size;
+	head->SigType = sig_type;
+	head->ImgOffset = sizeof(power_chip_hd_t);
+	head->ImgSize = img_size;
+	head->ImgCRC32 = CalculateCRC32((unsigned char *)head + sizeof(power_chip_hd_t), img_size);
+	head->sha256_sig_offset = sizeof(power_chip_hd_t) + img_size;
+	head->HdrCRC32 = CalculateCRC32((unsigned char *)head, sizeof(power_chip_hd_t) - sizeof(head->HdrCRC32));
+}
+
+//镜像头的固定内容，寄存器记录紧跟在镜像头之后，签名紧跟在寄存器记录之后，sig_type见txt2bin_key_sig_type
+void txt2bin_build_header(power_chip_hd_t *head, uint32_t img_size, uint8_t fw_rev, uint8_t sig_type)
+{
+	build_header(head, POWER_SUBMODEL, POWER_IMG_TYPE_SINGLE, img_size, fw_rev, 0, NULL, 0, sig_type);
+}
+
+//签名方式由密钥类型决定
+static int key_sig_type(EVP_PKEY *pkey)
+{
+	switch(EVP_PKEY_id(pkey))
+	{
+	case EVP_PKEY_RSA:
+		return POWER_SIG_TYPE_RSA1024;
+	case EVP_PKEY_ED25519:
+		return POWER_SIG_TYPE_ED25519;
+	default:
+		return -1;
+	}
+}
+
+static txt2bin_key_t *key_new(EVP_PKEY *private_key, EVP_PKEY *public_key, int public_only, txt2bin_err_t *err)
+{
+	txt2bin_key_t *key = NULL;
+
+	if((NULL == private_key && !public_only) || NULL == public_key)
+		set_err(err, 0, 0, "read %s key fail", (NULL == private_key && !public_only) ? "private" : "public");
+	else if(key_sig_type(public_key) < 0)
+		set_err(err, 0, 0, "key type %d is not supported", EVP_PKEY_id(public_key));
+	else if(NULL != private_key && EVP_PKEY_id(private_key) != EVP_PKEY_id(public_key))
+		set_err(err, 0, 0, "private key and public key are of different types");
+	else if(NULL == (key = calloc(1, sizeof(txt2bin_key_t))))
+		set_err(err, 0, 0, "malloc key fail");
+	if(NULL == key)
+	{
+		EVP_PKEY_free(private_key);
+		EVP_PKEY_free(public_key);
+		return NULL;
+	}
+	key->private_key = private_key;
+	key->public_key = public_key;
+	key->sig_type = key_sig_type(public_key);
+	return key;
+}
+
+// 从PEM文件中读取私钥和公钥，RSA或Ed25519
+txt2bin_key_t *txt2bin_key_load_file(const char *private_path, const char *public_path, txt2bin_err_t *err)
+{
+	EVP_PKEY *private_key = NULL, *public_key = NULL;
+	FILE *fp;
+
+	fp = fopen(private_path ? private_path : PRIVATE_KEY_PATH, "rb");
+	if(NULL != fp)
+	{
+		private_key = PEM_read_PrivateKey(fp, NULL, NULL, NULL);
+		fclose(fp);
+	}
+	fp = fopen(public_path ? public_path : PUBLIC_KEY_PATH, "rb");
+	if(NULL != fp)
+	{
+		public_key = PEM_read_PUBKEY(fp, NULL, NULL, NULL);
+		fclose(fp);
+	}
+	return key_new(private_key, public_key, 0, err);
+}
+
+// 只读取公钥，只能用于txt2bin_verify
+txt2bin_key_t *txt2bin_key_load_public(const char *public_path, txt2bin_err_t *err)
+{
+	EVP_PKEY *public_key = NULL;
+	FILE *fp;
+
+	fp = fopen(public_path ? public_path : PUBLIC_KEY_PATH, "rb");
+	if(NULL != fp)
+	{
+		public_key = PEM_read_PUBKEY(fp, NULL, NULL, NULL);
+		fclose(fp);
+	}
+	return key_new(NULL, public_key, 1, err);
+}
+
+// 从内存中的PEM内容读取私钥和公钥
+txt2bin_key_t *txt2bin_key_load_mem(const void *private_pem, size_t private_len, const void *public_pem, size_t public_len, txt2bin_err_t *err)
+{
+	EVP_PKEY *private_key = NULL, *public_key = NULL;
+	BIO *bio;
+
+	bio = BIO_new_mem_buf(private_pem, private_len);
+	if(NULL != bio)
+	{
+		private_key = PEM_read_bio_PrivateKey(bio, NULL, NULL, NULL);
+		BIO_free(bio);
+	}
+	bio = BIO_new_mem_buf(public_pem, public_len);
+	if(NULL != bio)
+	{
+		public_key = PEM_read_bio_PUBKEY(bio, NULL, NULL, NULL);
+		BIO_free(bio);
+	}
+	return key_new(private_key, public_key, 0, err);
+}
+
+void txt2bin_key_free(txt2bin_key_t *key)
+{
+	if(NULL == key)
+		return;
+	EVP_PKEY_free(key->private_key);
+	EVP_PKEY_free(key->public_key);
+	free(key);
+}
+
+// 密钥对应的镜像头SigType
+int txt2bin_key_sig_type(const txt2bin_key_t *key)
+{
+	return key ? key->sig_type : -1;
+}
+
+// SigType对应的签名长度，BMC按该长度确定签名的位置，不支持的类型返回-1
+int txt2bin_sig_size(int sig_type)
+{
+	switch(sig_type)
+	{
+	case POWER_SIG_TYPE_RSA1024:
+		return POWER_SIG_RSA1024_SIZE;
+	case POWER_SIG_TYPE_ED25519:
+		return POWER_SIG_ED25519_SIZE;
+	default:
+		return -1;
+	}
+}
+
+//RSA对数据的SHA-256摘要做PKCS#1 v1.5签名，与原来的RSA_sign(NID_sha256)结果相同；Ed25519直接对数据签名
+static const EVP_MD *key_md(const txt2bin_key_t *key)
+{
+	return POWER_SIG_TYPE_RSA1024 == key->sig_type ? EVP_sha256() : NULL;
+}
+
+static int key_verify(const txt2bin_key_t *key, const uint8_t *data, size_t len, const uint8_t *sig, size_t sig_len)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	int ok = 0;
+
+	if(NULL == ctx)
+		return 0;
+	if(1 == EVP_DigestVerifyInit(ctx, NULL, key_md(key), NULL, key->public_key))
+		ok = (1 == EVP_DigestVerify(ctx, sig, sig_len, data, len));
+	EVP_MD_CTX_free(ctx);
+	return ok;
+}
+
+// 对data签名，并用公钥验证签名，sig至少TXT2BIN_SIG_MAX字节
+int txt2bin_sign(const txt2bin_key_t *key, const uint8_t *data, size_t len, uint8_t *sig, unsigned int *sig_len, txt2bin_err_t *err)
+{
+	EVP_MD_CTX *ctx;
+	size_t out_len = TXT2BIN_SIG_MAX;
+	int ok = 0;
+
+	if(NULL == key || NULL == key->private_key)
+	{
+		set_err(err, 0, 0, "no private key");
+		return -1;
+	}
+	ctx = EVP_MD_CTX_new();
+	if(NULL != ctx && 1 == EVP_DigestSignInit(ctx, NULL, key_md(key), NULL, key->private_key))
+		ok = (1 == EVP_DigestSign(ctx, sig, &out_len, data, len));
+	EVP_MD_CTX_free(ctx);
+	if(!ok)
+	{
+		set_err(err, 0, 0, "Signature failed");
+		return -1;
+	}
+	*sig_len = out_len;
+	if(!key_verify(key, data, len, sig, out_len))
+	{
+		set_err(err, 0, 0, "Verification failed");
+		return -1;
+	}
+	return 0;
+}
+
+// 完整的转换：解析txt，生成镜像头并签名，结果写入bin，长度为result->bin_len
+int txt2bin_convert(const txt2bin_key_t *key, const char *txt, size_t len, uint8_t *bin, size_t bin_max, txt2bin_result_t *result, txt2bin_err_t *err)
+{
+	power_chip_hd_t *head = (power_chip_hd_t *)bin;
+
+	if(NULL == bin || bin_max < sizeof(power_chip_hd_t) + TXT2BIN_SIG_MAX)
+	{
+		set_err(err, 0, 0, "output buffer too small");
+		return -1;
+	}
+	if(0 != txt2bin_parse(txt, len, bin + sizeof(power_chip_hd_t), bin_max - sizeof(power_chip_hd_t) - TXT2BIN_SIG_MAX, result, err))
+		return -1;
+	txt2bin_build_header(head, result->register_num * sizeof(power_chip_data_t), result->fw_rev, key ? key->sig_type : 0);
+	result->img_crc = head->ImgCRC32;
+	result->hdr_crc = head->HdrCRC32;
+	if(0 != txt2bin_sign(key, bin, head->sha256_sig_offset, bin + head->sha256_sig_offset, &result->sig_len, err))
+		return -1;
+	result->bin_len = head->sha256_sig_offset + result->sig_len;
+	return 0;
+}
+
+/*
+ * 把mic文件拆分为多个单镜像txt：每个"//CRC32 : "行开始一个镜像，该行之前连续的"//"注释行（镜像的文件头）属于同一个镜像，
+ * 因此前一个镜像的CRC只覆盖到下一个镜像的注释行之前。第一个镜像从文件开头开始。
+ * start[i]、start_line[i]返回第i个镜像的起始位置和起始行号，返回镜像数。
+ */
+int txt2bin_mic_split(const char *txt, size_t len, size_t *start, int *start_line, int max, txt2bin_err_t *err)
+{
+	const char *line, *end, *next;
+	const char *comment = NULL;			//当前连续注释行的第一行
+	int line_no = 0, comment_line = 0, count = 0;
+
+	if(NULL == txt || 0 == len)
+	{
+		set_err(err, 0, 0, "empty input");
+		return -1;
+	}
+	end = txt + len;
+	for(line = txt; line < end; line = next)
+	{
+		next = memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+		line_no++;
+		if(next - line < 2 || 0 != memcmp(line, "//", 2))
+		{
+			comment = NULL;
+			continue;
+		}
+		if(NULL == comment)
+		{
+			comment = line;
+			comment_line = line_no;
+		}
+		if(next - line < 10 || 0 != memcmp(line, "//CRC32 : ", 10))
+			continue;
+		if(count >= max)
+		{
+			set_err(err, line_no, 1, "more than %d images", max);
+			return -1;
+		}
+		start[count] = count ? (size_t)(comment - txt) : 0;
+		start_line[count] = count ? comment_line : 1;
+		count++;
+	}
+	if(0 == count)
+	{
+		set_err(err, 0, 0, "no \"//CRC32 : \" line");
+		return -1;
+	}
+	return count;
+}
+
+// mic文件转换为多镜像容器，submodels[i]为第i个镜像对应的电源芯片，数量必须与镜像数一致
+int txt2bin_convert_mic(const txt2bin_key_t *key, const char *txt, size_t len, const char *const *submodels, int submodel_count,
+						uint8_t *bin, size_t bin_max, txt2bin_result_t *result, txt2bin_err_t *err)
+{
+	power_chip_hd_t *head = (power_chip_hd_t *)bin;
+	power_chip_mic_dir_t *dir = (power_chip_mic_dir_t *)(bin + sizeof(power_chip_hd_t));
+	power_chip_mic_entry_t *entry = (power_chip_mic_entry_t *)(dir + 1);
+	size_t start[POWER_MIC_ENTRY_MAX];
+	int start_line[POWER_MIC_ENTRY_MAX];
+	txt2bin_result_t image;
+	uint32_t offset;
+	size_t seg_end;
+	int count, i, j;
+
+	memset(result, 0, sizeof(txt2bin_result_t));
+	count = txt2bin_mic_split(txt, len, start, start_line, POWER_MIC_ENTRY_MAX, err);
+	if(count < 0)
+		return -1;
+	if(NULL == submodels || count != submodel_count)
+	{
+		set_err(err, 0, 0, "%d images but %d submodels", count, submodel_count);
+		return -1;
+	}
+	for(i = 0; i < count; i++)
+	{
+		if(0 == strlen(submodels[i]) || strlen(submodels[i]) > POWER_CHIP_MODEL_INFO_LEN)
+		{
+			set_err(err, 0, 0, "invalid submodel \"%s\"", submodels[i]);
+			return -1;
+		}
+		for(j = 0; j < i; j++)
+		{
+			if(0 == strcmp(submodels[i], submodels[j]))
+			{
+				set_err(err, 0, 0, "submodel %s is used by image %d and %d", submodels[i], j + 1, i + 1);
+				return -1;
+			}
+		}
+	}
+
+	offset = sizeof(power_chip_hd_t) + sizeof(power_chip_mic_dir_t) + count * sizeof(power_chip_mic_entry_t);
+	if(NULL == bin || bin_max < offset + TXT2BIN_SIG_MAX)
+	{
+		set_err(err, 0, 0, "output buffer too small");
+		return -1;
+	}
+	memset(bin, 0, offset);
+	dir->EntryCount = count;
+	for(i = 0; i < count; i++)
+	{
+		seg_end = (i + 1 < count) ? start[i + 1] : len;
+		if(0 != txt2bin_parse(txt + start[i], seg_end - start[i], bin + offset, bin_max - offset - TXT2BIN_SIG_MAX, &image, err))
+		{
+			//行号换算为在mic文件中的位置，与位置无关的错误（如CRC错误）加上镜像序号
+			if(err && err->line)
+				err->line += start_line[i] - 1;
+			else if(err)
+			{
+				char msg[TXT2BIN_ERR_MSG_LEN];
+
+				memcpy(msg, err->msg, sizeof(msg));
+				set_err(err, 0, 0, "image %d: %s", i + 1, msg);
+			}
+			return -1;
+		}
+		if(0 == image.register_num)
+		{
+			set_err(err, start_line[i], 1, "image %d has no register", i + 1);
+			return -1;
+		}
+		memcpy(entry[i].SubModel, submodels[i], strlen(submodels[i]));
+		entry[i].FwRev = image.fw_rev;
+		entry[i].Offset = offset;
+		entry[i].Size = image.register_num * sizeof(power_chip_data_t);
+		offset += entry[i].Size;
+		result->register_num += image.register_num;
+	}
+
+	build_header(head, POWER_MIC_SUBMODEL, POWER_IMG_TYPE_MULTI, offset - sizeof(power_chip_hd_t), 0, 0, NULL, 0, key ? key->sig_type : 0);
+	result->image_count = count;
+	result->img_crc = head->ImgCRC32;
+	result->hdr_crc = head->HdrCRC32;
+	if(0 != txt2bin_sign(key, bin, head->sha256_sig_offset, bin + head->sha256_sig_offset, &result->sig_len, err))
+		return -1;
+	result->bin_len = head->sha256_sig_offset + result->sig_len;
+	return 0;
+}
+
+static const char *verify_names[TXT2BIN_VERIFY_CODE_COUNT] =
+{
+	"CC_NORMAL",
+	"CC_FILE_SIZE_INVALID",
+	"CC_ERR_FW_IMG_HDR_CRC",
+	"CC_ERR_FW_IMG_SIGNATURE",
+	"CC_ERR_FW_IMG_MODEL",
+	"CC_FILE_CHKSUM_EER",
+	"CC_ERR_HASH_SIGNED_VERIFY",
+};
+
+/*
+ * 读取差分镜像的基线：txt文件或者txt2bin生成的单镜像bin（校验通过后使用），寄存器记录写入image。
+ * base->fw_rev为基线的固件版本，base->register_num为记录数。
+ */
+int txt2bin_base_load(const txt2bin_key_t *key, const uint8_t *data, size_t len, uint8_t *image, uint32_t image_max, txt2bin_result_t *base, txt2bin_err_t *err)
+{
+	const power_chip_hd_t *head = (const power_chip_hd_t *)data;
+	int code;
+
+	if(NULL == data || len < strlen(POWER_SIGNATURE) || 0 != memcmp(data, POWER_SIGNATURE, strlen(POWER_SIGNATURE)))
+		return txt2bin_parse((const char *)data, len, image, image_max, base, err);
+
+	code = txt2bin_verify(key, data, len, base, err);
+	if(TXT2BIN_VERIFY_OK != code)
+		return -1;
+	if(POWER_IMG_TYPE_SINGLE != head->ImgType)
+	{
+		set_err(err, 0, 0, "baseline bin is not a single image (type %u)", head->ImgType);
+		return -1;
+	}
+	if(head->ImgSize > image_max)
+	{
+		set_err(err, 0, 0, "too many registers in baseline");
+		return -1;
+	}
+	memcpy(image, data + head->ImgOffset, head->ImgSize);
+	return 0;
+}
+
+/*
+ * 差分镜像的基线摘要：对有改动记录的每个section，按power_sec的顺序取基线中该section全部地址的值与掩码（page寄存器xxFF和
+ * digest_ignored_reg除外），按位与之后计算SHA256，与BMC中PDK_PowerChipBaseDigest对从芯片读出的值计算的结果相同。
+ * 这些地址的掩码按同样的顺序写入mask，随镜像一起签名，BMC用它屏蔽芯片中不属于固件的位，*mask_len为地址数。
+ * base_index为寄存器地址在基线中的序号加1，基线缺少这些地址时无法确定芯片中应有的值，报错。
+ */
+static int base_digest(const power_chip_data_t *base_data, const uint32_t *base_index, const power_chip_data_t *data, uint32_t count,
+						uint8_t *mask, uint32_t mask_max, uint32_t *mask_len, uint8_t *digest, txt2bin_err_t *err)
+{
+	uint8_t value[0x1800];			//power_sec中的地址都小于0x1800
+	const power_chip_data_t *rec;
+	uint32_t i, j, reg, len = 0;
+
+	for(i = 0; i < sizeof(power_sec) / sizeof(power_sec[0]); i++)
+	{
+		for(j = 0; j < count && (data[j].reg < power_sec[i].start || data[j].reg > power_sec[i].end); j++);
+		if(j == count)
+			continue;
+		for(reg = power_sec[i].start; reg <= power_sec[i].end; reg++)
+		{
+			if(0xFF == (reg & 0xFF))
+				continue;
+			for(j = 0; j < sizeof(digest_ignored_reg) / sizeof(digest_ignored_reg[0]) && reg != digest_ignored_reg[j]; j++);
+			if(j < sizeof(digest_ignored_reg) / sizeof(digest_ignored_reg[0]))
+				continue;
+			if(0 == base_index[reg])
+			{
+				set_err(err, 0, 0, "baseline has no register 0x%04x of section 0x%04x-0x%04x", reg, power_sec[i].start, power_sec[i].end);
+				return -1;
+			}
+			if(len >= mask_max)
+			{
+				set_err(err, 0, 0, "output buffer too small for baseline masks");
+				return -1;
+			}
+			rec = &base_data[base_index[reg] - 1];
+			mask[len] = rec->mask;
+			value[len++] = rec->value & rec->mask;
+		}
+	}
+	*mask_len = len;
+	if(1 != EVP_Digest(value, len, digest, NULL, EVP_sha256(), NULL))
+	{
+		set_err(err, 0, 0, "baseline digest fail");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 生成相对基线的差分镜像：只保留地址不在基线中、或者值/掩码与基线不同的记录，保持原来的顺序。
+ * 芯片当前的固件版本等于BaseFwRev、改动的section中的寄存器与基线相同（BaseDigest）时，写入这些寄存器后与完整升级的结果相同，
+ * 因此新旧固件版本必须不同，基线必须包含改动的section中的全部地址。
+ */
+int txt2bin_convert_delta(const txt2bin_key_t *key, const char *txt, size_t len, const uint8_t *base_image, const txt2bin_result_t *base,
+						uint8_t *bin, size_t bin_max, txt2bin_result_t *result, txt2bin_err_t *err)
+{
+	power_chip_hd_t *head = (power_chip_hd_t *)bin;
+	power_chip_data_t *data = (power_chip_data_t *)(bin + sizeof(power_chip_hd_t));
+	const power_chip_data_t *base_data = (const power_chip_data_t *)base_image;
+	uint32_t *base_index;			//寄存器地址在基线中的序号加1，0表示不在基线中
+	uint8_t digest[POWER_BASE_DIGEST_SIZE];
+	uint32_t i, count = 0, idx, mask_len = 0;
+
+	if(NULL == bin || bin_max < sizeof(power_chip_hd_t) + TXT2BIN_SIG_MAX)
+	{
+		set_err(err, 0, 0, "output buffer too small");
+		return -1;
+	}
+	if(0 != txt2bin_parse(txt, len, bin + sizeof(power_chip_hd_t), bin_max - sizeof(power_chip_hd_t) - TXT2BIN_SIG_MAX, result, err))
+		return -1;
+	if(result->fw_rev == base->fw_rev)
+	{
+		set_err(err, 0, 0, "fw ver 0x%02x is the same as baseline", result->fw_rev);
+		return -1;
+	}
+
+	base_index = calloc(0x10000, sizeof(uint32_t));
+	if(NULL == base_index)
+	{
+		set_err(err, 0, 0, "malloc base index fail");
+		return -1;
+	}
+	//同一地址出现多次时后面的记录生效，与写入芯片的结果一致
+	for(i = 0; i < base->register_num; i++)
+		base_index[base_data[i].reg] = i + 1;
+	for(i = 0; i < result->register_num; i++)
+	{
+		idx = base_index[data[i].reg];
+		if(idx && base_data[idx - 1].value == data[i].value && base_data[idx - 1].mask == data[i].mask)
+			continue;
+		data[count++] = data[i];
+	}
+	if(0 == count)
+	{
+		free(base_index);
+		set_err(err, 0, 0, "no register is changed");
+		return -1;
+	}
+	//基线掩码紧跟在寄存器记录之后，计入ImgSize，由镜像CRC和签名保护
+	if(0 != base_digest(base_data, base_index, data, count, (uint8_t *)(data + count),
+		bin_max - TXT2BIN_SIG_MAX - sizeof(power_chip_hd_t) - count * sizeof(power_chip_data_t), &mask_len, digest, err))
+	{
+		free(base_index);
+		return -1;
+	}
+	free(base_index);
+
+	result->register_num = count;
+	build_header(head, POWER_SUBMODEL, POWER_IMG_TYPE_DELTA, count * sizeof(power_chip_data_t) + mask_len, result->fw_rev, base->fw_rev,
+				digest, mask_len, key ? key->sig_type : 0);
+	result->img_type = POWER_IMG_TYPE_DELTA;
+	result->base_fw_rev = base->fw_rev;
+	memcpy(result->base_digest, digest, POWER_BASE_DIGEST_SIZE);
+	result->base_mask_size = mask_len;
+	result->img_crc = head->ImgCRC32;
+	result->hdr_crc = head->HdrCRC32;
+	if(0 != txt2bin_sign(key, bin, head->sha256_sig_offset, bin + head->sha256_sig_offset, &result->sig_len, err))
+		return -1;
+	result->bin_len = head->sha256_sig_offset + result->sig_len;
+	return 0;
+}
+
+// 校验结果对应的BMC completion code名称
+const char *txt2bin_verify_name(int code)
+{
+	if(code < 0 || code >= TXT2BIN_VERIFY_CODE_COUNT)
+		return "UNKNOWN";
+	return verify_names[code];
+}
+
+//与BMC的PDK_PowerChipMicDirCheck相同，单板匹配除外
+static int verify_mic_dir(const uint8_t *bin, txt2bin_result_t *result, txt2bin_err_t *err)
+{
+	const power_chip_hd_t *head = (const power_chip_hd_t *)bin;
+	const power_chip_mic_dir_t *dir = (const power_chip_mic_dir_t *)(bin + head->ImgOffset);
+	const power_chip_mic_entry_t *entry = (const power_chip_mic_entry_t *)(dir + 1);
+	uint32_t body_start, body_end, i, j;
+
+	body_end = head->ImgOffset + head->ImgSize;
+	if(head->ImgSize < sizeof(power_chip_mic_dir_t) || 0 == dir->EntryCount || POWER_MIC_ENTRY_MAX < dir->EntryCount
+		|| head->ImgSize < sizeof(power_chip_mic_dir_t) + dir->EntryCount * sizeof(power_chip_mic_entry_t))
+	{
+		set_err(err, 0, 0, "multi-image directory is invalid, image size %u", head->ImgSize);
+		return TXT2BIN_VERIFY_SIZE_INVALID;
+	}
+	body_start = head->ImgOffset + sizeof(power_chip_mic_dir_t) + dir->EntryCount * sizeof(power_chip_mic_entry_t);
+	for(i = 0; i < dir->EntryCount; i++)
+	{
+		if(entry[i].Offset < body_start || entry[i].Offset > body_end || entry[i].Size > body_end - entry[i].Offset
+			|| 0 == entry[i].Size || 0 != entry[i].Size % sizeof(power_chip_data_t))
+		{
+			set_err(err, 0, 0, "multi-image entry %u [%x + %x] is out of [%x, %x)", i, entry[i].Offset, entry[i].Size, body_start, body_end);
+			return TXT2BIN_VERIFY_SIZE_INVALID;
+		}
+		for(j = 0; j < i; j++)
+		{
+			if(0 == memcmp(entry[i].SubModel, entry[j].SubModel, POWER_CHIP_MODEL_INFO_LEN))
+			{
+				set_err(err, 0, 0, "multi-image entry %u and %u have the same submodel", j, i);
+				return TXT2BIN_VERIFY_MODEL;
+			}
+		}
+		result->register_num += entry[i].Size / sizeof(power_chip_data_t);
+	}
+	result->image_count = dir->EntryCount;
+	return TXT2BIN_VERIFY_OK;
+}
+
+/*
+ * 按BMC中PDK_PowerChipFwImageLoad、PDK_PowerChipFwImageVerify的规则校验bin：文件大小、镜像头CRC、Signature、DevModel、
+ * 偏移和大小、镜像CRC、签名（按SigType），多镜像容器再检查目录。返回txt2bin_verify_code，err中为失败原因。
+ */
+int txt2bin_verify(const txt2bin_key_t *key, const uint8_t *bin, size_t len, txt2bin_result_t *result, txt2bin_err_t *err)
+{
+	const power_chip_hd_t *head = (const power_chip_hd_t *)bin;
+	uint8_t signature[FW_IDENTITY_LEN] = {0};
+	size_t fw_size;
+	int sig_size;
+
+	memset(result, 0, sizeof(txt2bin_result_t));
+	result->bin_len = len;
+	if(NULL == bin || len > MAX_BIN_SIZE || len < sizeof(power_chip_hd_t) + POWER_SIG_SIZE_MIN)
+	{
+		set_err(err, 0, 0, "size %zu is out of [%zu, %u]", len, sizeof(power_chip_hd_t) + POWER_SIG_SIZE_MIN, MAX_BIN_SIZE);
+		return TXT2BIN_VERIFY_SIZE_INVALID;
+	}
+	result->fw_rev = head->FwRev;
+	result->img_type = head->ImgType;
+	result->base_fw_rev = head->BaseFwRev;
+	memcpy(result->base_digest, head->BaseDigest, POWER_BASE_DIGEST_SIZE);
+	result->base_mask_size = head->BaseMaskSize;
+	result->sig_type = head->SigType;
+	result->img_crc = head->ImgCRC32;
+	result->hdr_crc = head->HdrCRC32;
+	if(head->HdrCRC32 != CalculateCRC32((unsigned char *)bin, sizeof(power_chip_hd_t) - sizeof(head->HdrCRC32)))
+	{
+		set_err(err, 0, 0, "header CRC32 verify fail");
+		return TXT2BIN_VERIFY_HDR_CRC;
+	}
+	memcpy(signature, POWER_SIGNATURE, strlen(POWER_SIGNATURE));
+	if(0 != memcmp(signature, head->Signature, FW_IDENTITY_LEN))
+	{
+		set_err(err, 0, 0, "header signature invalid");
+		return TXT2BIN_VERIFY_SIGNATURE;
+	}
+	if(0 != memcmp(POWER_MODEL, head->DevModel, strlen(POWER_MODEL)))
+	{
+		set_err(err, 0, 0, "header devmodel invalid");
+		return TXT2BIN_VERIFY_MODEL;
+	}
+	sig_size = txt2bin_sig_size(head->SigType);
+	if(sig_size < 0)
+	{
+		set_err(err, 0, 0, "signature type %u is not supported", head->SigType);
+		return TXT2BIN_VERIFY_HASH_SIGNED;
+	}
+	if(head->ImgOffset < sizeof(power_chip_hd_t) || head->ImgOffset > len
+		|| len != (size_t)head->ImgOffset + head->ImgSize + sig_size)
+	{
+		set_err(err, 0, 0, "size invalid [%x + %x + %x != %zx]", head->ImgOffset, head->ImgSize, sig_size, len);
+		return TXT2BIN_VERIFY_SIZE_INVALID;
+	}
+	if(head->ImgCRC32 != CalculateCRC32((unsigned char *)bin + head->ImgOffset, head->ImgSize))
+	{
+		set_err(err, 0, 0, "image CRC32 verify fail");
+		return TXT2BIN_VERIFY_CHKSUM;
+	}
+	fw_size = len - sig_size;
+	result->sig_len = sig_size;
+	if(NULL == key || key->sig_type != head->SigType)
+	{
+		set_err(err, 0, 0, "no public key for signature type %u", head->SigType);
+		return TXT2BIN_VERIFY_HASH_SIGNED;
+	}
+	if(!key_verify(key, bin, fw_size, bin + fw_size, sig_size))
+	{
+		set_err(err, 0, 0, "digest signature verify fail");
+		return TXT2BIN_VERIFY_HASH_SIGNED;
+	}
+	if(POWER_IMG_TYPE_MULTI == head->ImgType)
+		return verify_mic_dir(bin, result, err);
+	//差分镜像的寄存器记录之后是基线掩码，见base_digest
+	if(POWER_IMG_TYPE_DELTA == head->ImgType
+		&& (head->BaseMaskSize >= head->ImgSize || 0 != (head->ImgSize - head->BaseMaskSize) % sizeof(power_chip_data_t)))
+	{
+		set_err(err, 0, 0, "delta image size %u is invalid with %u baseline masks", head->ImgSize, head->BaseMaskSize);
+		return TXT2BIN_VERIFY_SIZE_INVALID;
+	}
+	result->register_num = (head->ImgSize - (POWER_IMG_TYPE_DELTA == head->ImgType ? head->BaseMaskSize : 0)) / sizeof(power_chip_data_t);
+	return TXT2BIN_VERIFY_OK;
+}
+
+// 默认的bin文件名，与固件版本相关，如"irps5401_U1_V1.05.bin"
+void txt2bin_bin_name(uint8_t fw_rev, char *name, size_t name_len)
+{
+	snprintf(name, name_len, "%s%u.%02u.bin", POWER_FW, fw_rev >> 4, fw_rev & 0x0f);
+}
+
+// 差分镜像的文件名，如"irps5401_U1_V1.05_from_V1.04.bin"
+void txt2bin_delta_bin_name(uint8_t fw_rev, uint8_t base_fw_rev, char *name, size_t name_len)
+{
+	snprintf(name, name_len, "%s%u.%02u_from_V%u.%02u.bin", POWER_FW, fw_rev >> 4, fw_rev & 0x0f, base_fw_rev >> 4, base_fw_rev & 0x0f);
+}
@@ -0,0 +1,151 @@
+#ifndef __LIBTXT2BIN_H__
+#define __LIBTXT2BIN_H__
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 英飞凌IRPS5401 txt固件转换为BMC升级使用的bin格式：镜像头 + 寄存器记录 + 签名（RSA1024或Ed25519）。
+ * 所有函数只使用调用者提供的内存，不读写文件（txt2bin_key_load_file除外），不打印，可以在多个线程中同时调用，
+ * 同一个txt2bin_key_t可以被多个线程共用。
+ */
+
+#define PACKED __attribute__ ((packed))
+
+#define FW_IDENTITY_LEN					16
+#define POWER_CHIP_FW_LABEL				16
+#define POWER_CHIP_MODEL_INFO_LEN		16
+#define IRPS5401_FW						"irps5401_U1_V"
+#define IRPS5401_SUBMODEL				"IRPS5401_U1"
+#define POWER_FW						IRPS5401_FW
+#define POWER_SIGNATURE					"$FW@MyCompany"
+#define POWER_MODEL						"MYDEV_POWER"
+#define POWER_SUBMODEL					IRPS5401_SUBMODEL
+#define POWER_MIC_SUBMODEL				"MULTI_IMAGE"		//多镜像容器外层镜像头的SubModel
+#define POWER_IMG_TYPE_SINGLE			0
+#define POWER_IMG_TYPE_MULTI			1
+#define POWER_IMG_TYPE_DELTA			2					//相对BaseFwRev的差分镜像，只包含有改动的寄存器
+#define POWER_MIC_ENTRY_MAX				16					//与BMC的POWER_CHIP_MIC_ENTRY_MAX一致
+#define MAX_BIN_SIZE					(100*1024)			//暂定100K大小，生成的bin文件不会超过该大小
+#define POWER_CHIP_FW_SIZE_MAX			MAX_BIN_SIZE
+#define TXT2BIN_SIG_MAX					256					//签名的最大长度，RSA1024为128
+#define IRPS5401_VERSION_ADDR			0x002A
+#define POWER_BASE_DIGEST_SIZE			32					//差分镜像基线摘要（SHA256）的长度，与BMC的POWER_CHIP_BASE_DIGEST_SIZE一致
+
+#define PRIVATE_KEY_PATH				"power_chip_private_key.pem"
+#define PUBLIC_KEY_PATH					"power_chip_public.pem"
+
+#define TXT2BIN_ERR_MSG_LEN				128
+#define POWER_SIG_TYPE_RSA1024			0					//镜像头SigType，旧镜像该字节为0
+#define POWER_SIG_TYPE_ED25519			1
+#define POWER_SIG_RSA1024_SIZE			128					//与BMC的POWER_CHIP_IMG_DIGEST_SIGN_SIZE一致
+#define POWER_SIG_ED25519_SIZE			64					//与BMC的POWER_CHIP_IMG_ED25519_SIGN_SIZE一致
+#define POWER_SIG_SIZE_MIN				POWER_SIG_ED25519_SIZE
+
+//bin校验结果，与BMC中PDK_PowerChipFwImageVerify的返回值一一对应，校验顺序也相同
+typedef enum
+{
+	TXT2BIN_VERIFY_OK = 0,				//CC_NORMAL
+	TXT2BIN_VERIFY_SIZE_INVALID,		//CC_FILE_SIZE_INVALID，包括多镜像容器目录越界
+	TXT2BIN_VERIFY_HDR_CRC,				//CC_ERR_FW_IMG_HDR_CRC
+	TXT2BIN_VERIFY_SIGNATURE,			//CC_ERR_FW_IMG_SIGNATURE
+	TXT2BIN_VERIFY_MODEL,				//CC_ERR_FW_IMG_MODEL，包括多镜像容器中SubModel重复
+	TXT2BIN_VERIFY_CHKSUM,				//CC_FILE_CHKSUM_EER
+	TXT2BIN_VERIFY_HASH_SIGNED,			//CC_ERR_HASH_SIGNED_VERIFY
+	TXT2BIN_VERIFY_CODE_COUNT,
+}txt2bin_verify_code;
+
+typedef struct
+{
+    uint8_t		Signature[FW_IDENTITY_LEN];				//内容固定为POWER_SIGNATURE
+    uint8_t		DevModel[POWER_CHIP_FW_LABEL];			//内容固定为POWER_MODEL
+    uint8_t		SubModel[POWER_CHIP_MODEL_INFO_LEN];	//内容与电源芯片有关，如"IRPS5401_U1"、"XDPE12284C_U21"
+    uint8_t		FwRev;									//固件版本
+    uint32_t	ImgOffset;								//官方固件的位置
+    uint32_t	ImgSize;								//官方固件的大小
+    uint32_t	ImgCRC32;								//固件的CRC32值
+    uint32_t	sha256_sig_offset;						//SHA256 签名位置
+    uint8_t		ImgType;								//POWER_IMG_TYPE_SINGLE/MULTI/DELTA
+    uint8_t		BaseFwRev;								//差分镜像适用的芯片固件版本
+    uint8_t		SigType;								//POWER_SIG_TYPE_RSA1024/ED25519，决定签名长度
+    uint8_t		BaseDigest[POWER_BASE_DIGEST_SIZE];		//差分镜像：基线在改动的section中全部寄存器值与掩码的SHA256
+    uint32_t	BaseMaskSize;							//差分镜像：ImgSize中寄存器记录之后基线掩码的字节数，每个计算摘要的地址一个字节
+    uint8_t		Reserved[20];							//保留
+    uint32_t	HdrCRC32;								//以上内容的CRC32值
+}PACKED power_chip_hd_t;
+
+typedef struct
+{
+	uint16_t reg;
+	uint8_t value;
+	uint8_t mask;
+}PACKED power_chip_data_t;
+
+//多镜像容器：镜像头 + 目录 + EntryCount个目录项 + 各镜像的寄存器记录 + 签名，整个容器只签名一次
+typedef struct
+{
+	uint32_t	EntryCount;
+	uint32_t	Reserved;
+}PACKED power_chip_mic_dir_t;
+
+typedef struct
+{
+	uint8_t		SubModel[POWER_CHIP_MODEL_INFO_LEN];	//镜像对应的电源芯片
+	uint8_t		FwRev;									//镜像的固件版本
+	uint8_t		Reserved[3];
+	uint32_t	Offset;									//寄存器记录相对文件开头的位置
+	uint32_t	Size;									//寄存器记录的大小
+}PACKED power_chip_mic_entry_t;
+
+//失败原因，line、col从1开始，与输入位置无关的错误为0
+typedef struct
+{
+	int line;
+	int col;
+	char msg[TXT2BIN_ERR_MSG_LEN];
+}txt2bin_err_t;
+
+//txt解析和转换的结果
+typedef struct
+{
+	uint8_t fw_rev;					//0x002A寄存器的值
+	uint32_t register_num;			//寄存器记录数
+	uint32_t crc_expect;			//"//CRC32 : "行中的CRC32
+	uint32_t crc_calc;				//计算得到的CRC32
+	uint32_t img_crc;				//镜像头中的ImgCRC32
+	uint32_t hdr_crc;				//镜像头中的HdrCRC32
+	unsigned int sig_len;			//签名长度
+	size_t bin_len;					//bin的总长度
+	uint32_t image_count;			//多镜像容器中的镜像数，单镜像为0
+	uint8_t img_type;				//镜像头中的ImgType
+	uint8_t base_fw_rev;			//差分镜像的基线固件版本
+	uint8_t sig_type;				//镜像头中的SigType
+	uint8_t base_digest[POWER_BASE_DIGEST_SIZE];	//镜像头中差分镜像的BaseDigest
+	uint32_t base_mask_size;		//镜像头中差分镜像的BaseMaskSize
+}txt2bin_result_t;
+
+//签名使用的私钥和校验签名使用的公钥
+typedef struct txt2bin_key txt2bin_key_t;
+
+extern unsigned int CalculateCRC32(unsigned char *Buffer, unsigned int Size);
+extern txt2bin_key_t *txt2bin_key_load_file(const char *private_path, const char *public_path, txt2bin_err_t *err);
+extern txt2bin_key_t *txt2bin_key_load_mem(const void *private_pem, size_t private_len, const void *public_pem, size_t public_len, txt2bin_err_t *err);
+extern txt2bin_key_t *txt2bin_key_load_public(const char *public_path, txt2bin_err_t *err);
+extern void txt2bin_key_free(txt2bin_key_t *key);
+extern int txt2bin_key_sig_type(const txt2bin_key_t *key);
+extern int txt2bin_sig_size(int sig_type);
+extern int txt2bin_parse(const char *txt, size_t len, uint8_t *image, uint32_t image_max, txt2bin_result_t *result, txt2bin_err_t *err);
+extern void txt2bin_build_header(power_chip_hd_t *head, uint32_t img_size, uint8_t fw_rev, uint8_t sig_type);
+extern int txt2bin_sign(const txt2bin_key_t *key, const uint8_t *data, size_t len, uint8_t *sig, unsigned int *sig_len, txt2bin_err_t *err);
+extern int txt2bin_convert(const txt2bin_key_t *key, const char *txt, size_t len, uint8_t *bin, size_t bin_max, txt2bin_result_t *result, txt2bin_err_t *err);
+extern int txt2bin_mic_split(const char *txt, size_t len, size_t *start, int *start_line, int max, txt2bin_err_t *err);
+extern int txt2bin_convert_mic(const txt2bin_key_t *key, const char *txt, size_t len, const char *const *submodels, int submodel_count,
+							uint8_t *bin, size_t bin_max, txt2bin_result_t *result, txt2bin_err_t *err);
+extern int txt2bin_base_load(const txt2bin_key_t *key, const uint8_t *data, size_t len, uint8_t *image, uint32_t image_max, txt2bin_result_t *base, txt2bin_err_t *err);
+extern int txt2bin_convert_delta(const txt2bin_key_t *key, const char *txt, size_t len, const uint8_t *base_image, const txt2bin_result_t *base,
+							uint8_t *bin, size_t bin_max, txt2bin_result_t *result, txt2bin_err_t *err);
+extern int txt2bin_verify(const txt2bin_key_t *key, const uint8_t *bin, size_t len, txt2bin_result_t *result, txt2bin_err_t *err);
+extern const char *txt2bin_verify_name(int code);
+extern void txt2bin_bin_name(uint8_t fw_rev, char *name, size_t name_len);
+extern void txt2bin_delta_bin_name(uint8_t fw_rev, uint8_t base_fw_rev, char *name, size_t name_len);
+
+#endif
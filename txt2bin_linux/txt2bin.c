@@ -1,451 +1,548 @@
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
-#include <openssl/sha.h>
-#include <openssl/rsa.h>
-#include <openssl/pem.h>
-#include <openssl/err.h>
-#include <dlfcn.h>
-
-#define PACKED __attribute__ ((packed))
-
-
-#define FW_IDENTITY_LEN					16
-#define POWER_CHIP_FW_LABEL				16
-#define POWER_CHIP_MODEL_INFO_LEN		16
-#define BUF_SIZE (100*1024)
-#define POWER_CHIP_FW_SIZE_MAX			BUF_SIZE
-#define IRPS5401_FW						"irps5401_U1_V"
-#define IRPS5401_SUBMODEL				"IRPS5401_U1"
-#define POWER_FW						IRPS5401_FW
-#define POWER_SIGNATURE					"$FW@MyCompany"
-#define POWER_MODEL						"MYDEV_POWER"
-#define POWER_SUBMODEL					IRPS5401_SUBMODEL
-#define MAX_BIN_SIZE					(100*1024)			//暂定100K大小
-#define IRPS5401_VERSION_ADDR			0x002A
-
-#define PRIVATE_KEY_PATH		"power_chip_private_key.pem"
-#define PUBLIC_KEY_PATH			"power_chip_public.pem"
-
-typedef unsigned char uint8_t;
-typedef unsigned short uint16_t;
-typedef unsigned int uint32_t;
-
+#include <pthread.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "libtxt2bin.h"
+
+#define BIN_NAME_LEN			256
+#define JOB_MSG_LEN				128
+#define WORKER_MAX				64
+#define STDIO_NAME				"-"					//输入文件名为"-"时从标准输入读取
+#define MIC_EXT					".mic"				//多镜像文件的扩展名
+
+//批量模式下不打印每个文件的转换过程，只在最后输出每个文件的结果；bin输出到标准输出时过程打印到标准错误
+#define LOG(fmt, ...)			do{ if(g_verbose) fprintf(g_log, fmt, ##__VA_ARGS__); }while(0)
+
+//一个txt文件的转换任务
 typedef struct
 {
-    uint8_t		Signature[FW_IDENTITY_LEN];				//内容固定为POWER_SIGNATURE
-    uint8_t		DevModel[POWER_CHIP_FW_LABEL];			//内容固定为POWER_MODEL
-    uint8_t		SubModel[POWER_CHIP_MODEL_INFO_LEN];	//内容与电源芯片有关，如"IRPS5401_U1"、"XDPE12284C_U21"
-    uint8_t		FwRev;									//固件版本
-    uint32_t	ImgOffset;								//官方固件的位置
-    uint32_t	ImgSize;								//官方固件的大小
-    uint32_t	ImgCRC32;								//固件的CRC32值
-    uint32_t	sha256_sig_offset;						//SHA256 签名位置
-    uint8_t		Reserved[59];							//保留
-    uint32_t	HdrCRC32;								//以上内容的CRC32值
-}PACKED power_chip_hd_t;
-
-typedef struct
+	char *input;						//txt文件
+	char output[BIN_NAME_LEN];			//生成的bin文件
+	char msg[JOB_MSG_LEN];				//失败原因
+	int ret;							//0：成功
+}txt2bin_job_t;
+
+static int g_verbose = 1;
+static FILE *g_log = NULL;
+static int g_to_stdout = 0;				//bin写到标准输出
+static txt2bin_key_t *g_key = NULL;		//密钥只在启动时读取一次，所有转换任务共用
+static char *g_out_dir = NULL;			//bin文件的输出目录，默认当前目录
+static txt2bin_job_t *g_jobs = NULL;
+static int g_job_count = 0;
+static int g_job_next = 0;				//下一个待转换的任务，工作线程原子地领取
+static pthread_mutex_t g_name_mutex = PTHREAD_MUTEX_INITIALIZER;	//检查输出文件名冲突
+static char *g_submodels[POWER_MIC_ENTRY_MAX];	//-m指定的多镜像文件中各镜像对应的SubModel
+static int g_submodel_count = 0;
+static uint8_t *g_base_image = NULL;	//-b指定的基线寄存器记录，生成差分镜像，所有转换任务共用
+static txt2bin_result_t g_base;
+
+static void job_fail(txt2bin_job_t *job, const char *fmt, ...)
 {
-	uint16_t reg;
-	uint8_t value;
-	uint8_t mask;
-}PACKED power_chip_data_t;
+	va_list ap;
+
+	job->ret = -1;
+	va_start(ap, fmt);
+	vsnprintf(job->msg, sizeof(job->msg), fmt, ap);
+	va_end(ap);
+	if(g_verbose)
+		fprintf(g_log, "%s\n", job->msg);
+}
 
-unsigned long  CrcLookUpTable[256] =
+//读取全部标准输入
+static char *read_stdin(size_t *len)
 {
-	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
-	0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-	0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
-	0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE,
-	0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-	0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,
-	0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-	0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-	0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940,
-	0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116,
-	0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-	0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
-	0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-
-	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A,
-	0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-	0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818,
-	0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
-	0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-	0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C,
-	0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2,
-	0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-	0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-	0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086,
-	0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-	0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4,
-	0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-
-	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
-	0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-	0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8,
-	0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE,
-	0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-	0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
-	0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252,
-	0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-	0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60,
-	0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-	0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-	0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04,
-	0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-
-	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A,
-	0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-	0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
-	0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E,
-	0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-	0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C,
-	0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
-	0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-	0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0,
-	0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6,
-	0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-	0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-	0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
-};
-
-unsigned int CalculateCRC32(unsigned char *Buffer, unsigned int Size)
-{
-	unsigned int i,crc32 = 0xFFFFFFFF;
+	size_t size = 64 * 1024, n;
+	char *buf = malloc(size), *p;
 
-	/* Read the data and calculate crc32 */	
-	for(i = 0; i < Size; i++)
-	crc32 = ((crc32) >> 8) ^ CrcLookUpTable[(Buffer[i]) ^ ((crc32) & 0x000000FF)];
-	
-	return ~crc32;
+	*len = 0;
+	while(NULL != buf && 0 < (n = fread(buf + *len, 1, size - *len, stdin)))
+	{
+		*len += n;
+		if(*len == size)
+		{
+			p = realloc(buf, size * 2);
+			if(NULL == p)
+			{
+				free(buf);
+				return NULL;
+			}
+			buf = p;
+			size *= 2;
+		}
+	}
+	return buf;
 }
 
-void DoCRC32(unsigned int *crc32, unsigned char Data)
+//txt文件映射到内存后只读取一次，标准输入读到内存中
+static char *map_input(txt2bin_job_t *job, size_t *len, int *mapped)
 {
-	*crc32=((*crc32) >> 8) ^ CrcLookUpTable[Data ^ ((*crc32) & 0x000000FF)];
-	return;
+	struct stat st;
+	char *map;
+	int fd;
+
+	*mapped = 0;
+	if(0 == strcmp(job->input, STDIO_NAME))
+	{
+		map = read_stdin(len);
+		if(NULL == map)
+			job_fail(job, "read stdin fail");
+		return map;
+	}
+	fd = open(job->input, O_RDONLY);
+	if(fd < 0)
+	{
+		job_fail(job, "open %s fail", job->input);
+		return NULL;
+	}
+	if(0 != fstat(fd, &st) || 0 == st.st_size)
+	{
+		close(fd);
+		job_fail(job, "%s is empty", job->input);
+		return NULL;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(MAP_FAILED == map)
+	{
+		job_fail(job, "mmap %s fail", job->input);
+		return NULL;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	*len = st.st_size;
+	*mapped = 1;
+	return map;
 }
 
-int vr_irps_fw_image_crc_verify(char *file)
+//输出文件名只与固件版本有关，不同单板的txt可能生成同名文件，先登记的任务使用该文件名
+static int claim_bin_name(txt2bin_job_t *job, const char *bin_name)
 {
-    FILE *fp;
-    char buf[256];
-    int start_crc = 0;
-    int len;
-    unsigned int crc32 = 0xFFFFFFFF;
-    unsigned int crc32_val = 0;
-    unsigned int i;
-
-    if (NULL == file)
-    {
-        printf("File name is NULL\n");
-        return -1;
-    }
-
-    fp = fopen(file, "r");
-    if (NULL == fp)
-    {
-        perror("Error opening file");
-        return 1;
-    }
-
-    while (NULL != fgets(buf, sizeof(buf), fp))
-    {
-        if (0 == start_crc)
-        {
-            if (0 == memcmp(buf, "//CRC32 : ", 10))
-            {
-                start_crc = 1;
-                crc32_val = strtoul(&buf[10], NULL, 0);
-                
-            }
-
-            continue;
-        }
-
-        len = strlen(buf);
-        if (len < 3)
-        {
-            fclose(fp);
-            printf("Invaild line length %d\n", len);
-            return -1;
-        }
-
-        /* NOTE: Skip the "/r/n" at the end of line */
-        for (i = 0; i < (len - 2); i++)
-        {
-            DoCRC32(&crc32, buf[i]);
-        }
-    }
-
-    fclose(fp);
-    printf("CRC32=%08X vs %08X\n", crc32_val, ~crc32);
-
-    if (crc32_val != (~crc32))
-    {
-        printf("IRPS Firmware Image CRC32 verify failed !!!\n");
-        return -1;
-    }
-
-    printf("IRPS Firmware Image CRC32 verify OK\n");
-    return 0;
-}
+	int i, ret = 0;
+	char output[BIN_NAME_LEN];
 
-// 计算 SHA-256 哈希值
-void compute_sha256(const unsigned char *data, size_t len, unsigned char hash[SHA256_DIGEST_LENGTH]) {
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    SHA256_Update(&sha256, data, len);
-    SHA256_Final(hash, &sha256);
+	snprintf(output, sizeof(output), "%s%s%s", g_out_dir ? g_out_dir : "", g_out_dir ? "/" : "", bin_name);
+	pthread_mutex_lock(&g_name_mutex);
+	for(i = 0; i < g_job_count; i++)
+	{
+		if(&g_jobs[i] != job && 0 == strcmp(g_jobs[i].output, output))
+		{
+			ret = -1;
+			break;
+		}
+	}
+	if(0 == ret)
+		memcpy(job->output, output, sizeof(output));
+	pthread_mutex_unlock(&g_name_mutex);
+	if(0 != ret)
+		job_fail(job, "output %s is also generated from %s", output, g_jobs[i].input);
+	return ret;
 }
 
-// 从文件中读取私钥
-RSA *load_private_key(const char *filename) {
-    FILE *fp = fopen(filename, "rb");
-    if (fp == NULL) {
-        perror("Error opening private key file");
-        return NULL;
-    }
-
-    RSA *rsa = PEM_read_RSAPrivateKey(fp, NULL, NULL, NULL);
-    fclose(fp);
-
-    if (rsa == NULL) {
-        fprintf(stderr, "Error reading private key from file\n");
-        ERR_print_errors_fp(stderr);
-    }
+//扩展名为.mic或者指定了-m时按多镜像文件转换
+static int is_mic(const char *input)
+{
+	size_t len = strlen(input);
 
-    return rsa;
+	if(g_submodel_count > 0)
+		return 1;
+	return len > strlen(MIC_EXT) && 0 == strcasecmp(input + len - strlen(MIC_EXT), MIC_EXT);
 }
 
-// 从文件中读取公钥
-RSA *load_public_key(const char *filename) {
-    FILE *fp = fopen(filename, "rb");
-    if (fp == NULL) {
-        perror("Error opening public key file");
-        return NULL;
-    }
-
-    RSA *rsa = PEM_read_RSA_PUBKEY(fp, NULL, NULL, NULL);
-    fclose(fp);
-
-    if (rsa == NULL) {
-        fprintf(stderr, "Error reading public key from file\n");
-        ERR_print_errors_fp(stderr);
-    }
-
-    return rsa;
+//多镜像容器的文件名为输入文件名去掉目录和扩展名后加上".bin"，如"board_a.mic"生成"board_a.bin"
+static void mic_bin_name(const char *input, char *name, size_t name_len)
+{
+	const char *base = strrchr(input, '/');
+	const char *ext;
+	int len;
+
+	base = base ? base + 1 : input;
+	ext = strrchr(base, '.');
+	len = ext ? (int)(ext - base) : (int)strlen(base);
+	snprintf(name, name_len, "%.*s.bin", len, base);
 }
 
-// 使用私钥对哈希值进行签名
-int sign_with_private_key(RSA *rsa, const unsigned char *hash, unsigned char *signature, unsigned int *sig_len) {
-    return RSA_sign(NID_sha256, hash, SHA256_DIGEST_LENGTH, signature, sig_len, rsa);
-}
+//-m的参数为逗号分隔的SubModel列表，依次对应mic文件中的各镜像
+static int parse_submodels(char *arg)
+{
+	char *save = NULL, *sub;
 
-// 验证签名
-int verify_signature(RSA *rsa, const unsigned char *hash, const unsigned char *signature, unsigned int sig_len) {
-    return RSA_verify(NID_sha256, hash, SHA256_DIGEST_LENGTH, signature, sig_len, rsa);
+	for(sub = strtok_r(arg, ",", &save); NULL != sub; sub = strtok_r(NULL, ",", &save))
+	{
+		if(g_submodel_count >= POWER_MIC_ENTRY_MAX)
+		{
+			fprintf(stderr, "No more than %d submodels.\n", POWER_MIC_ENTRY_MAX);
+			return -1;
+		}
+		g_submodels[g_submodel_count++] = sub;
+	}
+	return 0;
 }
 
-int rsasignature(char *data, size_t data_len, char *signature, unsigned int *sig_len) {
-
-    // 计算 SHA-256 哈希值
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    compute_sha256((const unsigned char *)data, data_len, hash);
-
-    printf("SHA-256 Hash: ");
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        printf("%02x", hash[i]);
-    }
-    printf("\n");
-
-    // 从文件中加载私钥
-    RSA *private_key = load_private_key(PRIVATE_KEY_PATH);
-    if (private_key == NULL) {
-        return -1;
-    }
-
-    // 使用私钥对哈希值进行签名
-    if (!sign_with_private_key(private_key, hash, signature, sig_len)) {
-        printf("Signature failed.\n");
-        RSA_free(private_key);
-        return -1;
-    }
-
-    printf("Signature length: %u\n", *sig_len);
-
-    // 从文件中加载公钥
-    RSA *public_key = load_public_key(PUBLIC_KEY_PATH);
-    if (public_key == NULL) {
-        RSA_free(private_key);
-        return -1;
-    }
-
-    // 验证签名
-    if (!verify_signature(public_key, hash, signature, *sig_len)) {
-        fprintf(stderr, "Verification failed.\n");
-        RSA_free(private_key);
-        RSA_free(public_key);
-        return -1;
-    }
-
-    printf("Signature verified successfully.\n");
-
-    // 清理资源
-    RSA_free(private_key);
-    RSA_free(public_key);
-
-    return 0;
+//读取差分镜像的基线，txt文件或者单镜像bin
+static int load_base(const char *path)
+{
+	txt2bin_job_t job;
+	txt2bin_err_t err;
+	char *data;
+	size_t len = 0;
+	int mapped = 0, ret;
+
+	memset(&job, 0, sizeof(job));
+	job.input = (char *)path;
+	data = map_input(&job, &len, &mapped);
+	if(NULL == data)
+		return -1;
+	g_base_image = malloc(MAX_BIN_SIZE);
+	memset(&err, 0, sizeof(err));
+	ret = g_base_image ? txt2bin_base_load(g_key, (uint8_t *)data, len, g_base_image, MAX_BIN_SIZE, &g_base, &err) : -1;
+	if(mapped)
+		munmap(data, len);
+	else
+		free(data);
+	if(0 != ret)
+	{
+		fprintf(g_log, "Load baseline %s fail, %s.\n", path, err.msg);
+		return -1;
+	}
+	LOG("Baseline %s: fw ver 0x%02x, %u registers\n", path, g_base.fw_rev, g_base.register_num);
+	return 0;
 }
 
-int txt2bin(char *filename)
+static int txt2bin(txt2bin_job_t *job)
 {
 	power_chip_hd_t *head = NULL;
-	char buf[256];
-	uint32_t version;
-    int len;
-    uint32_t  i;
-	uint32_t  register_num = 0;
-	power_chip_data_t data;
-	char *bin_buf = NULL;
-	int num = 0;
-	unsigned char *signature = NULL;
-    unsigned int sig_len;
+	txt2bin_result_t result;
+	txt2bin_err_t err;
+	uint32_t i;
+	char *txt = NULL;
+	size_t txt_len = 0;
+	int mapped = 0;
+	uint8_t *bin_buf = NULL;
+	char bin_name[BIN_NAME_LEN] = {0};
+	int mic = is_mic(job->input);
 	int ret = 0;
-	char bin_name[32] = {0};
-	char *p_image_offset = NULL;
-	uint32_t temp_reg, temp_value, temp_mask;
-	
-	
-	FILE *fp = fopen(filename, "r");
-    if (NULL == fp)
-    {
-        perror("Error opening file");
-        return 1;
-    }
 
 	bin_buf = malloc(MAX_BIN_SIZE);
 	if(NULL == bin_buf)
 	{
-		perror("malloc bin_buf");
-		fclose(fp);
+		job_fail(job, "malloc bin_buf fail");
+		return -1;
+	}
+	txt = map_input(job, &txt_len, &mapped);
+	if(NULL == txt)
+	{
+		free(bin_buf);
+		return -1;
+	}
+	memset(&err, 0, sizeof(err));
+	if(mic)
+		ret = txt2bin_convert_mic(g_key, txt, txt_len, (const char *const *)g_submodels, g_submodel_count, bin_buf, MAX_BIN_SIZE, &result, &err);
+	else if(g_base_image)
+		ret = txt2bin_convert_delta(g_key, txt, txt_len, g_base_image, &g_base, bin_buf, MAX_BIN_SIZE, &result, &err);
+	else
+		ret = txt2bin_convert(g_key, txt, txt_len, bin_buf, MAX_BIN_SIZE, &result, &err);
+	if(mapped)
+		munmap(txt, txt_len);
+	else
+		free(txt);
+	if(0 != result.crc_calc || 0 != result.crc_expect)
+		LOG("CRC32=%08X vs %08X\n", result.crc_expect, result.crc_calc);
+	if(0 != ret)
+	{
+		free(bin_buf);
+		if(err.line)
+			job_fail(job, "%s:%d:%d: %s", job->input, err.line, err.col, err.msg);
+		else
+			job_fail(job, "%s: %s", job->input, err.msg);
 		return -1;
 	}
-	memset(bin_buf, 0, MAX_BIN_SIZE);
 	head = (power_chip_hd_t *)bin_buf;
-	memcpy(&head->Signature, POWER_SIGNATURE, strlen(POWER_SIGNATURE));
-	memcpy(&head->DevModel, POWER_MODEL, strlen(POWER_MODEL));
-	memcpy(&head->SubModel, POWER_SUBMODEL, strlen(POWER_SUBMODEL));
-	head->ImgOffset = sizeof(power_chip_hd_t);
-	p_image_offset = bin_buf + sizeof(power_chip_hd_t);
-    while (NULL != fgets(buf, sizeof(buf), fp))
-    {
-		memset(&data, 0, sizeof(data));
-		if (0 == memcmp(buf, "//", 2))
-        {
-            continue;
-        }
-        len = strlen(buf);
-        if (len < 8)
-        {
-            fclose(fp);
-            printf("Invaild line length %d\n", len);
-            return -1;
-        }
-
-		num = sscanf(buf, "%4hx %2hhx %2hhx", &data.reg, &data.value, &data.mask);
-		if(3 != num)
+	LOG("IRPS Firmware Image CRC32 verify OK\n");
+	if(POWER_IMG_TYPE_DELTA == result.img_type)
+		LOG("delta image from fw ver 0x%02x to 0x%02x, %u changed registers\n", result.base_fw_rev, result.fw_rev, result.register_num);
+	if(mic)
+	{
+		power_chip_mic_entry_t *entry = (power_chip_mic_entry_t *)(bin_buf + sizeof(power_chip_hd_t) + sizeof(power_chip_mic_dir_t));
+
+		for(i = 0; i < result.image_count; i++)
+			LOG("image %u: submodel %.16s, fw ver 0x%02x, %u registers\n", i + 1, entry[i].SubModel, entry[i].FwRev, entry[i].Size / (uint32_t)sizeof(power_chip_data_t));
+	}
+	LOG("image crc32 = 0x%x\n", result.img_crc);
+	LOG("head crc32 = 0x%x\n", result.hdr_crc);
+	LOG("Signature length: %u\n", result.sig_len);
+	if(g_verbose)
+	{
+		fprintf(g_log, "signature: ");
+		for (i = 0; i < result.sig_len; i++) {
+			fprintf(g_log, "%02x", bin_buf[head->sha256_sig_offset + i]);
+		}
+		fprintf(g_log, "\n");
+	}
+
+	if(g_to_stdout)
+	{
+		snprintf(job->output, sizeof(job->output), "%s", "stdout");
+		if(1 != fwrite(bin_buf, result.bin_len, 1, stdout) || 0 != fflush(stdout))
 		{
-			perror("format fail");
-			fclose(fp);
 			free(bin_buf);
-			printf("Resolve txt file fail.\n");
+			job_fail(job, "Error to write bin to stdout");
 			return -1;
 		}
-		if(IRPS5401_VERSION_ADDR == data.reg)
-		{
-			head->FwRev = data.value;
-		}
-		memcpy(p_image_offset, (char *)&data, sizeof(data));
-		register_num++;
-		p_image_offset = p_image_offset + sizeof(data);
-    }
-	fclose(fp);
-	head->ImgSize = register_num * sizeof(data);
-	head->ImgCRC32 = CalculateCRC32(bin_buf + sizeof(power_chip_hd_t), head->ImgSize);
-	printf("image crc32 = 0x%x\n", head->ImgCRC32);
-	head->sha256_sig_offset = sizeof(power_chip_hd_t) + head->ImgSize;
-	head->HdrCRC32 = CalculateCRC32((unsigned char *)head, sizeof(power_chip_hd_t) - sizeof(head->HdrCRC32));
-	printf("head crc32 = 0x%x\n", head->HdrCRC32);
-	signature = (unsigned char *)(bin_buf + head->sha256_sig_offset);
-	ret = rsasignature(bin_buf, head->sha256_sig_offset, signature, &sig_len);
-	if(ret != 0)
+		free(bin_buf);
+		job->ret = 0;
+		return 0;
+	}
+
+	if(mic)
+		mic_bin_name(job->input, bin_name, sizeof(bin_name));
+	else if(POWER_IMG_TYPE_DELTA == result.img_type)
+		txt2bin_delta_bin_name(result.fw_rev, result.base_fw_rev, bin_name, sizeof(bin_name));
+	else
+		txt2bin_bin_name(result.fw_rev, bin_name, sizeof(bin_name));
+	if(0 != claim_bin_name(job, bin_name))
 	{
 		free(bin_buf);
-		printf("Resolve txt file fail.\n");
 		return -1;
 	}
-	printf("signature: ");
-      	unsigned char* p = signature;
-      	for (i = 0; i < sig_len; i++, p++) {
-               	printf("%02x", *p);
-      	}
-	printf("\n");
-
-	memset(bin_name, 0, sizeof(bin_name));
-	snprintf(bin_name, sizeof(bin_name), "%s%u.%02u.bin", POWER_FW, head->FwRev>>4,head->FwRev&0x0f);
-	FILE *fbin = fopen(bin_name, "wb");
+	FILE *fbin = fopen(job->output, "wb");
 	if(NULL == fbin)
 	{
-		fclose(fbin);
 		free(bin_buf);
-		perror("Error to create bin file");
+		job_fail(job, "Error to create bin file %s", job->output);
 		return -1;
 	}
-	if(1 != fwrite(bin_buf, head->sha256_sig_offset + sig_len, 1, fbin))
+	if(1 != fwrite(bin_buf, result.bin_len, 1, fbin))
 	{
 		fclose(fbin);
 		free(bin_buf);
-		perror("Error to write head to bin file");
+		job_fail(job, "Error to write bin file %s", job->output);
 		return -1;
 	}
 
 	fclose(fbin);
 	free(bin_buf);
-	printf("================Create bin file success, file name:%s ==================\n",bin_name);
+	job->ret = 0;
+	LOG("================Create bin file success, file name:%s ==================\n", job->output);
+	return 0;
+}
+
+static void *convert_worker(void *arg)
+{
+	int i;
+
+	(void)arg;
+	while((i = __sync_fetch_and_add(&g_job_next, 1)) < g_job_count)
+		txt2bin(&g_jobs[i]);
+	return NULL;
+}
+
+//清单文件每行一个txt文件，忽略空行和以#开头的行
+static int load_manifest(const char *manifest, char ***inputs, int *count)
+{
+	FILE *fp = fopen(manifest, "r");
+	char line[1024];
+	char **list;
+	int len;
+
+	if(NULL == fp)
+	{
+		perror("Error opening manifest");
+		return -1;
+	}
+	while(NULL != fgets(line, sizeof(line), fp))
+	{
+		len = strlen(line);
+		while(len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t'))
+			line[--len] = 0;
+		if(0 == len || '#' == line[0])
+			continue;
+		list = realloc(*inputs, sizeof(char *) * (*count + 1));
+		if(NULL == list)
+		{
+			fclose(fp);
+			return -1;
+		}
+		*inputs = list;
+		(*inputs)[(*count)++] = strdup(line);
+	}
+	fclose(fp);
 	return 0;
 }
 
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-j jobs] [-o out_dir] [-f manifest] [-k private_key] [-p public_key] [-m submodels] [-b baseline] [-c] txt_file...\n", prog);
+	printf("  -j jobs         number of worker threads in batch mode, default is the number of cpus\n");
+	printf("  -o out_dir      directory of generated bin files, default is current directory\n");
+	printf("  -f manifest     file listing one txt file per line\n");
+	printf("  -k private_key  private key, default is %s\n", PRIVATE_KEY_PATH);
+	printf("  -p public_key   public key, default is %s\n", PUBLIC_KEY_PATH);
+	printf("  -m submodels    comma separated submodel of each image in mic file, e.g. IRPS5401_U1,IRPS5401_U2\n");
+	printf("  -b baseline     baseline txt or bin, generate delta bin of changed registers only\n");
+	printf("  -c              write bin to stdout, only one txt file\n");
+	printf("txt_file \"%s\" reads from stdin and writes bin to stdout.\n", STDIO_NAME);
+	printf("More than one txt file, -f or -j runs in batch mode, keys are loaded once.\n");
+	printf("File with %s extension or -m is converted to a multi-image bin, named after the input file.\n", MIC_EXT);
+}
+
 int main(int argc, char *argv[])
 {
 	int ret = 0;
-
-	if(argc < 2)
+	int opt, i, worker_count = 0, fail_count = 0;
+	int batch = 0;
+	char **inputs = NULL;
+	int input_count = 0;
+	pthread_t workers[WORKER_MAX];
+	char *private_path = PRIVATE_KEY_PATH, *public_path = PUBLIC_KEY_PATH;
+	char *base_path = NULL;
+	txt2bin_err_t err;
+
+	g_log = stdout;
+	while(-1 != (opt = getopt(argc, argv, "j:o:f:k:p:m:b:ch")))
+	{
+		switch(opt)
+		{
+		case 'j':
+			worker_count = atoi(optarg);
+			batch = 1;
+			break;
+		case 'o':
+			g_out_dir = optarg;
+			break;
+		case 'k':
+			private_path = optarg;
+			break;
+		case 'p':
+			public_path = optarg;
+			break;
+		case 'c':
+			g_to_stdout = 1;
+			break;
+		case 'm':
+			if(0 != parse_submodels(optarg))
+				return -1;
+			break;
+		case 'b':
+			base_path = optarg;
+			break;
+		case 'f':
+			if(0 != load_manifest(optarg, &inputs, &input_count))
+				return -1;
+			batch = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	for(i = optind; i < argc; i++)
+	{
+		char **list = realloc(inputs, sizeof(char *) * (input_count + 1));
+		if(NULL == list)
+			return -1;
+		inputs = list;
+		inputs[input_count++] = argv[i];
+	}
+	if(input_count < 1)
 	{
 		printf("Please run command with power chip update file.\n");
+		usage(argv[0]);
+		return -1;
+	}
+	if(input_count > 1)
+		batch = 1;
+	if(1 == input_count && 0 == strcmp(inputs[0], STDIO_NAME))
+		g_to_stdout = 1;
+	if(g_to_stdout)
+	{
+		//标准输出只能写一个bin
+		if(batch)
+		{
+			fprintf(stderr, "Only one txt file can be converted to stdout.\n");
+			return -1;
+		}
+		g_log = stderr;
+	}
+
+	g_jobs = calloc(input_count, sizeof(txt2bin_job_t));
+	if(NULL == g_jobs)
 		return -1;
+	for(i = 0; i < input_count; i++)
+	{
+		g_jobs[i].input = inputs[i];
+		g_jobs[i].ret = -1;
 	}
+	g_job_count = input_count;
 
-	ret = vr_irps_fw_image_crc_verify(argv[1]);
-	if (0 != ret)
+	memset(&err, 0, sizeof(err));
+	g_key = txt2bin_key_load_file(private_path, public_path, &err);
+	if(NULL == g_key)
 	{
-		printf("Input firmware file %s CRC32 verify fail !!!!!!\n", argv[1]);
+		fprintf(g_log, "Load keys fail, %s.\n", err.msg);
 		return -1;
 	}
-	return txt2bin(argv[1]);
-}
+	if(NULL != base_path)
+	{
+		//多镜像容器中的镜像不支持差分
+		for(i = 0; i < input_count; i++)
+		{
+			if(is_mic(inputs[i]))
+			{
+				fprintf(g_log, "Delta bin can not be generated from mic file %s.\n", inputs[i]);
+				txt2bin_key_free(g_key);
+				return -1;
+			}
+		}
+		if(0 != load_base(base_path))
+		{
+			txt2bin_key_free(g_key);
+			return -1;
+		}
+	}
 
+	if(!batch)
+	{
+		ret = txt2bin(&g_jobs[0]);
+		txt2bin_key_free(g_key);
+		return ret;
+	}
+
+	g_verbose = 0;
+	if(worker_count <= 0)
+		worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+	if(worker_count > input_count)
+		worker_count = input_count;
+	if(worker_count > WORKER_MAX)
+		worker_count = WORKER_MAX;
+	if(worker_count < 1)
+		worker_count = 1;
+	for(i = 0; i < worker_count; i++)
+	{
+		if(0 != pthread_create(&workers[i], NULL, convert_worker, NULL))
+			break;
+	}
+	//线程创建失败时由主线程完成剩余任务
+	worker_count = i;
+	convert_worker(NULL);
+	for(i = 0; i < worker_count; i++)
+		pthread_join(workers[i], NULL);
+
+	for(i = 0; i < input_count; i++)
+	{
+		if(0 == g_jobs[i].ret)
+			printf("OK   %s -> %s\n", g_jobs[i].input, g_jobs[i].output);
+		else
+		{
+			printf("FAIL %s: %s\n", g_jobs[i].input, g_jobs[i].msg);
+			fail_count++;
+		}
+	}
+	printf("%d converted, %d failed\n", input_count - fail_count, fail_count);
+	txt2bin_key_free(g_key);
+	return fail_count ? 1 : 0;
+}
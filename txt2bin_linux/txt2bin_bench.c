@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "libtxt2bin.h"
+
+#define BENCH_IMAGES			1000
+#define BENCH_NAME_LEN			256
+#define BENCH_LINE_LEN			10					//"AAAA VV MM"，不含行尾的"\r\n"
+#define BENCH_NULL_FILE			"/dev/null"
+
+//与BMC中irps5401_sec的地址范围一致，生成的寄存器都落在可写的分区中
+typedef struct
+{
+	uint16_t start;
+	uint16_t end;
+}bench_section_t;
+
+static const bench_section_t bench_sec[] = {
+	{0x0000, 0x0001}, {0x0020, 0x003B}, {0x0420, 0x042B}, {0x0600, 0x06FF},
+	{0x0700, 0x07FF}, {0x0820, 0x082B}, {0x0A00, 0x0AFF}, {0x0B00, 0x0BFF},
+	{0x0C20, 0x0C2B}, {0x0E00, 0x0EFF}, {0x0F00, 0x0FFF}, {0x1020, 0x102B},
+	{0x1200, 0x12FF}, {0x1300, 0x13FF}, {0x1420, 0x1421}, {0x1600, 0x16FF},
+	{0x1700, 0x17FF},
+};
+
+//转换的各个阶段，分别计时
+typedef enum
+{
+	STAGE_GEN = 0,						//生成txt，不属于txt2bin，只作参考
+	STAGE_PARSE,						//txt2bin_parse，包括txt的CRC32校验
+	STAGE_CRC,							//txt2bin_build_header，镜像和镜像头的CRC32
+	STAGE_SIGN,							//txt2bin_sign，签名并用公钥验证
+	STAGE_WRITE,						//bin写入文件
+	STAGE_COUNT,
+}bench_stage;
+
+static const char *stage_names[STAGE_COUNT] = {"generate", "parse", "crc", "sign", "write"};
+
+static double g_time[STAGE_COUNT];		//各阶段的总时间，秒
+static double g_bytes[STAGE_COUNT];		//各阶段处理的字节数，用于计算MB/s
+static uint16_t *g_addrs = NULL;		//布局中除版本寄存器外的全部地址
+static int g_addr_count = 0;
+static unsigned int g_seed = 1;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int layout_init(void)
+{
+	unsigned int i, reg;
+
+	for(i = 0; i < sizeof(bench_sec) / sizeof(bench_sec[0]); i++)
+		g_addr_count += bench_sec[i].end - bench_sec[i].start + 1;
+	g_addrs = malloc(sizeof(uint16_t) * g_addr_count);
+	if(NULL == g_addrs)
+		return -1;
+	g_addr_count = 0;
+	for(i = 0; i < sizeof(bench_sec) / sizeof(bench_sec[0]); i++)
+	{
+		for(reg = bench_sec[i].start; reg <= bench_sec[i].end; reg++)
+		{
+			if(IRPS5401_VERSION_ADDR != reg)
+				g_addrs[g_addr_count++] = reg;
+		}
+	}
+	return 0;
+}
+
+static uint8_t rand_byte(void)
+{
+	g_seed = g_seed * 1103515245 + 12345;
+	return (g_seed >> 16) & 0xff;
+}
+
+/*
+ * 生成一个英飞凌格式的txt：注释行、"//CRC32 : "行、regs条"寄存器 值 掩码"记录，行尾为"\r\n"。
+ * 记录均匀地取自bench_sec中的地址并按地址排序，版本寄存器0x002A放在最后，值为fw_rev。
+ * 各page的0xFF（page寄存器）也是分区的结束地址，BMC按它确定分区中的记录。
+ * CRC32按txt2bin的规则计算（每行去掉行尾的"\r\n"），返回txt的长度。
+ */
+static size_t gen_txt(char *txt, char *line_buf, int index, int regs, uint8_t fw_rev)
+{
+	char *p = line_buf;
+	uint16_t addr;
+	size_t len;
+	int i;
+
+	for(i = 0; i < regs - 1; i++, p += BENCH_LINE_LEN)
+	{
+		//每个page的0xFF是page寄存器，与芯片导出的配置一样取该page的编号，升级时写入不会切换page
+		addr = g_addrs[(long)i * g_addr_count / (regs - 1)];
+		sprintf(p, "%04X %02X FF", addr, 0xFF == (addr & 0xFF) ? addr >> 8 : rand_byte());
+	}
+	sprintf(p, "%04X %02X FF", IRPS5401_VERSION_ADDR, fw_rev);
+
+	len = sprintf(txt, "//Synthetic IRPS5401 configuration %d, %d registers\r\n//CRC32 : 0x%08X\r\n",
+		index, regs, CalculateCRC32((unsigned char *)line_buf, regs * BENCH_LINE_LEN));
+	for(i = 0; i < regs; i++)
+	{
+		memcpy(txt + len, line_buf + i * BENCH_LINE_LEN, BENCH_LINE_LEN);
+		len += BENCH_LINE_LEN;
+		txt[len++] = '\r';
+		txt[len++] = '\n';
+	}
+	return len;
+}
+
+//写入生成的txt或者转换得到的bin
+static int save_file(const char *path, const void *data, size_t len)
+{
+	FILE *fp = fopen(path, "wb");
+
+	if(NULL == fp)
+		return -1;
+	if(1 != fwrite(data, len, 1, fp))
+	{
+		fclose(fp);
+		return -1;
+	}
+	return fclose(fp);
+}
+
+static void report(int images)
+{
+	double total_time = 0;
+	int i;
+
+	printf("%-10s %12s %12s %12s\n", "stage", "seconds", "MB/s", "images/s");
+	for(i = 0; i < STAGE_COUNT; i++)
+	{
+		printf("%-10s %12.6f %12.2f %12.1f\n", stage_names[i], g_time[i],
+			g_time[i] > 0 ? g_bytes[i] / g_time[i] / (1024 * 1024) : 0, g_time[i] > 0 ? images / g_time[i] : 0);
+		if(STAGE_GEN != i)
+			total_time += g_time[i];
+	}
+	//总吞吐率按txt的大小计算，不包括生成txt的时间
+	printf("%-10s %12.6f %12.2f %12.1f\n", "txt2bin", total_time,
+		total_time > 0 ? g_bytes[STAGE_PARSE] / total_time / (1024 * 1024) : 0, total_time > 0 ? images / total_time : 0);
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-i images] [-n registers] [-s seed] [-k private_key] [-p public_key] [-o out_dir] [-g corpus_dir]\n", prog);
+	printf("  -i images       number of synthetic images, default is %d\n", BENCH_IMAGES);
+	printf("  -n registers    registers per image, default is all %d registers in the irps5401 layout\n", g_addr_count + 1);
+	printf("  -s seed         seed of register values, same seed generates same txt files\n");
+	printf("  -k private_key  private key, default is %s\n", PRIVATE_KEY_PATH);
+	printf("  -p public_key   public key, default is %s\n", PUBLIC_KEY_PATH);
+	printf("  -o out_dir      write bin files to out_dir, default writes to %s\n", BENCH_NULL_FILE);
+	printf("  -g corpus_dir   only write generated txt files to corpus_dir\n");
+	printf("Each stage of txt2bin is timed separately: parse (with txt CRC32), crc (image and header CRC32), sign, write.\n");
+	printf("MB/s of parse is txt bytes, crc is image bytes, sign is signed bytes, write is bin bytes.\n");
+}
+
+int main(int argc, char *argv[])
+{
+	char *private_path = PRIVATE_KEY_PATH, *public_path = PUBLIC_KEY_PATH, *out_dir = NULL, *corpus_dir = NULL;
+	int opt, i, images = BENCH_IMAGES, regs = 0, ret = -1;
+	char name[BENCH_NAME_LEN];
+	char *txt = NULL, *line_buf = NULL;
+	uint8_t *bin = NULL;
+	power_chip_hd_t *head;
+	txt2bin_key_t *key = NULL;
+	txt2bin_result_t result;
+	txt2bin_err_t err;
+	size_t txt_len;
+	double t;
+
+	if(0 != layout_init())
+		return -1;
+	while(-1 != (opt = getopt(argc, argv, "i:n:s:k:p:o:g:h")))
+	{
+		switch(opt)
+		{
+		case 'i':
+			images = atoi(optarg);
+			break;
+		case 'n':
+			regs = atoi(optarg);
+			break;
+		case 's':
+			g_seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			private_path = optarg;
+			break;
+		case 'p':
+			public_path = optarg;
+			break;
+		case 'o':
+			out_dir = optarg;
+			break;
+		case 'g':
+			corpus_dir = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	if(0 == regs)
+		regs = g_addr_count + 1;
+	if(images <= 0 || regs < 2 || regs > g_addr_count + 1)
+	{
+		fprintf(stderr, "images must be positive and registers must be in [2, %d].\n", g_addr_count + 1);
+		return -1;
+	}
+
+	txt = malloc(128 + (size_t)regs * (BENCH_LINE_LEN + 2));
+	line_buf = malloc((size_t)regs * BENCH_LINE_LEN + 1);		//sprintf在最后一行后面写'\0'
+	bin = malloc(MAX_BIN_SIZE);
+	if(NULL == txt || NULL == line_buf || NULL == bin)
+	{
+		fprintf(stderr, "malloc fail.\n");
+		goto out;
+	}
+	if(NULL != corpus_dir)
+	{
+		mkdir(corpus_dir, 0755);
+		for(i = 0; i < images; i++)
+		{
+			txt_len = gen_txt(txt, line_buf, i, regs, (uint8_t)(0x10 + i));
+			snprintf(name, sizeof(name), "%s/bench_%05d.txt", corpus_dir, i);
+			if(0 != save_file(name, txt, txt_len))
+			{
+				fprintf(stderr, "Write %s fail.\n", name);
+				goto out;
+			}
+		}
+		printf("%d txt files with %d registers generated in %s\n", images, regs, corpus_dir);
+		ret = 0;
+		goto out;
+	}
+
+	memset(&err, 0, sizeof(err));
+	key = txt2bin_key_load_file(private_path, public_path, &err);
+	if(NULL == key)
+	{
+		fprintf(stderr, "Load keys fail, %s.\n", err.msg);
+		goto out;
+	}
+	if(NULL != out_dir)
+		mkdir(out_dir, 0755);
+
+	head = (power_chip_hd_t *)bin;
+	for(i = 0; i < images; i++)
+	{
+		t = now();
+		txt_len = gen_txt(txt, line_buf, i, regs, (uint8_t)(0x10 + i));
+		g_time[STAGE_GEN] += now() - t;
+		g_bytes[STAGE_GEN] += txt_len;
+
+		memset(&err, 0, sizeof(err));
+		t = now();
+		if(0 != txt2bin_parse(txt, txt_len, bin + sizeof(power_chip_hd_t), MAX_BIN_SIZE - sizeof(power_chip_hd_t) - TXT2BIN_SIG_MAX, &result, &err))
+		{
+			fprintf(stderr, "image %d: %d:%d: %s\n", i, err.line, err.col, err.msg);
+			goto out;
+		}
+		g_time[STAGE_PARSE] += now() - t;
+		g_bytes[STAGE_PARSE] += txt_len;
+
+		t = now();
+		txt2bin_build_header(head, result.register_num * sizeof(power_chip_data_t), result.fw_rev, txt2bin_key_sig_type(key));
+		g_time[STAGE_CRC] += now() - t;
+		g_bytes[STAGE_CRC] += head->sha256_sig_offset;
+
+		t = now();
+		if(0 != txt2bin_sign(key, bin, head->sha256_sig_offset, bin + head->sha256_sig_offset, &result.sig_len, &err))
+		{
+			fprintf(stderr, "image %d: %s\n", i, err.msg);
+			goto out;
+		}
+		g_time[STAGE_SIGN] += now() - t;
+		g_bytes[STAGE_SIGN] += head->sha256_sig_offset;
+		result.bin_len = head->sha256_sig_offset + result.sig_len;
+
+		if(NULL != out_dir)
+			snprintf(name, sizeof(name), "%s/bench_%05d.bin", out_dir, i);
+		else
+			snprintf(name, sizeof(name), "%s", BENCH_NULL_FILE);
+		t = now();
+		if(0 != save_file(name, bin, result.bin_len))
+		{
+			fprintf(stderr, "Write %s fail.\n", name);
+			goto out;
+		}
+		g_time[STAGE_WRITE] += now() - t;
+		g_bytes[STAGE_WRITE] += result.bin_len;
+	}
+
+	printf("%d images, %d registers, %zu txt bytes and %zu bin bytes per image\n", images, regs, txt_len, result.bin_len);
+	report(images);
+	ret = 0;
+out:
+	txt2bin_key_free(key);
+	free(txt);
+	free(line_buf);
+	free(bin);
+	free(g_addrs);
+	return ret;
+}
@@ -1,7 +1,15 @@
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/sysinfo.h>
 #include <sys/prctl.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
 #include "PDKPowerChip.h"
 #include "dictionary.h"
 #include "checksum.h"
@@ -15,8 +23,8 @@
 #define IRPS5401_PAGE_MIN				0
 #define IRPS5401_PAGE_MAX				0x17
 #define IRPS5401_PAGE_SIZE				256
-#define IRPS5401_I2C_DEV				"/dev/i2c4"
-#define IRPS5401_I2C_ADDR				0x14			//7bit address
+#define IRPS5401_U1_I2C_DEV				"/dev/i2c4"
+#define IRPS5401_U1_I2C_ADDR			0x14			//7bit address
 #define IRPS5401_CONF_WRITE_MAX_COUNT	5
 #define IRPS5401_USER_WRITE_MAX_COUNT	26
 #define POWER_CHIP_CONF_WARN_COUNT		0				//剩余升级次数低于此值会要求特权命令才能升级
@@ -26,18 +34,51 @@
 #define FW_IDENTITY_LEN					16
 #define POWER_CHIP_FW_LABEL				16
 #define POWER_CHIP_MODEL_INFO_LEN		16
+//以下时间和路径可以在编译时用-D修改，如在host上与芯片模型一起编译时（见update/host）
+#ifndef POWER_CHIP_PROGRAM_TIME
 #define POWER_CHIP_PROGRAM_TIME			(250*1000)		//电源芯片缓存当前寄存器值到OTP需要使用的时间,单位微秒
+#endif
+#ifndef POWER_CHIP_SETTLE_TIME
+#define POWER_CHIP_SETTLE_TIME			(2*1000*1000)	//编程user分区后、校验结束后等待芯片稳定的时间,单位微秒
+#endif
+#define POWER_CHIP_BUS_RETRY_TIME		(10*1000)		//升级线程获取总线失败后重试的间隔,单位微秒
+#define POWER_CHIP_BUS_LOCK_WARN_TIME	(5*1000)		//阻塞获取总线锁每等待该时间打印一次当前持有者,单位毫秒
+#define POWER_CHIP_BUS_HOLD_MAX			(50*1000)		//升级时连续占用总线的默认最长时间,单位微秒,超过后在页边界让出总线
+#define POWER_CHIP_EVENT_SUB_MAX		8				//升级事件订阅者的最大数量
+#define POWER_CHIP_EVENT_PROGRESS_STEP	5				//进度每变化5%才产生进度事件
+#define POWER_CHIP_EVENT_INTERVAL		(100*1000)		//同一芯片两次进度事件的最小间隔,单位微秒
 #define POWER_CHIP_FW_IMG_SIGN			"$FW@MyCompany"	//固件签名标志，一般使用公司或者设备名称
 #define DEVMODEL_MYDEV_POWER	   		"MYDEV_POWER"	//设备型号，与POWER_CHIP_FW_IMG_SIGG共同构成固件类型的识别
 #define MYDEV_IRPS5401_U1				"IRPS5401_U1"	//要升级的具体设备，在board_power_chip_info中关联到具体器件信息
-#define IRPSFW_IMG_FILE            		"/var/powerChip.bin"
-#define IRPSFW_IMG_USED_FILE       		"/var/powerChip.bin_used.bin"
+#ifndef IRPSFW_IMG_DIR
+#define IRPSFW_IMG_DIR					"/var"
+#endif
+#define IRPSFW_IMG_NAME					"powerChip.bin"
+#define IRPSFW_IMG_FILE            		IRPSFW_IMG_DIR "/" IRPSFW_IMG_NAME
+#define IRPSFW_IMG_USED_FILE       		IRPSFW_IMG_DIR "/powerChip.bin_used%d.bin"		//每个芯片一份拷贝，不同总线上的升级互不影响
 #define POWER_CHIP_FILE					IRPSFW_IMG_FILE
 #define POWER_CHIP_USED_FILE			IRPSFW_IMG_USED_FILE
+#ifndef POWER_CHIP_IMG_SIGN_PUBLIC_FILE
 #define POWER_CHIP_IMG_SIGN_PUBLIC_FILE	"/etc/power_chip_public.pem"		//解密用的公钥位置
+#endif
 #define POWER_CHIP_IMG_DIGEST_SIGN_SIZE	128
+#ifndef POWER_CHIP_IMG_SIGN_ED25519_PUBLIC_FILE
+#define POWER_CHIP_IMG_SIGN_ED25519_PUBLIC_FILE	"/etc/power_chip_public_ed25519.pem"	//Ed25519签名的公钥位置
+#endif
+#define POWER_CHIP_IMG_ED25519_SIGN_SIZE	64
+#define POWER_CHIP_IMG_SIGN_SIZE_MIN	POWER_CHIP_IMG_ED25519_SIGN_SIZE
+#define POWER_CHIP_SIG_TYPE_RSA1024		0				//镜像头SigType：RSA1024-SHA256，旧镜像该字节为0
+#define POWER_CHIP_SIG_TYPE_ED25519		1				//镜像头SigType：Ed25519
+#define POWER_CHIP_IMG_TYPE_SINGLE		0				//镜像头ImgType：单个芯片的镜像
+#define POWER_CHIP_IMG_TYPE_MULTI		1				//镜像头ImgType：多镜像容器，ImgOffset处为目录
+#define POWER_CHIP_IMG_TYPE_DELTA		2				//镜像头ImgType：相对BaseFwRev的差分镜像，只包含有改动的寄存器
+#define POWER_CHIP_MIC_ENTRY_MAX		16				//多镜像容器中镜像的最大数量
 #define BUF_SIZE						(100*1024)
 #define POWER_CHIP_FW_SIZE_MAX			BUF_SIZE
+#define POWER_CHIP_IMG_CACHE_COUNT		4				//镜像校验结果缓存的条目数
+#define POWER_CHIP_IMG_DIGEST_SIZE		32				//镜像内容SHA256的长度，用于复用校验结果
+#define POWER_CHIP_ARENA_SLOT_STAGED	POWER_CHIP_COUNT_MAX			//上传镜像预校验使用的slot
+#define POWER_CHIP_ARENA_SLOT_COUNT		(POWER_CHIP_COUNT_MAX + 1)		//每个power_chip_update[]成员一个slot，另加预校验的slot
 
 //register define
 #define IRPS5401_REG_START				0x0000
@@ -83,10 +124,32 @@ typedef struct
     INT32U		ImgSize;								//官方固件的大小
     INT32U		ImgCRC32;								//固件的CRC32值
     INT32U		sha256_sig_offset;						//SHA256 签名位置
-    INT8U		Reserved[59];							//保留
+    INT8U		ImgType;								//镜像类型，POWER_CHIP_IMG_TYPE_SINGLE/MULTI/DELTA
+    INT8U		BaseFwRev;								//差分镜像适用的芯片固件版本
+    INT8U		SigType;								//签名类型，POWER_CHIP_SIG_TYPE_RSA1024/ED25519，决定签名长度
+    INT8U		BaseDigest[POWER_CHIP_BASE_DIGEST_SIZE];	//差分镜像：基线在改动的section中全部寄存器值与掩码的SHA256，见PDK_PowerChipBaseDigest
+    INT32U		BaseMaskSize;							//差分镜像：ImgSize中寄存器记录之后基线掩码的字节数，见PDK_PowerChipBaseDigest
+    INT8U		Reserved[20];							//保留
     INT32U		HdrCRC32;								//以上内容的CRC32值
 }PACKED power_chip_hd_t;
 
+//多镜像容器的目录，位于ImgOffset处，后面紧跟EntryCount个power_chip_mic_entry_t，然后是各镜像的寄存器记录。
+//整个容器只有一个签名，外层镜像头的SubModel为"MULTI_IMAGE"，不支持容器的旧版本程序会因为单板不匹配而拒绝
+typedef struct
+{
+	INT32U		EntryCount;								//镜像数量
+	INT32U		Reserved;
+}PACKED power_chip_mic_dir_t;
+
+typedef struct
+{
+	INT8U		SubModel[POWER_CHIP_MODEL_INFO_LEN];	//镜像对应的电源芯片，与单镜像镜像头中的SubModel相同
+	INT8U		FwRev;									//镜像的固件版本
+	INT8U		Reserved[3];
+	INT32U		Offset;									//寄存器记录相对文件开头的位置
+	INT32U		Size;									//寄存器记录的大小
+}PACKED power_chip_mic_entry_t;
+
 //固件bin文件实际内容的组织结构
 typedef struct
 {
@@ -95,6 +158,85 @@ typedef struct
 	INT8U mask;
 }PACKED power_chip_data_t;
 
+//单个芯片的升级状态机，每一步只做有限的I2C操作，步骤之间需要的等待由调用者完成
+typedef enum
+{
+	POWER_CHIP_FSM_CHECK,				//检查芯片版本和剩余可编程次数
+	POWER_CHIP_FSM_BASE_READ,			//差分镜像：每步读取改动的section中一页寄存器
+	POWER_CHIP_FSM_BASE_COMPARE,		//差分镜像：比较基线摘要，再检查剩余可编程次数
+	POWER_CHIP_FSM_PREPARE,				//开始升级一个分区
+	POWER_CHIP_FSM_PAGE_WRITE,			//每步写入一个section page
+	POWER_CHIP_FSM_COMMIT,				//发送NVM命令，将寄存器编程到OTP
+	POWER_CHIP_FSM_POLL,				//编程时间后检查编程结果
+	POWER_CHIP_FSM_VERIFY,				//发送NVM命令重新加载user分区
+	POWER_CHIP_FSM_VERIFY_POLL,
+	POWER_CHIP_FSM_VERIFY_CRC,
+	POWER_CHIP_FSM_VERIFY_READ,			//每步读取一页寄存器
+	POWER_CHIP_FSM_VERIFY_COMPARE,
+	POWER_CHIP_FSM_FINISH,				//退出升级模式
+	POWER_CHIP_FSM_CANCEL_RELOAD,		//取消时发送NVM命令从user image重新加载寄存器，丢弃未提交的写入
+	POWER_CHIP_FSM_CANCEL_POLL,
+	POWER_CHIP_FSM_CANCEL_CRC,
+	POWER_CHIP_FSM_DONE,
+}power_chip_fsm_state;
+
+typedef struct
+{
+	power_chip_fsm_state state;
+	power_chip_update_t *FwUpdate;
+	INT8U Devinst;
+	INT32U mask;						//需要升级的分区
+	otp_section section;				//当前升级的分区
+	char *section_name;
+	INT32U sec;							//下一个要写入（差分镜像检查基线时为读取）的section下标
+	INT32U data_count;					//当前分区需要写入的寄存器数量
+	INT32U written_count;
+	INT16U verify_reg_count;
+	INT32U reg;							//校验时下一个要读取的寄存器
+	INT8U *reg_value;					//校验或检查基线时读回的寄存器值
+	INT32U wait_us;						//执行下一步之前需要等待的时间
+	INT32U gen;							//本次升级的编号，与power_chip_cancel_gen相同时表示已被取消
+	struct timespec hold_start;			//本次获取总线的时间
+	INT8U yielded;						//已让出总线，下一步之前需要重新获取
+	INT8U page;							//让出总线时芯片的page寄存器，重新获取后恢复
+	INT8U dirty;						//已写入的寄存器尚未编程到OTP，取消时需要重新加载
+	INT8U conf_committed;				//conf分区已编程而user分区还没有编程，此时取消芯片为新conf和旧user的配置
+	int result;							//升级结果，IPMI Completion Code
+}power_chip_fsm_t;
+
+#define POWER_CHIP_BUS_QUEUE_LEN		4			//每条总线上排队等待的升级请求的最大数量
+
+//总线升级队列中的一个请求
+typedef struct
+{
+	power_chip_buf_req_t req;
+	INT8U	digest[POWER_CHIP_IMG_DIGEST_SIZE];	//内存镜像或入队时上传文件的SHA256，用于识别重复请求
+	power_chip_sched_job_t *sched_job;		//多芯片升级提交的请求，完成后更新调度状态，否则为NULL
+}power_chip_bus_job_t;
+
+//一条物理I2C总线，挂在同一总线上的芯片共用一把锁，不同总线上的芯片可以同时访问
+//每条总线一个升级线程，同时执行一个请求，按队列顺序依次执行该总线上的请求，不同总线上的传输互不等待
+typedef struct
+{
+	char *i2c_dev;
+	pthread_mutex_t mutex;
+	pthread_t thread;						//该总线的升级线程，0表示没有启动
+	pthread_cond_t cond;					//有新的请求或取消请求，使用CLOCK_MONOTONIC，与PowerChipLoopMutex配合使用
+	power_chip_bus_job_t queue[POWER_CHIP_BUS_QUEUE_LEN];		//队列和is_running由PowerChipLoopMutex保护
+	INT8U queue_head;
+	INT8U queue_count;
+	INT8U is_running;						//running中的请求正在执行
+	power_chip_bus_job_t running;
+	INT8U started;							//running已进入升级模式，以下成员只由升级线程访问
+	INT8U file_ready;						//running使用的镜像文件已检查并复制
+	INT8U cancel;							//running在进入升级模式前被取消，由PowerChipLoopMutex保护
+	INT8U wake;								//有取消请求，在安全点时提前执行下一步，由PowerChipLoopMutex保护
+	struct timespec due;					//running下一步的执行时间，CLOCK_MONOTONIC
+	power_chip_fsm_t fsm;
+	power_chip_bus_stat_t stat;				//锁的统计，由PowerChipBusStatMutex保护
+	struct timespec hold_start;				//当前持有者获取锁的时间
+}power_chip_bus_t;
+
 typedef struct
 {	INT8U Devinst;
 	INT8U *DevModel;	
@@ -102,6 +244,7 @@ typedef struct
 	irps5401_info_t chip_info;
 	void *section_info;
 	INT8U section_count;
+	power_chip_bus_t *bus;		//芯片所在总线，初始化时按chip_info.i2c_dev关联
 }board_power_chip_info_t;
 
 typedef enum
@@ -121,11 +264,65 @@ typedef struct{
 	bool loop_en;
 }power_chip_reg_section_info_t;
 
-//线程锁，用于与其他线程互斥访问电源芯片所在I2C链路
-OS_THREAD_MUTEX_DEFINE(PowerChipIrps5401U1Mutex);
+//镜像文件的身份信息，任意一项变化都视为文件已被修改
+typedef struct
+{
+	dev_t	dev;
+	ino_t	ino;
+	off_t	size;
+	struct timespec mtime;
+}power_chip_img_key_t;
+
+//镜像校验结果缓存，同一个文件重复升级或升级失败重试时跳过CRC和签名校验
+//只有本次读取的内容SHA256与校验通过时的内容一致才沿用结果，不依赖文件身份信息
+typedef struct
+{
+	INT8U	valid;
+	power_chip_img_key_t key;
+	INT8U	digest[POWER_CHIP_IMG_DIGEST_SIZE];	//文件内容的SHA256，与key共同确认文件未被修改
+	INT32U	lru;							//最近一次使用的序号，缓存满时替换最小的条目
+	int		verdict;						//PDK_PowerChipFwImageVerify的校验结果
+	power_chip_hd_t hdr;					//校验通过的镜像头
+	INT8U	chip_inst;						//SubModel在board_power_chip_info中对应的编号，多镜像容器为第一个匹配的镜像
+	INT32U	chip_mask;						//镜像中有对应数据的power chip，bit i对应board_power_chip_info[i]
+	power_chip_sec_index_t sec_index[POWER_CHIP_SECTION_MAX];	//镜像中各section数据的位置索引
+}power_chip_img_cache_t;
+
+//预先分配的升级内存，升级过程中不再动态申请内存。
+//power_chip_update[i]固定使用第i个slot，is_under_update保证同一时间只有一个升级流程使用
+typedef struct
+{
+	INT8U	image[POWER_CHIP_FW_SIZE_MAX];							//镜像缓存
+	INT8U	reg_value[IRPS5401_REG_END - IRPS5401_REG_START + 1];	//校验时按页读取的全部寄存器值，以寄存器地址为下标
+}power_chip_arena_slot_t;
+
+//线程锁，用于互斥访问镜像校验结果缓存
+OS_THREAD_MUTEX_DEFINE(PowerChipImgCacheMutex);
+
+//线程锁，用于互斥访问上传镜像的预校验结果
+OS_THREAD_MUTEX_DEFINE(PowerChipStagedImgMutex);
+
+//线程锁，监视线程和板级升级都可能校验上传的镜像，互斥使用预校验的slot
+static pthread_mutex_t PowerChipStagedSlotMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//线程锁，用于Ed25519公钥的加载，公钥只读取一次，之后各线程共用
+OS_THREAD_MUTEX_DEFINE(PowerChipEd25519KeyMutex);
+static EVP_PKEY *power_chip_ed25519_key = NULL;
+
+static power_chip_arena_slot_t *power_chip_arena = NULL;
+static pthread_once_t power_chip_arena_once = PTHREAD_ONCE_INIT;
+
+static power_chip_img_cache_t power_chip_img_cache[POWER_CHIP_IMG_CACHE_COUNT];
+static INT32U power_chip_img_cache_lru = 0;
+
+//上传镜像的预校验结果，key为校验时文件的身份信息，用于判断结果是否仍对应当前文件
+static power_chip_staged_img_t power_chip_staged_img;
+static power_chip_img_key_t power_chip_staged_img_key;
 
 power_chip_req_t power_chip_req[POWER_CHIP_COUNT_MAX] ;
 
+power_chip_buf_req_t power_chip_buf_req[POWER_CHIP_COUNT_MAX];
+
 power_chip_update_t power_chip_update[POWER_CHIP_COUNT_MAX];
 
 static irps5401_section_info irps5401_sec[] = {
@@ -148,26 +345,44 @@ static irps5401_section_info irps5401_sec[] = {
 	{POWER_CHIP_SECTION_USER,	0x17,	0x1700,	0x17FF}
 };
 
-board_power_chip_info_t board_power_chip_info[] = {
-	{
-		0,	
-		DEVMODEL_MYDEV_POWER,	
-		MYDEV_IRPS5401_U1,	
-	{
-		IRPS5401_I2C_DEV,
-		IRPS5401_I2C_ADDR,
-		IRPS5401_PAGE_REG,
-		IRPS5401_PAGE_MIN,
-		IRPS5401_PAGE_MAX,
-		IRPS5401_PAGE_SIZE
-	}, 
-	irps5401_sec, 
-	sizeof(irps5401_sec)/sizeof(irps5401_sec[0])
+#define BOARD_IRPS5401(inst, submodel, i2c_dev, i2c_addr)	\
+	{																\
+		inst,														\
+		DEVMODEL_MYDEV_POWER,										\
+		submodel,													\
+	{																\
+		i2c_dev,													\
+		i2c_addr,													\
+		IRPS5401_PAGE_REG,											\
+		IRPS5401_PAGE_MIN,											\
+		IRPS5401_PAGE_MAX,											\
+		IRPS5401_PAGE_SIZE											\
+	},																\
+	irps5401_sec,													\
+	sizeof(irps5401_sec)/sizeof(irps5401_sec[0]),					\
+	NULL															\
 	}
+
+//单板上所有的电源芯片，Devinst与数组下标一致，数量不能超过POWER_CHIP_COUNT_MAX
+//多个芯片分布在不同总线上时依次添加，如：
+//	BOARD_IRPS5401(1, "IRPS5401_U2", "/dev/i2c4", 0x16),
+//	BOARD_IRPS5401(2, "IRPS5401_U3", "/dev/i2c5", 0x14),
+//	BOARD_IRPS5401(3, "IRPS5401_U4", "/dev/i2c6", 0x14),
+//也可以在编译时用-DPOWER_CHIP_BOARD_FILE=\"xxx.h\"指定包含上述条目的文件
+board_power_chip_info_t board_power_chip_info[] = {
+#ifdef POWER_CHIP_BOARD_FILE
+#include POWER_CHIP_BOARD_FILE
+#else
+	BOARD_IRPS5401(0, MYDEV_IRPS5401_U1, IRPS5401_U1_I2C_DEV, IRPS5401_U1_I2C_ADDR),
+#endif
 };
 
-//寄存器分布
-power_chip_reg_section_info_t irps5401_reg_section[]= {
+//各芯片所在的总线，初始化时按i2c_dev生成
+static power_chip_bus_t power_chip_bus[POWER_CHIP_COUNT_MAX];
+static pthread_once_t power_chip_bus_once = PTHREAD_ONCE_INIT;
+
+//寄存器分布，loop_en为false的寄存器区不参与校验，升级时未启用的switcher记录在reg_section_disable中
+const power_chip_reg_section_info_t irps5401_reg_section[]= {
 	{POWER_REG_COMMON_SECTION,		0x0000,	0x03FF,	true},
 	{POWER_REG_LOOP_A_SECTION,		0x0400,	0x07FF,	true},
 	{POWER_REG_LOOP_B_SECTION,		0x0800,	0x0BFF,	true},
@@ -179,7 +394,60 @@ power_chip_reg_section_info_t irps5401_reg_section[]= {
 INT16U verify_ignored_reg[] = {0x16F9, 0x16FB, 0x16FD, 0x17B0, 0x17BC};
 
 
+//已废弃：升级在总线升级线程中执行，不再设置，只为兼容仍然引用它的OEM/IPMI代码而保留
 pthread_t PowerChipFwUpdateThreadID[POWER_CHIP_COUNT_MAX]  = {0};
+pthread_t PowerChipImgWatchThreadID = 0;
+
+//power_chip_update[]中升级状态的快照，序号为奇数时表示正在更新，读取时不加锁
+typedef struct
+{
+	volatile INT32U seq;
+	power_chip_update_state_t state;
+}power_chip_state_seq_t;
+
+static power_chip_state_seq_t power_chip_state[POWER_CHIP_COUNT_MAX];
+
+//芯片版本信息的缓存，与power_chip_state相同的序号规则，写者持有芯片所在总线的锁
+typedef struct
+{
+	volatile INT32U seq;
+	power_chip_inventory_t inv;
+}power_chip_inventory_seq_t;
+
+static power_chip_inventory_seq_t power_chip_inventory[POWER_CHIP_COUNT_MAX];
+static volatile INT8U power_chip_inventory_dirty[POWER_CHIP_COUNT_MAX];	//缓存读取后芯片被写过
+
+//每次进入升级模式时编号加1，取消时记录被取消的编号，旧的取消请求不会影响之后的升级
+static volatile INT32U power_chip_update_gen[POWER_CHIP_COUNT_MAX];
+static volatile INT32U power_chip_cancel_gen[POWER_CHIP_COUNT_MAX];
+
+//升级事件的订阅者，每个订阅者一个eventfd，有事件时eventfd可读
+typedef struct
+{
+	int efd;							//-1表示未使用
+	INT32U event_mask;					//订阅的事件
+	INT32U pending;						//未读取的事件
+	INT8U Devinst_mask;					//产生未读取事件的芯片，以Devinst为位号
+}power_chip_event_sub_t;
+
+static power_chip_event_sub_t power_chip_event_sub[POWER_CHIP_EVENT_SUB_MAX];
+static struct timespec power_chip_event_last[POWER_CHIP_COUNT_MAX];		//各芯片上次进度事件的时间，只由发布状态的写者访问
+static INT32U power_chip_event_seq = 0;			//事件序号，每次通知加1
+static pthread_mutex_t PowerChipEventMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PowerChipEventCond;		//有新的事件，使用CLOCK_MONOTONIC
+static pthread_once_t power_chip_event_once = PTHREAD_ONCE_INIT;
+
+power_chip_sched_req_t power_chip_sched_req;
+power_chip_req_t power_chip_bundle_req;
+static power_chip_sched_t power_chip_sched;
+static pthread_mutex_t PowerChipSchedMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PowerChipSchedCond = PTHREAD_COND_INITIALIZER;		//多芯片升级中有任务完成
+static pthread_mutex_t PowerChipBusStatMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t PowerChipLoopMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t power_chip_loop_once = PTHREAD_ONCE_INIT;
+static volatile INT32U power_chip_bus_hold_max = POWER_CHIP_BUS_HOLD_MAX;	//0表示升级期间一直占用总线
+static power_chip_phase_hook_t power_chip_phase_hook = NULL;				//用于性能测试，见PDK_PowerChipPhaseHookSet
+static void PDK_PowerChipLoopStart(void);
 
 //校验的大部分时间都耗费在了通过I2C读取寄存器上，而不是寄存器内容的比对上，因此将读取寄存器的时间包含到校验进度中，
 //对各步骤的百分比施加权重
@@ -193,57 +461,392 @@ typedef enum
 
 
 /*****************************************************************************
- * Function     : PDK_Irps5401U1MutexBlockLock
- * Description  : irps5401 u1 pthread block lock 
+ * Function     : PDK_PowerChipArenaReserve
+ * Description  : reserve memory of all update slots at once, pages are populated immediately
+ * Params       : 
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipArenaReserve(void)
+{
+	void *p = mmap(NULL, sizeof(power_chip_arena_slot_t) * POWER_CHIP_ARENA_SLOT_COUNT, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+
+	if(MAP_FAILED == p)
+	{
+		TWARN("Reserve %u bytes for power chip update fail.\n", (INT32U)(sizeof(power_chip_arena_slot_t) * POWER_CHIP_ARENA_SLOT_COUNT));
+		return;
+	}
+	power_chip_arena = (power_chip_arena_slot_t *)p;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipArenaSlotGet
+ * Description  : get reserved memory of update slot, reserve all slots at first call
+ * Params       : slot:index of power_chip_update, or POWER_CHIP_ARENA_SLOT_STAGED
+ * Return       : slot memory, NULL if failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static power_chip_arena_slot_t *PDK_PowerChipArenaSlotGet(INT32U slot)
+{
+	pthread_once(&power_chip_arena_once, PDK_PowerChipArenaReserve);
+	if(NULL == power_chip_arena || slot >= POWER_CHIP_ARENA_SLOT_COUNT)
+		return NULL;
+	return &power_chip_arena[slot];
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusInit
+ * Description  : create one lock and one update queue for each i2c bus in board_power_chip_info
  * Params       : 
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipBusInit(void)
+{
+	INT32U i, j, bus_count = 0;
+
+	for(i = 0; i < sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t) && i < POWER_CHIP_COUNT_MAX; i++)
+	{
+		for(j = 0; j < bus_count; j++)
+		{
+			if(0 == strcmp(power_chip_bus[j].i2c_dev, board_power_chip_info[i].chip_info.i2c_dev))
+				break;
+		}
+		if(j == bus_count)
+		{
+			power_chip_bus[j].i2c_dev = board_power_chip_info[i].chip_info.i2c_dev;
+			pthread_mutex_init(&power_chip_bus[j].mutex, NULL);
+			bus_count++;
+		}
+		board_power_chip_info[i].bus = &power_chip_bus[j];
+	}
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusGet
+ * Description  : get i2c bus of power chip
+ * Params       : Devinst:power chip
+ * Return       : bus, NULL if Devinst is illegal
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static power_chip_bus_t *PDK_PowerChipBusGet(INT8U Devinst)
+{
+	pthread_once(&power_chip_bus_once, PDK_PowerChipBusInit);
+	if(Devinst >= sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t) || Devinst >= POWER_CHIP_COUNT_MAX)
+		return NULL;
+	return board_power_chip_info[Devinst].bus;
+}
+
+static INT32U PDK_PowerChipElapsedUs(struct timespec *start, struct timespec *end)
+{
+	INT64U us = (INT64U)(end->tv_sec - start->tv_sec) * 1000000 + (end->tv_nsec - start->tv_nsec) / 1000;
+	return us > 0xFFFFFFFF ? 0xFFFFFFFF : (INT32U)us;
+}
+
+//时间直方图按10倍划分区间，第一个区间为100us以内
+static void PDK_PowerChipLockHistAdd(INT32U *hist, INT32U us)
+{
+	INT32U i, limit = 100;
+
+	for(i = 0; i < POWER_CHIP_LOCK_HIST_COUNT - 1 && us >= limit; i++)
+		limit *= 10;
+	hist[i]++;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusLockAcquired
+ * Description  : record wait time and holder after the bus lock is taken
+ * Params       : bus:i2c bus; start:time before taking the lock, CLOCK_MONOTONIC
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipBusLockAcquired(power_chip_bus_t *bus, struct timespec *start)
+{
+	power_chip_bus_stat_t *stat = &bus->stat;
+	struct timespec now;
+	INT32U wait_us;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	wait_us = PDK_PowerChipElapsedUs(start, &now);
+
+	pthread_mutex_lock(&PowerChipBusStatMutex);
+	stat->lock_count++;
+	stat->wait_total_us += wait_us;
+	if(wait_us > stat->wait_max_us)
+		stat->wait_max_us = wait_us;
+	PDK_PowerChipLockHistAdd(stat->wait_hist, wait_us);
+	stat->holder_tid = (INT32U)syscall(SYS_gettid);
+	memset(stat->holder, 0, sizeof(stat->holder));
+	prctl(PR_GET_NAME, stat->holder, 0, 0, 0);
+	stat->holder[sizeof(stat->holder) - 1] = 0;
+	bus->hold_start = now;
+	pthread_mutex_unlock(&PowerChipBusStatMutex);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusTryLock
+ * Description  : take the bus lock without blocking and without warning, failures are counted
+ * Params       : bus:i2c bus
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipBusTryLock(power_chip_bus_t *bus)
+{
+	struct timespec start;
+	int LockRet = -1;
+
+	if (NULL == bus)
+		return -1;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	OS_THREAD_MUTEX_ACQUIRE_TRY(&bus->mutex, LockRet);
+	if (LockRet == -1)
+	{
+		__sync_fetch_and_add(&bus->stat.try_fail_count, 1);
+		return -1;
+	}
+	PDK_PowerChipBusLockAcquired(bus, &start);
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusTimedLock
+ * Description  : i2c bus pthread lock with deadline
+ * Params       : bus:i2c bus; timeout_ms:max wait time
+ * Return       : 0: Success, -1: Failed or timeout
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipBusTimedLock(power_chip_bus_t *bus, INT32U timeout_ms)
+{
+	struct timespec start, deadline;
+	int ret;
+
+	if (NULL == bus)
+		return -1;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	//pthread_mutex_timedlock只支持CLOCK_REALTIME
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if(deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	ret = pthread_mutex_timedlock(&bus->mutex, &deadline);
+	if (0 != ret)
+	{
+		if (ETIMEDOUT == ret)
+			__sync_fetch_and_add(&bus->stat.timeout_count, 1);
+		return -1;
+	}
+	PDK_PowerChipBusLockAcquired(bus, &start);
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusBlockLock
+ * Description  : i2c bus pthread block lock, print the holder every POWER_CHIP_BUS_LOCK_WARN_TIME
+ * Params       : bus:i2c bus
  * Return       : 0: Success, -1: Failed
  * Author       : TeaFeng
  * Date         : 2024/11/21
 *****************************************************************************/
 
-static int PDK_Irps5401U1MutexBlockLock(void)
+static int PDK_PowerChipBusBlockLock(power_chip_bus_t *bus)
 {
+    struct timespec start, now, deadline;
     int LockRet = -1;
-    OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipIrps5401U1Mutex, LockRet);
-    if (LockRet == -1)
+    bool long_wait = false;
+    if (NULL == bus)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    //分段限时等待，每段超时后打印当前持有者再继续等待，阻塞获取的语义不变
+    while (1)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += POWER_CHIP_BUS_LOCK_WARN_TIME / 1000;
+        deadline.tv_nsec += (POWER_CHIP_BUS_LOCK_WARN_TIME % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        LockRet = pthread_mutex_timedlock(&bus->mutex, &deadline);
+        if (ETIMEDOUT != LockRet)
+            break;
+        if (!long_wait)
+        {
+            long_wait = true;
+            __sync_fetch_and_add(&bus->stat.long_wait_count, 1);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        pthread_mutex_lock(&PowerChipBusStatMutex);
+        TWARN("Power chip bus %s waited %u ms, held by %u(%s) for %u ms\n", bus->i2c_dev,
+            PDK_PowerChipElapsedUs(&start, &now) / 1000, bus->stat.holder_tid, bus->stat.holder,
+            bus->stat.holder_tid ? PDK_PowerChipElapsedUs(&bus->hold_start, &now) / 1000 : 0);
+        pthread_mutex_unlock(&PowerChipBusStatMutex);
+    }
+    if (0 != LockRet)
     {
-        TWARN("Irps5401 Mutex Lock Failed\n");
+        TWARN("Power chip bus %s Mutex Lock Failed\n", bus->i2c_dev);
         return -1;
     }
+    PDK_PowerChipBusLockAcquired(bus, &start);
     return 0;
 }
 
 /*****************************************************************************
- * Function     : PDK_Irps5401U1MutexLock
- * Description  : irps5401 u1 pthread lock 
- * Params       : 
+ * Function     : PDK_PowerChipBusLock
+ * Description  : i2c bus pthread lock, return at once if the bus is in use
+ * Params       : bus:i2c bus
  * Return       : 0: Success, -1: Failed
  * Author       : TeaFeng
  * Date         : 2024/11/21
 *****************************************************************************/
-static int PDK_Irps5401U1MutexLock(void)
+static int PDK_PowerChipBusLock(power_chip_bus_t *bus)
 {
-    int LockRet = -1;
-    OS_THREAD_MUTEX_ACQUIRE_TRY(&PowerChipIrps5401U1Mutex, LockRet);
-    if (LockRet == -1)
+    if (NULL == bus)
+        return -1;
+    if (0 != PDK_PowerChipBusTryLock(bus))
     {
-        TWARN("CDFP Mutex Lock Failed\n");
+        TWARN("Power chip bus %s Mutex Lock Failed\n", bus->i2c_dev);
         return -1;
     }
     return 0;
 }
 
 /*****************************************************************************
- * Function     : PDK_Irps5401U1Unlock
- * Description  : irps5401 u1 release pthread lock 
- * Params       : 
+ * Function     : PDK_PowerChipBusUnlock
+ * Description  : i2c bus release pthread lock, record hold time
+ * Params       : bus:i2c bus
  * Return       : 0: Success, -1: Failed
  * Author       : TeaFeng
  * Date         : 2024/11/21
 *****************************************************************************/
-static int  PDK_Irps5401U1Unlock(void)
+static int  PDK_PowerChipBusUnlock(power_chip_bus_t *bus)
+{
+    struct timespec now;
+    INT32U hold_us;
+
+    if (NULL == bus)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&PowerChipBusStatMutex);
+    hold_us = PDK_PowerChipElapsedUs(&bus->hold_start, &now);
+    bus->stat.hold_total_us += hold_us;
+    if (hold_us > bus->stat.hold_max_us)
+        bus->stat.hold_max_us = hold_us;
+    PDK_PowerChipLockHistAdd(bus->stat.hold_hist, hold_us);
+    bus->stat.holder_tid = 0;
+    memset(bus->stat.holder, 0, sizeof(bus->stat.holder));
+    pthread_mutex_unlock(&PowerChipBusStatMutex);
+    OS_THREAD_MUTEX_RELEASE(&bus->mutex);
+    return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipMuxLock
+ * Description  : unblock pthread lock of the bus which power chip is on
+ * Params       : Devinst:power chip; Lock:0-unlock,other-lock
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipMuxLock(INT8U Devinst, int Lock)
+{
+    if (Lock)
+        return PDK_PowerChipBusLock(PDK_PowerChipBusGet(Devinst));
+
+    return PDK_PowerChipBusUnlock(PDK_PowerChipBusGet(Devinst));
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipMuxBlockLock
+ * Description  : block pthread lock of the bus which power chip is on
+ * Params       : Devinst:power chip; Lock:0-unlock,other-lock
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipMuxBlockLock(INT8U Devinst, int Lock)
+{
+    if (Lock)
+        return PDK_PowerChipBusBlockLock(PDK_PowerChipBusGet(Devinst));
+
+    return PDK_PowerChipBusUnlock(PDK_PowerChipBusGet(Devinst));
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipMuxTimedLock
+ * Description  : lock the bus which power chip is on, give up after timeout_ms,
+ *                unlock with PDK_PowerChipMuxLock(Devinst, 0)
+ * Params       : Devinst:power chip; timeout_ms:max wait time
+ * Return       : 0: Success, -1: Failed or timeout
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipMuxTimedLock(INT8U Devinst, INT32U timeout_ms)
+{
+    return PDK_PowerChipBusTimedLock(PDK_PowerChipBusGet(Devinst), timeout_ms);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusStatGet
+ * Description  : get lock statistics of the bus which power chip is on, chips on the same bus
+ *                share the statistics
+ * Params       : Devinst:power chip; stat:output
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipBusStatGet(INT8U Devinst, power_chip_bus_stat_t *stat)
+{
+    power_chip_bus_t *bus = PDK_PowerChipBusGet(Devinst);
+    struct timespec now;
+
+    if (NULL == bus || NULL == stat)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&PowerChipBusStatMutex);
+    *stat = bus->stat;
+    stat->held_us = stat->holder_tid ? PDK_PowerChipElapsedUs(&bus->hold_start, &now) : 0;
+    pthread_mutex_unlock(&PowerChipBusStatMutex);
+    return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusStatClear
+ * Description  : clear lock statistics of the bus which power chip is on, the holder is kept
+ * Params       : Devinst:power chip
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipBusStatClear(INT8U Devinst)
 {
-    OS_THREAD_MUTEX_RELEASE(&PowerChipIrps5401U1Mutex);
+    power_chip_bus_t *bus = PDK_PowerChipBusGet(Devinst);
+    power_chip_bus_stat_t *stat;
+    INT32U tid;
+    char holder[POWER_CHIP_LOCK_HOLDER_LEN];
+
+    if (NULL == bus)
+        return -1;
+    stat = &bus->stat;
+    pthread_mutex_lock(&PowerChipBusStatMutex);
+    tid = stat->holder_tid;
+    memcpy(holder, stat->holder, sizeof(holder));
+    memset(stat, 0, sizeof(power_chip_bus_stat_t));
+    stat->holder_tid = tid;
+    memcpy(stat->holder, holder, sizeof(holder));
+    pthread_mutex_unlock(&PowerChipBusStatMutex);
     return 0;
 }
 
@@ -257,10 +860,7 @@ static int  PDK_Irps5401U1Unlock(void)
 *****************************************************************************/
 int PDK_Irps5401U1MuxLock(int Lock)
 {
-    if (Lock)
-        return PDK_Irps5401U1MutexLock();
-
-    return PDK_Irps5401U1Unlock();
+    return PDK_PowerChipMuxLock(0, Lock);
 }
 /*****************************************************************************
  * Function     : PDK_Irps5401U1MuxLock
@@ -272,10 +872,7 @@ int PDK_Irps5401U1MuxLock(int Lock)
 *****************************************************************************/
 int PDK_Irps5401MuxBlockLock(int Lock)
 {
-    if (Lock)
-        return PDK_Irps5401U1MutexBlockLock();
-
-    return PDK_Irps5401U1Unlock();
+    return PDK_PowerChipMuxBlockLock(0, Lock);
 }
 
 /*****************************************************************************
@@ -386,6 +983,29 @@ static int PDK_PowertChipGetPage(power_chip_info_t chip_info, INT8U *page)
 }
 
 
+/*****************************************************************************
+ * Function     : PDK_PowerChipInventoryDirty
+ * Description  : mark the cached version info of the chip written to out of date
+ * Params       : chip_info:power chip info struct
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipInventoryDirty(irps5401_info_t *chip_info)
+{
+	INT32U i;
+
+	for(i = 0; i < sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t) && i < POWER_CHIP_COUNT_MAX; i++)
+	{
+		if(board_power_chip_info[i].chip_info.slave_addr == chip_info->slave_addr
+			&& 0 == strcmp(board_power_chip_info[i].chip_info.i2c_dev, chip_info->i2c_dev))
+		{
+			power_chip_inventory_dirty[i] = 1;
+			return;
+		}
+	}
+}
+
 /*****************************************************************************
  * Function     : PDK_Irps5401WriteByteWithPageSet
  * Description  : set page ,and send a byte to irps5401
@@ -399,6 +1019,7 @@ int PDK_Irps5401WriteByteWithPageSet(irps5401_info_t chip_info, INT16U reg, INT8
 	INT8U page = reg / chip_info.page_size;
 	INT8U byte_address = reg % chip_info.page_size;
 	INT8U send_data[2] = {byte_address, data};
+	PDK_PowerChipInventoryDirty(&chip_info);
 	if(0 == PDK_Irps5401SetPage(chip_info, page))
 	{
 		if(sizeof(send_data) == i2c_master_write(chip_info.i2c_dev, chip_info.slave_addr, send_data, sizeof(send_data)))
@@ -466,6 +1087,7 @@ int PDK_Irps5401ReadByteWithPageSet(irps5401_info_t chip_info, INT16U reg, INT8U
 static int PDK_Irps5401WriteByteWithoutPageSet(irps5401_info_t chip_info, INT8U reg, INT8U data)
 {
 	INT8U send_data[2] = {reg, data};
+	PDK_PowerChipInventoryDirty(&chip_info);
 	if(sizeof(send_data) == i2c_master_write(chip_info.i2c_dev, chip_info.slave_addr, send_data, sizeof(send_data)))
 	{
 		return 0;
@@ -531,6 +1153,7 @@ static int PDK_Irps5401WriteWordWithPageSet(irps5401_info_t chip_info, INT16U re
 	INT8U byte_address = reg % chip_info.page_size;
 	
 	INT8U send_data[] = {byte_address, data & 0xff, data >> 8};
+	PDK_PowerChipInventoryDirty(&chip_info);
 	if(0 == PDK_Irps5401SetPage(chip_info, page))
 	{
 		if(sizeof(send_data) == i2c_master_write(chip_info.i2c_dev, chip_info.slave_addr, send_data, sizeof(send_data)))
@@ -564,6 +1187,7 @@ static int PDK_Irps5401WriteWordWithoutPageSet(irps5401_info_t chip_info, INT8U
 		return -1;
 
 	INT8U send_data[2] = {reg, data[0], data[1]};
+	PDK_PowerChipInventoryDirty(&chip_info);
 	if(sizeof(send_data) == i2c_master_write(chip_info.i2c_dev, chip_info.slave_addr,  send_data, sizeof(send_data)))
 	{
 		return 0;
@@ -710,54 +1334,87 @@ static int PDK_Irps5401FWVersionGet(irps5401_info_t chip_info, INT8U *version)
  * Author       : TeaFeng
  * Date         : 2024/11/21
 *****************************************************************************/
-int PDK_PowerChipFWVersionGet(INT8U Devinst, INT8U *FwRevStr, INT16U *ResLen, int BMCInst)
+static int PDK_Irps5401SiliconVersionGet(irps5401_info_t chip_info, INT8U *version)
 {
 	INT8U data = 0;
 
-	if(NULL == FwRevStr)
+	if(NULL == version)
 		return -1;
-	if( Devinst >= POWER_CHIP_COUNT_MAX || Devinst >= sizeof(board_power_chip_info)/sizeof(board_power_chip_info_t))
+
+	if(0 == PDK_Irps5401ReadByteWithPageSet(chip_info, IRPS5401_SILICON_VERSION_REG, &data))
 	{
-		return CC_PARAM_OUT_OF_RANGE;
+		*version = data;
+		return 0;
 	}
-	irps5401_info_t *chip_info = &board_power_chip_info[Devinst].chip_info;
-	if(PDK_Irps5401U1MuxLock(1))return CC_NODE_BUSY;
+	return -1;
+}
 
-	if(0 == PDK_Irps5401FWVersionGet(*chip_info, &data))
+/*****************************************************************************
+ * Function     : PDK_PowerChipInventoryRefresh
+ * Description  : read version info from chip into the cache, the caller holds the lock of the bus
+ * Params       : Devinst:power chip
+ * Return       : 0: Success, -1: Failed, the cache is not changed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipInventoryRefresh(INT8U Devinst)
+{
+	power_chip_inventory_seq_t *s = &power_chip_inventory[Devinst];
+	irps5401_info_t *chip_info = &board_power_chip_info[Devinst].chip_info;
+	power_chip_inventory_t inv;
+	INT32U seq;
+
+	//先清除标记，读取期间的写入会重新标记
+	power_chip_inventory_dirty[Devinst] = 0;
+	if(0 != PDK_Irps5401FWVersionGet(*chip_info, &inv.FwRev)
+		|| 0 != PDK_Irps5401SiliconVersionGet(*chip_info, &inv.silicon_version)
+		|| 0 != PDK_Irps5401ConfWriteLeftGet(*chip_info, &inv.conf_write_left)
+		|| 0 != PDK_Irps5401UserWriteLeftGet(*chip_info, &inv.user_write_left))
 	{
-		PDK_Irps5401U1MuxLock(0);
-		*ResLen = snprintf(FwRevStr, POWER_CHIP_FW_VER_LEN, "V%u.%02u", data>>4, data&0x0f);
-		return CC_NORMAL;
+		power_chip_inventory_dirty[Devinst] = 1;
+		return -1;
 	}
-	PDK_Irps5401U1MuxLock(0);
-	return CC_UNSPECIFIED_ERR;
+	inv.valid = 1;
+	inv.dirty = 0;
+
+	//持有总线锁的写者之间已经互斥，序号改为奇数后再更新
+	seq = s->seq;
+	s->seq = seq + 1;
+	__sync_synchronize();
+	s->inv = inv;
+	__sync_synchronize();
+	s->seq = seq + 2;
+	return 0;
 }
 
 /*****************************************************************************
- * Function     : PDK_PowerChipFWVersionGetWithoutLock
- * Description  : get current firmware version without lock 
- * Params       : chip_info:power chip info struct;version:pointer to version
+ * Function     : PDK_PowerChipInventoryGet
+ * Description  : get cached version info of power chip without any lock or i2c access, it is filled
+ *                in PDK_PowerChipInit and refreshed after each update. dirty is set after the chip is
+ *                written, then the values are those before the write
+ * Params       : Devinst:power chip; inv:output
  * Return       : 0: Success, -1: Failed
  * Author       : TeaFeng
- * Date         : 2024/11/21
+ * Date         : 2026/10/19
 *****************************************************************************/
-int PDK_PowerChipFWVersionGetWithoutLock(INT8U Devinst, INT8U *FwRevStr, INT16U *ResLen, int BMCInst)
+int PDK_PowerChipInventoryGet(INT8U Devinst, power_chip_inventory_t *inv)
 {
-	INT8U data = 0;
+	power_chip_inventory_seq_t *s;
+	INT32U seq;
 
-	if(NULL == FwRevStr)
+	if(NULL == inv || Devinst >= POWER_CHIP_COUNT_MAX)
 		return -1;
-	if( Devinst >= POWER_CHIP_COUNT_MAX || Devinst >= sizeof(board_power_chip_info)/sizeof(board_power_chip_info_t))
-	{
-		return CC_PARAM_OUT_OF_RANGE;
-	}
-	irps5401_info_t *chip_info = &board_power_chip_info[Devinst].chip_info;
-	if(0 == PDK_Irps5401FWVersionGet(*chip_info, &data))
+
+	s = &power_chip_inventory[Devinst];
+	do
 	{
-		*ResLen = snprintf(FwRevStr, POWER_CHIP_FW_VER_LEN, "V%u.%02u", data>>4, data&0x0f);
-		return CC_NORMAL;
-	}
-	return CC_UNSPECIFIED_ERR;
+		seq = s->seq;
+		__sync_synchronize();
+		memcpy(inv, &s->inv, sizeof(power_chip_inventory_t));
+		__sync_synchronize();
+	}while((seq & 1) || seq != s->seq);
+	inv->dirty = power_chip_inventory_dirty[Devinst];
+	return 0;
 }
 
 /*****************************************************************************
@@ -768,22 +1425,77 @@ int PDK_PowerChipFWVersionGetWithoutLock(INT8U Devinst, INT8U *FwRevStr, INT16U
  * Author       : TeaFeng
  * Date         : 2024/11/21
 *****************************************************************************/
-static int PDK_Irps5401SiliconVersionGet(irps5401_info_t chip_info, INT8U *version)
+int PDK_PowerChipFWVersionGet(INT8U Devinst, INT8U *FwRevStr, INT16U *ResLen, int BMCInst)
 {
 	INT8U data = 0;
 
-	if(NULL == version)
+	if(NULL == FwRevStr)
 		return -1;
-
-	if(0 == PDK_Irps5401ReadByteWithPageSet(chip_info, IRPS5401_SILICON_VERSION_REG, &data))
+	if( Devinst >= POWER_CHIP_COUNT_MAX || Devinst >= sizeof(board_power_chip_info)/sizeof(board_power_chip_info_t))
 	{
-		*version = data;
-		return 0;
+		return CC_PARAM_OUT_OF_RANGE;
 	}
-	return -1;
-}
+	power_chip_inventory_t inv;
 
-/*****************************************************************************
+	//缓存有效时不访问总线；芯片被写过后尝试重新读取，总线被占用（如正在升级）时仍返回写入前的版本
+	PDK_PowerChipInventoryGet(Devinst, &inv);
+	if(!inv.valid || inv.dirty)
+	{
+		if(PDK_PowerChipMuxLock(Devinst, 1))
+		{
+			if(!inv.valid)
+				return CC_NODE_BUSY;
+		}
+		else
+		{
+			if(0 != PDK_PowerChipInventoryRefresh(Devinst) && !inv.valid)
+			{
+				PDK_PowerChipMuxLock(Devinst, 0);
+				return CC_UNSPECIFIED_ERR;
+			}
+			PDK_PowerChipMuxLock(Devinst, 0);
+			PDK_PowerChipInventoryGet(Devinst, &inv);
+		}
+	}
+	data = inv.FwRev;
+	*ResLen = snprintf(FwRevStr, POWER_CHIP_FW_VER_LEN, "V%u.%02u", data>>4, data&0x0f);
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFWVersionGetWithoutLock
+ * Description  : get current firmware version without lock 
+ * Params       : chip_info:power chip info struct;version:pointer to version
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+int PDK_PowerChipFWVersionGetWithoutLock(INT8U Devinst, INT8U *FwRevStr, INT16U *ResLen, int BMCInst)
+{
+	INT8U data = 0;
+
+	if(NULL == FwRevStr)
+		return -1;
+	if( Devinst >= POWER_CHIP_COUNT_MAX || Devinst >= sizeof(board_power_chip_info)/sizeof(board_power_chip_info_t))
+	{
+		return CC_PARAM_OUT_OF_RANGE;
+	}
+	power_chip_inventory_t inv;
+
+	//调用者已持有总线锁，缓存过期时直接重新读取
+	PDK_PowerChipInventoryGet(Devinst, &inv);
+	if(!inv.valid || inv.dirty)
+	{
+		if(0 != PDK_PowerChipInventoryRefresh(Devinst) && !inv.valid)
+			return CC_UNSPECIFIED_ERR;
+		PDK_PowerChipInventoryGet(Devinst, &inv);
+	}
+	data = inv.FwRev;
+	*ResLen = snprintf(FwRevStr, POWER_CHIP_FW_VER_LEN, "V%u.%02u", data>>4, data&0x0f);
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
  * Function     : PDK_IrpsUpdatePrepareCommon
  * Description  : Do preparation for user and conf section update 
  * Params       : chip:power chip update info struct
@@ -882,18 +1594,18 @@ static int PDK_IrpsUpdateUserSectionPrepare(power_chip_update_t *chip)
 
 
 /*****************************************************************************
- * Function     : PDK_IrpsUpdateConfSectionPost
- * Description  : Do preparation for user section update 
+ * Function     : PDK_IrpsUpdateConfSectionCommit
+ * Description  : send NVM command to program conf section registers into OTP,
+ *                PDK_IrpsUpdateConfSectionPoll should be called POWER_CHIP_PROGRAM_TIME later
  * Params       : chip:power chip update info struct
- * Return       : 0: Success, -1: Failed
+ * Return       : IPMI Completion Code
  * Author       : TeaFeng
  * Date         : 2024/11/21
 *****************************************************************************/
-static int PDK_IrpsUpdateConfSectionPost(power_chip_update_t *chip)
+static int PDK_IrpsUpdateConfSectionCommit(power_chip_update_t *chip)
 {
 	INT8U image_number = 0; 
 	INT16U send_data = 0;
-	INT8U read_data = 0;
 
 	if(NULL == chip)
 		return -1;
@@ -905,7 +1617,24 @@ static int PDK_IrpsUpdateConfSectionPost(power_chip_update_t *chip)
 		TWARN("Update power chip %d fail,restore CONF value to regiser map fail.\n", chip->chip_inst);
 		return CC_BUS_ERR;
 	}
-	usleep(POWER_CHIP_PROGRAM_TIME);		//等待寄存器写入
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_IrpsUpdateConfSectionPoll
+ * Description  : check result of programming conf section
+ * Params       : chip:power chip update info struct
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static int PDK_IrpsUpdateConfSectionPoll(power_chip_update_t *chip)
+{
+	INT8U read_data = 0;
+
+	if(NULL == chip)
+		return -1;
+
 	if(0 != PDK_Irps5401ReadByteWithPageSet(chip->chip, IRPS5401_NVM_CMD_REG_H, &read_data))
 	{
 		TWARN("Update power chip %d fail, read CONF program status fail.\n", chip->chip_inst);
@@ -937,18 +1666,18 @@ static int PDK_IrpsUpdateConfSectionPost(power_chip_update_t *chip)
 }
 
 /*****************************************************************************
- * Function     : PDK_IrpsUpdateUserSectionPost
- * Description  : Do preparation for user section update 
+ * Function     : PDK_IrpsUpdateUserSectionCommit
+ * Description  : send NVM command to program user section registers into OTP,
+ *                PDK_IrpsUpdateUserSectionPoll should be called POWER_CHIP_PROGRAM_TIME later
  * Params       : chip:power chip update info struct
- * Return       : 0: Success, -1: Failed
+ * Return       : IPMI Completion Code
  * Author       : TeaFeng
  * Date         : 2024/11/21
 *****************************************************************************/
-static int PDK_IrpsUpdateUserSectionPost(power_chip_update_t *chip)
+static int PDK_IrpsUpdateUserSectionCommit(power_chip_update_t *chip)
 {
 	INT8U image_number = 0; 
 	INT16U send_data = 0;
-	INT8U read_data = 0;
 
 	if(NULL == chip)
 		return -1;
@@ -960,7 +1689,24 @@ static int PDK_IrpsUpdateUserSectionPost(power_chip_update_t *chip)
 		TWARN("Update power chip %d fail,restore User value to regiser map fail.\n", chip->chip_inst);
 		return CC_BUS_ERR;
 	}
-	usleep(POWER_CHIP_PROGRAM_TIME);		//等待寄存器写入
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_IrpsUpdateUserSectionPoll
+ * Description  : check result of programming user section
+ * Params       : chip:power chip update info struct
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static int PDK_IrpsUpdateUserSectionPoll(power_chip_update_t *chip)
+{
+	INT8U read_data = 0;
+
+	if(NULL == chip)
+		return -1;
+
 	if(0 != PDK_Irps5401ReadByteWithPageSet(chip->chip, IRPS5401_NVM_CMD_REG_H, &read_data))
 	{
 		TWARN("Update power chip %d fail, read User program status fail.\n", chip->chip_inst);
@@ -993,21 +1739,18 @@ static int PDK_IrpsUpdateUserSectionPost(power_chip_update_t *chip)
 	return CC_NORMAL;
 }
 
-static void PDK_SetIrps5401RegSectionEnable(power_chip_reg_loop_section loop_section, bool En)
+static void PDK_SetIrps5401RegSectionEnable(power_chip_update_t *chip, power_chip_reg_loop_section loop_section, bool En)
 {
-	INT16U i;
-	for(i = 0; i < sizeof(irps5401_reg_section)/sizeof(power_chip_reg_section_info_t); i++)
-	{
-		if(irps5401_reg_section[i].reg_section == loop_section)
-		{
-			irps5401_reg_section[i].loop_en = En;
-		}
-	}
+	//只记录在本次升级中，同时升级的多个芯片互不影响
+	if(En)
+		chip->reg_section_disable &= ~(1 << loop_section);
+	else
+		chip->reg_section_disable |= (1 << loop_section);
 }
 
 /*****************************************************************************
  * Function     : PDK_UpdateIrps5401RegSectionEnableinfo
- * Description  : set irps5401_reg_section's loop_en member
+ * Description  : record disabled switchers of the chip in reg_section_disable
  * Params       : chip:power chip update info struct
  * Return       : 0: Success, -1: Failed
  * Author       : TeaFeng
@@ -1028,18 +1771,19 @@ static int PDK_UpdateIrps5401RegSectionEnableinfo(power_chip_update_t *chip)
 		TWARN("Update power chip %d fail, read combine register fail when verifying.\n", chip->chip_inst);
 		return CC_BUS_ERR;
 	}
-	if(read & (1 << 4))PDK_SetIrps5401RegSectionEnable(POWER_REG_LOOP_LDO_SECTION, false);
-	if(read & (1 << 3))PDK_SetIrps5401RegSectionEnable(POWER_REG_LOOP_D_SECTION, false);
-	if(read & (1 << 2))PDK_SetIrps5401RegSectionEnable(POWER_REG_LOOP_C_SECTION, false);
-	if(read & (1 << 1))PDK_SetIrps5401RegSectionEnable(POWER_REG_LOOP_B_SECTION, false);
-	if(read & (1 << 0))PDK_SetIrps5401RegSectionEnable(POWER_REG_LOOP_A_SECTION, false);
+	chip->reg_section_disable = 0;
+	if(read & (1 << 4))PDK_SetIrps5401RegSectionEnable(chip, POWER_REG_LOOP_LDO_SECTION, false);
+	if(read & (1 << 3))PDK_SetIrps5401RegSectionEnable(chip, POWER_REG_LOOP_D_SECTION, false);
+	if(read & (1 << 2))PDK_SetIrps5401RegSectionEnable(chip, POWER_REG_LOOP_C_SECTION, false);
+	if(read & (1 << 1))PDK_SetIrps5401RegSectionEnable(chip, POWER_REG_LOOP_B_SECTION, false);
+	if(read & (1 << 0))PDK_SetIrps5401RegSectionEnable(chip, POWER_REG_LOOP_A_SECTION, false);
 	//D有特殊判断
-	if(read1 & (1 << 4))PDK_SetIrps5401RegSectionEnable(POWER_REG_LOOP_D_SECTION, false);
+	if(read1 & (1 << 4))PDK_SetIrps5401RegSectionEnable(chip, POWER_REG_LOOP_D_SECTION, false);
 	return 0;
 	
 }
 
-static bool PDK_IfRegNeedVerified(INT16U reg_addr)
+static bool PDK_IfRegNeedVerified(power_chip_update_t *chip, INT16U reg_addr)
 {
 	INT16U i = 0;
 	bool en = false;
@@ -1053,7 +1797,7 @@ static bool PDK_IfRegNeedVerified(INT16U reg_addr)
 				en = true;
 				break;
 			}
-			else  if(irps5401_reg_section[i].loop_en == true)
+			else  if(irps5401_reg_section[i].loop_en == true && !(chip->reg_section_disable & (1 << irps5401_reg_section[i].reg_section)))
 			{
 				en = true;
 				break;
@@ -1076,7 +1820,8 @@ static bool PDK_IfRegNeedVerified(INT16U reg_addr)
 }
 /*****************************************************************************
  * Function     : PDK_Irps5401VerifyPrepare
- * Description  : prepare to verify irps5401 register after update user section
+ * Description  : prepare to verify irps5401 register after update user section, send NVM command to
+ *                reload user section, PDK_Irps5401VerifyPoll should be called POWER_CHIP_PROGRAM_TIME later
  * Params       : chip:power chip update info struct;verify_reg_count:point,calculate the count of register need to be verified
  * Return       : 0: Success, -1: Failed
  * Author       : TeaFeng
@@ -1086,10 +1831,10 @@ static int PDK_Irps5401VerifyPrepare(power_chip_update_t *chip, INT16U *verify_r
 {
 	INT16U data = 0;
 	INT8U current_image = 0;
-	INT8U read = 0;
 	irps5401_section_info *p_section_info = NULL;
 	power_chip_data_t *p_chip_data = NULL;
 	INT16U data_count = 0;
+	INT32U i, rec;
 	otp_section section = POWER_CHIP_SECTION_USER;		//只能校验user分区，conf分区重新 powerup后才会更新
 
 	if(NULL == chip)
@@ -1107,25 +1852,21 @@ static int PDK_Irps5401VerifyPrepare(power_chip_update_t *chip, INT16U *verify_r
 
 	//计算需要校验的寄存器的数量
 	p_chip_data = (power_chip_data_t *)chip->image_buf;
-	for(p_section_info = (irps5401_section_info *)chip->section_info; p_section_info < (INT8U *)chip->section_info + sizeof(irps5401_section_info) * chip->section_count; p_section_info++)
+	p_section_info = (irps5401_section_info *)chip->section_info;
+	for(i = 0; i < chip->section_count; i++)
 	{
-		if(p_section_info->section != section)
+		if(p_section_info[i].section != section)
 		{
 			continue;
 		}
 
-		for(; p_chip_data < chip->image_buf + chip->imgSize; p_chip_data++)
+		for(rec = chip->sec_index[i].start; rec < chip->sec_index[i].end; rec++)
 		{
-			if((p_chip_data->reg >= p_section_info->sec_start) && (p_chip_data->reg <= p_section_info->sec_end))
+			if((p_chip_data[rec].reg >= p_section_info[i].sec_start) && (p_chip_data[rec].reg <= p_section_info[i].sec_end))
 			{
-				if(PDK_IfRegNeedVerified(p_chip_data->reg))
+				if(PDK_IfRegNeedVerified(chip, p_chip_data[rec].reg))
 				data_count++;
 			}
-			if(p_chip_data->reg == p_section_info->sec_end)
-			{
-				p_chip_data++;		//直接前进到下一个地址，减少一次比对
-				break;
-			}
 		}
 	}
 	*verify_reg_count = data_count;
@@ -1144,18 +1885,48 @@ static int PDK_Irps5401VerifyPrepare(power_chip_update_t *chip, INT16U *verify_r
 		TWARN("Update power chip %d fail, set NVM_COMMAND register fail when verifying.\n", chip->chip_inst);
 		return CC_BUS_ERR;
 	}
-	usleep(POWER_CHIP_PROGRAM_TIME);
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_Irps5401VerifyPoll
+ * Description  : check if the NVM command sent by PDK_Irps5401VerifyPrepare is done,
+ *                called POWER_CHIP_PROGRAM_TIME after it
+ * Params       : chip:power chip update info struct; done:output, NVM command is done
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static int PDK_Irps5401VerifyPoll(power_chip_update_t *chip, bool *done)
+{
+	INT8U read = 0;
 
 	if(0 != PDK_Irps5401ReadByteWithPageSet(chip->chip, IRPS5401_NVM_CMD_REG_H, &read))
 	{
 		TWARN("Update power chip %d fail, read NVM_COMMAND register fail when verifying.\n", chip->chip_inst);
 		return CC_BUS_ERR;
 	}
+	*done = true;
 	if(!(read & 0x80))		//status[7] = 1:done,0;progress
 	{
 		TWARN("Update power chip %d, read NVM_COMMAND status = 0x%x.\n", chip->chip_inst,read);
-		usleep(POWER_CHIP_PROGRAM_TIME);
+		*done = false;
 	}
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_Irps5401VerifyCrcCheck
+ * Description  : check CRC error flag of user section after PDK_Irps5401VerifyPoll
+ * Params       : chip:power chip update info struct
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static int PDK_Irps5401VerifyCrcCheck(power_chip_update_t *chip)
+{
+	INT8U read = 0;
+
 	if(0 != PDK_Irps5401ReadByteWithPageSet(chip->chip, IRPS5401_NVRAM_IMAGE_REG, &read))
 	{
 		TWARN("Update power chip %d fail, read NVRAM_IMAGE register fail when verifying.\n", chip->chip_inst);
@@ -1172,345 +1943,695 @@ static int PDK_Irps5401VerifyPrepare(power_chip_update_t *chip, INT16U *verify_r
 }
 
 /*****************************************************************************
- * Function     : PDK_Irps5401Verify
- * Description  : verify irps5401 register after update user section
+ * Function     : PDK_Irps5401RestorePrepare
+ * Description  : send NVM command to reload user section from the last programmed user image, so that
+ *                registers written by a cancelled update are dropped. PDK_Irps5401VerifyPoll should
+ *                be called POWER_CHIP_PROGRAM_TIME later
  * Params       : chip:power chip update info struct
- * Return       : 0: Success, -1: Failed
+ * Return       : IPMI Completion Code
  * Author       : TeaFeng
- * Date         : 2024/11/21
+ * Date         : 2026/10/19
 *****************************************************************************/
-static int PDK_Irps5401Verify(power_chip_update_t *chip)
+static int PDK_Irps5401RestorePrepare(power_chip_update_t *chip)
 {
-	INT8U reg_value[IRPS5401_REG_END - IRPS5401_REG_START + 1];
-	INT8U last_page = 0,current_page = 0;
-	INT16U	reg;
-	int ret = 0;
-	INT16U verify_reg_count = 0, error_count = 0, current_count = 0;
-	irps5401_section_info *p_section_info = NULL;
-	power_chip_data_t *p_chip_data = NULL;
-	otp_section section = POWER_CHIP_SECTION_USER;		//只能校验user分区，conf分区重新 powerup后才会更新
+	INT16U data = 0;
+	INT8U write_left = 0;
 
-	if(NULL == chip)
+	//取消发生在提交之前，剩余次数未变化，已使用的最后一个image即当前生效的配置
+	if(0 != PDK_Irps5401UserWriteLeftGet(chip->chip, &write_left))
 	{
-		TWARN("Update power chip fail,illegal parameter [*chip].\n");
-		return CC_PARAM_OUT_OF_RANGE;
+		TWARN("Power chip %d get left written times fail when restoring.\n", chip->chip_inst);
+		return CC_BUS_ERR;
 	}
-	
-	chip->progress = 0;
-	chip->status = POWER_FW_UPDATE_STATUS_VERIFY;
-
-	ret = PDK_Irps5401VerifyPrepare(chip, &verify_reg_count);
-	if(ret != CC_NORMAL)return ret;
-	if(0 == verify_reg_count)
+	if(write_left >= IRPS5401_USER_WRITE_MAX_COUNT)
 	{
-		TWARN("Update power chip %d fail, verify_reg_count = 0 .\n", chip->chip_inst);
-		return CC_UNSPECIFIED_ERR;
+		TWARN("Power chip %d has no programmed user image to reload.\n", chip->chip_inst);
+		return CC_ERR_FLASH_WRITE;
 	}
-	chip->progress = VERIFY_PROGRESS_PREPARE;
-	//读取寄存器
-	memset(reg_value, 0, sizeof(reg_value));
-	if(0 != PDK_Irps5401SetPage(chip->chip, 0))
+	data = ((IRPS5401_USER_WRITE_MAX_COUNT - write_left - 1) << 8) | 0x0041;
+	if(0 != PDK_Irps5401WriteWordWithPageSet(chip->chip, IRPS5401_NVM_CMD_REG, data))
 	{
-		TWARN("Update power chip %d fail, set page to page 0 fail.\n", chip->chip_inst);
+		TWARN("Power chip %d set NVM_COMMAND register fail when restoring.\n", chip->chip_inst);
 		return CC_BUS_ERR;
 	}
-	last_page = 0;
-	for(reg = IRPS5401_REG_START; reg <= IRPS5401_REG_END; reg++)
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipSigSize
+ * Description  : signature length of the signature type in image header
+ * Params       : SigType       -- SigType in firmware image header
+ * Return       : signature bytes length, 0 if the type is not supported
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static INT32U PDK_PowerChipSigSize(INT8U SigType)
+{
+	switch(SigType)
 	{
-		current_page = reg / IRPS5401_PAGE_SIZE;
-		if(last_page != current_page)
-		{
-			PDK_Irps5401SetPage(chip->chip, current_page);
-			last_page = current_page;
-		}
-		PDK_Irps5401ReadByteWithoutPageSet(chip->chip, reg, &reg_value[reg]);
-		chip->progress = VERIFY_PROGRESS_PREPARE + (reg - IRPS5401_REG_START)  * (VERIFY_PROGRESS_REG_READ - VERIFY_PROGRESS_PREPARE) / (IRPS5401_REG_END - IRPS5401_REG_START) ;
-		PRINT("Verify progress %d ,error count = %d.\n", chip->progress, error_count);
+	case POWER_CHIP_SIG_TYPE_RSA1024:
+		return POWER_CHIP_IMG_DIGEST_SIGN_SIZE;
+	case POWER_CHIP_SIG_TYPE_ED25519:
+		return POWER_CHIP_IMG_ED25519_SIGN_SIZE;
+	default:
+		return 0;
 	}
+}
 
-	chip->progress = VERIFY_PROGRESS_REG_READ;
-	PRINT("Verify progress %d ,error count = %d.\n", chip->progress, error_count);
-
-	p_chip_data = (power_chip_data_t *)chip->image_buf;
-	for(p_section_info = (irps5401_section_info *)chip->section_info; p_section_info < (INT8U *)chip->section_info + sizeof(irps5401_section_info) * chip->section_count; p_section_info++)
+/*****************************************************************************
+ * Function     : PDK_PowerChipEd25519Verify
+ * Description  : verify Ed25519 signature of firmware image
+ * Params       : *Data         -- signed data
+ *                Size          -- signed data bytes length
+ *                *Sign         -- POWER_CHIP_IMG_ED25519_SIGN_SIZE bytes signature
+ * Return       : 0 on success, -1 on failure
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipEd25519Verify(INT8U *Data, INT32U Size, INT8U *Sign)
+{
+	EVP_MD_CTX *ctx = NULL;
+	FILE *fp = NULL;
+	int LockRet = -1;
+	int ret = -1;
+
+	//公钥只在第一次校验时读取，读取失败时下次再试，公钥可能在BMC运行后才安装
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipEd25519KeyMutex, LockRet);
+	if (LockRet == -1)
+		return -1;
+	if (NULL == power_chip_ed25519_key)
 	{
-		if(p_section_info->section != section)
+		fp = fopen(POWER_CHIP_IMG_SIGN_ED25519_PUBLIC_FILE, "r");
+		if (NULL != fp)
 		{
-			continue;
+			power_chip_ed25519_key = PEM_read_PUBKEY(fp, NULL, NULL, NULL);
+			fclose(fp);
 		}
-
-		for(; p_chip_data < chip->image_buf + chip->imgSize; p_chip_data++)
+		if (NULL != power_chip_ed25519_key && EVP_PKEY_ED25519 != EVP_PKEY_id(power_chip_ed25519_key))
 		{
-			if((p_chip_data->reg >= p_section_info->sec_start) && (p_chip_data->reg <= p_section_info->sec_end))
-			{
-				if(PDK_IfRegNeedVerified(p_chip_data->reg))
-				{
-					if((reg_value[p_chip_data->reg] ^ p_chip_data->value) & p_chip_data->mask)
-					{
-						error_count++;
-						PRINT("Error reg = 0x%04x, image value = 0x%02x, read value = 0x%02x, mask = 0x%02x \n", p_chip_data->reg, p_chip_data->value, reg_value[p_chip_data->reg], p_chip_data->mask);
-					}
-					current_count++;
-				}
-			}
-			if(p_chip_data->reg == p_section_info->sec_end)
-			{
-				p_chip_data++;		//直接前进到下一个地址，减少一次比对
-				break;
-			}
+			EVP_PKEY_free(power_chip_ed25519_key);
+			power_chip_ed25519_key = NULL;
 		}
-		chip->progress = VERIFY_PROGRESS_REG_READ + current_count * (VERIFY_PROGRESS_REG_COMPARE - VERIFY_PROGRESS_REG_READ) /verify_reg_count ;
-		//chip->progress = current_count * 100 / verify_reg_count;
-		PRINT("Verify progress %d ,error count = %d.\n", chip->progress, error_count);
 	}
-	chip->progress = VERIFY_PROGRESS_REG_COMPARE;
-	if(error_count == 0)
+	OS_THREAD_MUTEX_RELEASE(&PowerChipEd25519KeyMutex);
+	if (NULL == power_chip_ed25519_key)
 	{
-		chip->status = POWER_FW_UPDATE_STATUS_SUCCESS;
+		TWARN("Power chip Ed25519 public key %s load failed", POWER_CHIP_IMG_SIGN_ED25519_PUBLIC_FILE);
+		return -1;
 	}
-	else
+
+	//Ed25519直接对数据签名，不需要摘要算法
+	ctx = EVP_MD_CTX_new();
+	if (NULL == ctx)
+		return -1;
+	if (1 == EVP_DigestVerifyInit(ctx, NULL, NULL, NULL, power_chip_ed25519_key)
+		&& 1 == EVP_DigestVerify(ctx, Sign, POWER_CHIP_IMG_ED25519_SIGN_SIZE, Data, Size))
 	{
-		chip->status = POWER_FW_UPDATE_STATUS_FAIL;
+		ret = 0;
 	}
-	return 0;
+	EVP_MD_CTX_free(ctx);
+	return ret;
 }
 
-
 /*****************************************************************************
- * Function     : PDK_Irps5401Update
- * Description  : Update irps5401 
- * Params       : chip:power chip update info struct
- * Return       : 0: Success, -1: Failed
+ * Function     : PDK_PowerChipFwImageVerify
+ * Description  : Power chip Firmware Image Verify
+ * Params       : *ImgData      -- Firmware Image Data
+ *                ImgSize       -- Firmware Image Data bytes length
+ * Return       : IPMI Completion Code
  * Author       : TeaFeng
- * Date         : 2024/11/21
+ * Date         : 2024/11/27
 *****************************************************************************/
-static int PDK_Irps5401Update(power_chip_update_t *chip)
+int PDK_PowerChipFwImageVerify(INT8U *ImgData, INT32U ImgSize )
 {
-	irps5401_section_info *p_section_info = NULL;
-	power_chip_data_t *p_chip_data = NULL;
-	INT32U data_count = 0, written_count = 0;
-	char *section_name = NULL;
-	otp_section section;
-	power_fw_update_stage stage;
-	int (*PowerChipPrepareFunction)(power_chip_update_t *);
-	int (*PowerChipPostFunction)(power_chip_update_t *);
-	int ret = 0;
+    power_chip_hd_t *ImgHdr = (power_chip_hd_t *)ImgData;
+    INT32U FwSize = 0;
+    INT32U SignSize = 0;
+    INT8U *DigestSign = NULL;
+    INT8U Signature[FW_IDENTITY_LEN] = {0};
 
-	if(NULL == chip)
-	{
-		TWARN("Update power chip fail,illegal parameter [*chip].\n");
-		return CC_ERR_SETUP_FW_UPDATE;
-	}
+    if (NULL == ImgData || ImgSize < sizeof(power_chip_hd_t) + POWER_CHIP_IMG_SIGN_SIZE_MIN)
+    {
+        TWARN("Power chip Firmware Image Size Invalid [%x]", ImgSize);
+        return CC_FILE_SIZE_INVALID;
+    }
 
-	if(chip->stage_mask & POWER_CHIP_SECTION_CONF)
-	{
-		section_name = "conf";
-		section = POWER_CHIP_SECTION_CONF;
-		stage = POWER_FW_UPDATE_STAGE_CONF;
-		PowerChipPrepareFunction = PDK_IrpsUpdateConfSectionPrepare;
-		PowerChipPostFunction = PDK_IrpsUpdateConfSectionPost;
-	}
-	else if(chip->stage_mask & POWER_CHIP_SECTION_USER)
+    if (ImgHdr->HdrCRC32 != CalculateCRC32(ImgData, sizeof(power_chip_hd_t) - 4))
+    {
+        TWARN("Power chip Firmware Image Header CRC32 verify failed");
+        return CC_ERR_FW_IMG_HDR_CRC;
+    }
+
+    //标志不足FW_IDENTITY_LEN时后面补0，与txt2bin_verify一样按补0后的FW_IDENTITY_LEN字节完整比较
+    memcpy(Signature, POWER_CHIP_FW_IMG_SIGN, strlen(POWER_CHIP_FW_IMG_SIGN));
+    if (0 != memcmp(Signature, ImgHdr->Signature, FW_IDENTITY_LEN))
+    {
+        TWARN("Power chip Firmware Image Header Signature Invalid");
+        return CC_ERR_FW_IMG_SIGNATURE;
+    }
+	
+	if (0 != memcmp(DEVMODEL_MYDEV_POWER, ImgHdr->DevModel, strlen(DEVMODEL_MYDEV_POWER)))
 	{
-		section_name = "user";
-		section = POWER_CHIP_SECTION_USER;
-		stage = POWER_FW_UPDATE_STAGE_USER;
-		PowerChipPrepareFunction = PDK_IrpsUpdateUserSectionPrepare;
-		PowerChipPostFunction = PDK_IrpsUpdateUserSectionPost;
+		TWARN("Power chip Firmware Image Header Devmodel Invalid");
+		return CC_ERR_FW_IMG_MODEL;
 	}
-	else
+
+    //签名长度由SigType决定，不支持的签名类型无法校验
+    SignSize = PDK_PowerChipSigSize(ImgHdr->SigType);
+    if (0 == SignSize)
+    {
+        TWARN("Power chip Firmware Image Signature Type %u Invalid", ImgHdr->SigType);
+        return CC_ERR_HASH_SIGNED_VERIFY;
+    }
+
+    //镜像可能直接来自IPMI/Redfish的内存，先检查偏移，避免相加溢出后越界访问
+    if (ImgHdr->ImgOffset < sizeof(power_chip_hd_t) || ImgHdr->ImgOffset > ImgSize
+        || ImgSize != (ImgHdr->ImgOffset + ImgHdr->ImgSize + SignSize))
+    {
+        TWARN("Power chip Firmware Image Size Invalid [%x + %x + %x != %x]", ImgHdr->ImgOffset, ImgHdr->ImgSize, SignSize, ImgSize);
+        return CC_FILE_SIZE_INVALID;
+    }
+
+    if (ImgHdr->ImgCRC32 != CalculateCRC32(&ImgData[ImgHdr->ImgOffset], ImgHdr->ImgSize))
+    {
+        TWARN("Power chip Firmware Image Data CRC32 verify failed");
+        return CC_FILE_CHKSUM_EER;
+    }
+
+    /* Firmware Image Digest Signature Verify */
+    FwSize = ImgSize - SignSize;
+    DigestSign = &ImgData[FwSize];
+    if ((POWER_CHIP_SIG_TYPE_ED25519 == ImgHdr->SigType)
+        ? (PDK_PowerChipEd25519Verify(ImgData, FwSize, DigestSign) < 0)
+        : (FwImageDigestSignVerify(POWER_CHIP_IMG_SIGN_PUBLIC_FILE, ImgData, FwSize, DigestSign) < 0))
+    {
+        TWARN("Power chip Firmware Image Digest Signature verification failed");
+        return CC_ERR_HASH_SIGNED_VERIFY;
+    }
+
+    return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBoardMatch
+ * Description  : find board power chip by firmware submodel
+ * Params       : SubModel      -- SubModel in firmware image header
+ * Return       : index of board_power_chip_info, count of board_power_chip_info if not found
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static INT8U PDK_PowerChipBoardMatch(INT8U *SubModel)
+{
+	INT8U i;
+
+	for(i = 0; i < sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t); i++)
 	{
-		TWARN("Update power chip %d fail,section = [0x%x] is illegal.\n", chip->chip_inst,chip->stage_mask);
-		return CC_ERR_SETUP_FW_UPDATE;
+		if(0 == memcmp(board_power_chip_info[i].SubModel, SubModel, strlen(board_power_chip_info[i].SubModel)))
+		{
+			return i;
+		}
 	}
+	return sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t);
+}
 
-	if(NULL == chip->image_buf || NULL == chip->section_info)
+//差分镜像的基线摘要包含的寄存器：page寄存器和verify_ignored_reg除外
+static bool PDK_PowerChipBaseRegDigested(INT32U reg)
+{
+	INT32U i;
+
+	if(IRPS5401_PAGE_REG == (reg & 0xFF))
+		return false;
+	for(i = 0; i < sizeof(verify_ignored_reg) / sizeof(INT16U); i++)
 	{
-		TWARN("Update power chip %d %s section fail,illegal parameter.\n", chip->chip_inst, section_name);
-		return CC_ERR_SETUP_FW_UPDATE;
+		if(reg == verify_ignored_reg[i])
+			return false;
 	}
-	//检测可升级的section中是否存在当前要升级的分区，如果不存在，则退出避免浪费升级次数
-	//检测固件中是否存在可升级分区的地址，并计算所需要写入的寄存器的数量，方便后续计算升级进度
-	//固件文件中存在多余的、不在升级范围内的寄存器地址，因此不能直接使用固件文件中的寄存器数量当做总的写入数据量
-	p_chip_data = (power_chip_data_t *)chip->image_buf;
-	for(p_section_info = (irps5401_section_info *)chip->section_info; p_section_info < (INT8U *)chip->section_info + sizeof(irps5401_section_info) * chip->section_count; p_section_info++)
+	return true;
+}
+
+//差分镜像的基线摘要包含的寄存器数量，即镜像中基线掩码的字节数
+static INT32U PDK_PowerChipBaseRegCount(INT8U chip_inst, power_chip_sec_index_t *sec_index)
+{
+	irps5401_section_info *p_section_info = (irps5401_section_info *)board_power_chip_info[chip_inst].section_info;
+	INT32U i, reg, count = 0;
+
+	for(i = 0; i < board_power_chip_info[chip_inst].section_count; i++)
 	{
-		if(p_section_info->section != section)
-		{
+		if(0 == sec_index[i].count)
 			continue;
+		for(reg = p_section_info[i].sec_start; reg <= p_section_info[i].sec_end; reg++)
+		{
+			if(PDK_PowerChipBaseRegDigested(reg))
+				count++;
 		}
+	}
+	return count;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipSecIndexBuild
+ * Description  : record where the data of every otp section page lies in the image,
+ *                so that update and verify do not need to search the image again
+ * Params       : image_buf:register data of image; imgSize:bytes of register data;
+ *                section_info:otp section page info; section_count:count of section_info;
+ *                sec_index:output, one entry for each section_info;
+ *                sparse:records of delta image, the end address of a section may be absent
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipSecIndexBuild(INT8U *image_buf, INT32U imgSize, void *section_info, INT32U section_count, power_chip_sec_index_t *sec_index, bool sparse)
+{
+	irps5401_section_info *p_section_info = (irps5401_section_info *)section_info;
+	power_chip_data_t *p_chip_data = (power_chip_data_t *)image_buf;
+	INT32U rec_count = imgSize / sizeof(power_chip_data_t);
+	INT32U done_mask = 0;
+	INT32U i, j, rec;
+
+	if(NULL == image_buf || NULL == section_info || NULL == sec_index || section_count > POWER_CHIP_SECTION_MAX)
+		return -1;
 
-		for(; p_chip_data < chip->image_buf + chip->imgSize; p_chip_data++)
+	memset(sec_index, 0, sizeof(power_chip_sec_index_t) * POWER_CHIP_SECTION_MAX);
+	//差分镜像中section的结束地址不一定存在，每个section都查找全部记录，寄存器地址包含page，不会重复写入
+	if(sparse)
+	{
+		for(i = 0; i < section_count; i++)
 		{
-			if((p_chip_data->reg >= p_section_info->sec_start) && (p_chip_data->reg <= p_section_info->sec_end))
+			sec_index[i].start = 0;
+			sec_index[i].end = rec_count;
+			for(rec = 0; rec < rec_count; rec++)
 			{
-				data_count++;
+				if((p_chip_data[rec].reg >= p_section_info[i].sec_start) && (p_chip_data[rec].reg <= p_section_info[i].sec_end))
+					sec_index[i].count++;
 			}
-			if(p_chip_data->reg == p_section_info->sec_end)
+		}
+		return 0;
+	}
+	//与升级时的查找方式保持一致：同一类型的section依次向后查找，遇到section的结束地址即认为该section结束
+	for(i = 0; i < section_count; i++)
+	{
+		if(done_mask & p_section_info[i].section)
+			continue;
+		done_mask |= p_section_info[i].section;
+
+		rec = 0;
+		for(j = i; j < section_count; j++)
+		{
+			if(p_section_info[j].section != p_section_info[i].section)
+				continue;
+
+			sec_index[j].start = rec;
+			for(; rec < rec_count; rec++)
 			{
-				p_chip_data++;		//直接前进到下一个地址，减少一次比对
-				break;
+				if((p_chip_data[rec].reg >= p_section_info[j].sec_start) && (p_chip_data[rec].reg <= p_section_info[j].sec_end))
+				{
+					sec_index[j].count++;
+				}
+				if(p_chip_data[rec].reg == p_section_info[j].sec_end)
+				{
+					rec++;		//直接前进到下一个地址，减少一次比对
+					break;
+				}
 			}
+			sec_index[j].end = rec;
 		}
 	}
-	if(!data_count)
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipImgDigest
+ * Description  : SHA256 of firmware image, a cached verdict is only reused for the same digest
+ * Params       : buf:image data; size:bytes of image data; digest:output, POWER_CHIP_IMG_DIGEST_SIZE bytes
+ * Return       : 0: success, -1: fail
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipImgDigest(INT8U *buf, INT32U size, INT8U *digest)
+{
+	//校验结果可以跳过签名校验，必须使用无法构造碰撞的哈希
+	if(1 != EVP_Digest(buf, size, digest, NULL, EVP_sha256(), NULL))
 	{
-		TWARN("Update power chip %d %s section fail,there is no %s section data in bin file or no %s section configuration.\n", chip->chip_inst, section_name, section_name, section_name);
-		return CC_FILE_MISMATCH;
+		TWARN("Power Chip Firmware Image digest fail.\n");
+		return -1;
 	}
-	PRINT("%s %s %d Dev [%d] data_count = %u \n", __FILE__, __FUNCTION__, __LINE__, chip->chip_inst, data_count);
+	return 0;
+}
 
-	//进入正式升级流程
-	chip->progress = 0;
-	chip->status = POWER_FW_UPDATE_STATUS_ING;
-	chip->stage = stage;
-#ifndef __PC_DBG
-	if(0 != PowerChipPrepareFunction(chip))
+/*****************************************************************************
+ * Function     : PDK_PowerChipFileDigest
+ * Description  : SHA256 of firmware image file
+ * Params       : file:image file; digest:output, POWER_CHIP_IMG_DIGEST_SIZE bytes
+ * Return       : 0: success, -1: fail
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipFileDigest(char *file, INT8U *digest)
+{
+	INT8U buf[4096];
+	EVP_MD_CTX *ctx = NULL;
+	FILE *fp = NULL;
+	size_t len;
+	int ret = -1;
+
+	fp = fopen(file, "rb");
+	if(NULL == fp)
+		return -1;
+	ctx = EVP_MD_CTX_new();
+	if(NULL != ctx && 1 == EVP_DigestInit_ex(ctx, EVP_sha256(), NULL))
 	{
-		chip->status = POWER_FW_UPDATE_STATUS_FAIL;
-		return CC_ERR_SETUP_FW_UPDATE;
+		while(0 < (len = fread(buf, 1, sizeof(buf), fp)) && 1 == EVP_DigestUpdate(ctx, buf, len));
+		if(feof(fp) && !ferror(fp) && 1 == EVP_DigestFinal_ex(ctx, digest, NULL))
+			ret = 0;
 	}
-#endif
-	p_chip_data = (power_chip_data_t *)chip->image_buf;
-	for(p_section_info = (irps5401_section_info *)chip->section_info; p_section_info < (INT8U *)chip->section_info + sizeof(irps5401_section_info) * chip->section_count; p_section_info++)
+	EVP_MD_CTX_free(ctx);
+	fclose(fp);
+	return ret;
+}
+
+static void PDK_PowerChipImgKeyGet(struct stat *fs, power_chip_img_key_t *key)
+{
+	memset(key, 0, sizeof(power_chip_img_key_t));
+	key->dev = fs->st_dev;
+	key->ino = fs->st_ino;
+	key->size = fs->st_size;
+	key->mtime = fs->st_mtim;
+}
+
+static bool PDK_PowerChipImgKeyEqual(power_chip_img_key_t *a, power_chip_img_key_t *b)
+{
+	return (a->dev == b->dev) && (a->ino == b->ino) && (a->size == b->size)
+		&& (a->mtime.tv_sec == b->mtime.tv_sec) && (a->mtime.tv_nsec == b->mtime.tv_nsec);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipImgCacheLookup
+ * Description  : look up verified result of firmware image
+ * Params       : entry:key and digest are input, other members are output when hit
+ * Return       : 0: hit, -1: miss
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipImgCacheLookup(power_chip_img_cache_t *entry)
+{
+	int LockRet = -1;
+	int ret = -1;
+	INT32U i;
+
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipImgCacheMutex, LockRet);
+	if (LockRet == -1)
+		return -1;
+
+	for(i = 0; i < POWER_CHIP_IMG_CACHE_COUNT; i++)
 	{
-		if(p_section_info->section != section)
+		if(power_chip_img_cache[i].valid
+			&& 0 == memcmp(power_chip_img_cache[i].digest, entry->digest, POWER_CHIP_IMG_DIGEST_SIZE)
+			&& PDK_PowerChipImgKeyEqual(&power_chip_img_cache[i].key, &entry->key))
 		{
-			continue;
+			power_chip_img_cache[i].lru = ++power_chip_img_cache_lru;
+			memcpy(entry, &power_chip_img_cache[i], sizeof(power_chip_img_cache_t));
+			ret = 0;
+			break;
 		}
-		PRINT("%s %s %d Dev [%d] page = 0x%02x ,data = :\n", __FILE__, __FUNCTION__, __LINE__, chip->chip_inst, p_section_info->page);
-#ifndef __PC_DBG
-		//减少I2C开销，每次切换section时写一次page，写具体寄存器时不再写page寄存器
-		if(0 != PDK_Irps5401SetPage(chip->chip, p_section_info->page))
+	}
+	OS_THREAD_MUTEX_RELEASE(&PowerChipImgCacheMutex);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipImgCacheStore
+ * Description  : save verified result of firmware image, replace the old result of the same file,
+ *                only passed results are saved
+ * Params       : entry:verified result
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipImgCacheStore(power_chip_img_cache_t *entry)
+{
+	int LockRet = -1;
+	INT32U i, slot = 0;
+
+	//失败可能是暂时的（如Ed25519公钥在上传之后才安装），不缓存，同一文件下次重新校验
+	if(CC_NORMAL != entry->verdict)
+		return;
+
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipImgCacheMutex, LockRet);
+	if (LockRet == -1)
+		return;
+
+	//同一个文件只保留最新的结果，否则使用空闲或最久未使用的条目
+	for(i = 0; i < POWER_CHIP_IMG_CACHE_COUNT; i++)
+	{
+		if(power_chip_img_cache[i].valid
+			&& power_chip_img_cache[i].key.dev == entry->key.dev
+			&& power_chip_img_cache[i].key.ino == entry->key.ino)
 		{
-			chip->status = POWER_FW_UPDATE_STATUS_FAIL;
-			TWARN("Update power chip %d %s section fail,set page %u fail\n", chip->chip_inst, section_name, p_section_info->page);
-			return CC_ERR_FLASH_WRITE;
-		}		
-#endif
-		for(; p_chip_data < chip->image_buf + chip->imgSize; p_chip_data++)
+			slot = i;
+			break;
+		}
+		if(!power_chip_img_cache[i].valid)
 		{
-			if((p_chip_data->reg >= p_section_info->sec_start) && (p_chip_data->reg <= p_section_info->sec_end))
-			{
-#ifndef __PC_DBG
-				if(0 != PDK_Irps5401WriteByteWithoutPageSet(chip->chip, p_chip_data->reg, p_chip_data->value))
-				{
-					chip->status = POWER_FW_UPDATE_STATUS_FAIL;
-					TWARN("Update power chip %d %s section fail,write reg 0x%x fail\n", chip->chip_inst, section_name, p_chip_data->reg);
-					return CC_ERR_FLASH_WRITE;
-				}
-#endif
-				PRINT("%04X %02X %02X\n",p_chip_data->reg, p_chip_data->value, p_chip_data->mask);
+			slot = i;
+		}
+		else if(power_chip_img_cache[slot].valid && power_chip_img_cache[i].lru < power_chip_img_cache[slot].lru)
+		{
+			slot = i;
+		}
+	}
+	memcpy(&power_chip_img_cache[slot], entry, sizeof(power_chip_img_cache_t));
+	power_chip_img_cache[slot].valid = 1;
+	power_chip_img_cache[slot].lru = ++power_chip_img_cache_lru;
+	OS_THREAD_MUTEX_RELEASE(&PowerChipImgCacheMutex);
+}
 
-				written_count++;
-				if(p_chip_data->reg == p_section_info->sec_end)
-				{
-					p_chip_data++;		//直接前进到下一个地址，减少一次比对
-					break;
-				}
+/*****************************************************************************
+ * Function     : PDK_PowerChipImgCacheFlush
+ * Description  : drop all verified results of firmware image, e.g. after public key changed
+ * Params       : 
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+void PDK_PowerChipImgCacheFlush(void)
+{
+	int LockRet = -1;
+
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipImgCacheMutex, LockRet);
+	if (LockRet == -1)
+		return;
+	memset(power_chip_img_cache, 0, sizeof(power_chip_img_cache));
+	OS_THREAD_MUTEX_RELEASE(&PowerChipImgCacheMutex);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipMicDirCheck
+ * Description  : check the directory of a verified multi-image container,
+ *                find the power chips which have an image in it
+ * Params       : *ImgData      -- Firmware Image Data, verified by PDK_PowerChipFwImageVerify
+ *                *entry        -- output, chip_inst/chip_mask are set
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipMicDirCheck(INT8U *ImgData, power_chip_img_cache_t *entry)
+{
+	power_chip_hd_t *ImgHdr = (power_chip_hd_t *)ImgData;
+	power_chip_mic_dir_t *dir = (power_chip_mic_dir_t *)(ImgData + ImgHdr->ImgOffset);
+	power_chip_mic_entry_t *mic = (power_chip_mic_entry_t *)(dir + 1);
+	INT8U chip_count = sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t);
+	INT32U body_start, body_end, i, j;
+	INT8U chip;
+
+	entry->chip_inst = chip_count;
+	entry->chip_mask = 0;
+	//PDK_PowerChipFwImageVerify已保证ImgOffset + ImgSize不会溢出
+	body_end = ImgHdr->ImgOffset + ImgHdr->ImgSize;
+	if(ImgHdr->ImgSize < sizeof(power_chip_mic_dir_t) || 0 == dir->EntryCount || POWER_CHIP_MIC_ENTRY_MAX < dir->EntryCount
+		|| ImgHdr->ImgSize < sizeof(power_chip_mic_dir_t) + dir->EntryCount * sizeof(power_chip_mic_entry_t))
+	{
+		TWARN("Power chip multi-image directory is invalid, image size %u.\n", ImgHdr->ImgSize);
+		return CC_FILE_SIZE_INVALID;
+	}
+	body_start = ImgHdr->ImgOffset + sizeof(power_chip_mic_dir_t) + dir->EntryCount * sizeof(power_chip_mic_entry_t);
+
+	for(i = 0; i < dir->EntryCount; i++)
+	{
+		if(mic[i].Offset < body_start || mic[i].Offset > body_end || mic[i].Size > body_end - mic[i].Offset
+			|| 0 == mic[i].Size || 0 != mic[i].Size % sizeof(power_chip_data_t))
+		{
+			TWARN("Power chip multi-image entry %u [%x + %x] is out of [%x, %x).\n", i, mic[i].Offset, mic[i].Size, body_start, body_end);
+			return CC_FILE_SIZE_INVALID;
+		}
+		for(j = 0; j < i; j++)
+		{
+			if(0 == memcmp(mic[i].SubModel, mic[j].SubModel, POWER_CHIP_MODEL_INFO_LEN))
+			{
+				TWARN("Power chip multi-image entry %u and %u have the same submodel.\n", j, i);
+				return CC_ERR_FW_IMG_MODEL;
 			}
 		}
-		PRINT("\n\n");
-		chip->progress = written_count * 100 / data_count;
+		chip = PDK_PowerChipBoardMatch(mic[i].SubModel);
+		if(chip >= chip_count)
+			continue;
+		//一个芯片只能对应一个镜像，否则无法确定升级哪一个
+		if(entry->chip_mask & (1 << chip))
+		{
+			TWARN("Power chip %d matches more than one image in multi-image file.\n", chip);
+			return CC_ERR_FW_IMG_MODEL;
+		}
+		entry->chip_mask |= 1 << chip;
+		if(entry->chip_inst >= chip_count)
+			entry->chip_inst = chip;
 	}
-	PRINT("%s %s %d Dev [%d] written_count = %u \n", __FILE__, __FUNCTION__, __LINE__, chip->chip_inst, written_count);
-#ifndef __PC_DBG
-	ret = PowerChipPostFunction(chip);
-	if(CC_NORMAL == ret)
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFwImageSelect
+ * Description  : set the image data of power chip Devinst to update info,
+ *                the image of Devinst is picked from the directory if the file is a multi-image container
+ * Params       : *FwUpdate     -- Firmware update info
+ *                Devinst       -- power chip to be updated
+ *                *buf          -- Firmware Image Data, verified
+ *                *entry        -- verified result of buf
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipFwImageSelect(power_chip_update_t *FwUpdate, INT8U Devinst, INT8U *buf, power_chip_img_cache_t *entry)
+{
+	power_chip_hd_t *ImgHdr = (power_chip_hd_t *)buf;
+	power_chip_mic_dir_t *dir = NULL;
+	power_chip_mic_entry_t *mic = NULL;
+	INT8U chip_count = sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t);
+	INT32U i;
+
+	FwUpdate->image_buf = buf + ImgHdr->ImgOffset;
+	FwUpdate->imgSize = ImgHdr->ImgSize;
+	FwUpdate->FwRev = ImgHdr->FwRev;
+	FwUpdate->img_type = ImgHdr->ImgType;
+	FwUpdate->BaseFwRev = ImgHdr->BaseFwRev;
+	memcpy(FwUpdate->BaseDigest, ImgHdr->BaseDigest, sizeof(FwUpdate->BaseDigest));
+	FwUpdate->BaseMask = NULL;
+	//差分镜像的寄存器记录之后是基线掩码，PDK_PowerChipFwImageParse已检查大小
+	if(POWER_CHIP_IMG_TYPE_DELTA == ImgHdr->ImgType)
 	{
-		chip->progress = 100;
-		chip->status = POWER_FW_UPDATE_STATUS_SUCCESS;
-		return CC_NORMAL;
+		FwUpdate->imgSize = ImgHdr->ImgSize - ImgHdr->BaseMaskSize;
+		FwUpdate->BaseMask = FwUpdate->image_buf + FwUpdate->imgSize;
 	}
-	else
+	FwUpdate->chip_inst = entry->chip_inst;
+	memcpy(FwUpdate->sec_index, entry->sec_index, sizeof(FwUpdate->sec_index));
+	if(POWER_CHIP_IMG_TYPE_MULTI != ImgHdr->ImgType)
+		return CC_NORMAL;
+
+	//容器中没有Devinst的镜像时chip_inst为无效值，由PDK_PowerChipUpdateBegin拒绝升级
+	FwUpdate->chip_inst = chip_count;
+	if(Devinst >= chip_count || !(entry->chip_mask & (1 << Devinst)))
+		return CC_NORMAL;
+	dir = (power_chip_mic_dir_t *)(buf + ImgHdr->ImgOffset);
+	mic = (power_chip_mic_entry_t *)(dir + 1);
+	for(i = 0; i < dir->EntryCount; i++)
 	{
-		chip->status = POWER_FW_UPDATE_STATUS_FAIL;
-		return ret;
+		if(Devinst != PDK_PowerChipBoardMatch(mic[i].SubModel))
+			continue;
+		FwUpdate->image_buf = buf + mic[i].Offset;
+		FwUpdate->imgSize = mic[i].Size;
+		FwUpdate->FwRev = mic[i].FwRev;
+		FwUpdate->img_type = POWER_CHIP_IMG_TYPE_SINGLE;
+		FwUpdate->chip_inst = Devinst;
+		if(0 != PDK_PowerChipSecIndexBuild(FwUpdate->image_buf, FwUpdate->imgSize,
+			board_power_chip_info[Devinst].section_info, board_power_chip_info[Devinst].section_count, FwUpdate->sec_index, false))
+		{
+			TWARN("Power chip %d section info is illegal.\n", Devinst);
+			return CC_ERR_SETUP_FW_UPDATE;
+		}
+		TINFO("Power chip %d uses image %u of multi-image file, submodel %s, fw ver 0x%x.\n", Devinst, i, mic[i].SubModel, mic[i].FwRev);
+		break;
 	}
-#else
-	chip->progress = 100;
-	chip->status = POWER_FW_UPDATE_STATUS_SUCCESS;
-#endif
-	
 	return CC_NORMAL;
 }
 
 /*****************************************************************************
- * Function     : PDK_PowerChipFwImageVerify
- * Description  : Power chip Firmware Image Verify
+ * Function     : PDK_PowerChipFwImageParse
+ * Description  : verify firmware image, find the power chip it belongs to and index its sections,
+ *                only the directory is checked for a multi-image container
  * Params       : *ImgData      -- Firmware Image Data
  *                ImgSize       -- Firmware Image Data bytes length
- * Return       : IPMI Completion Code
+ *                *entry        -- output, verdict/hdr/chip_inst/chip_mask/sec_index are set
+ * Return       : IPMI Completion Code, same as entry->verdict
  * Author       : TeaFeng
- * Date         : 2024/11/27
+ * Date         : 2026/10/19
 *****************************************************************************/
-int PDK_PowerChipFwImageVerify(INT8U *ImgData, INT32U ImgSize )
+static int PDK_PowerChipFwImageParse(INT8U *ImgData, INT32U ImgSize, power_chip_img_cache_t *entry)
 {
-    power_chip_hd_t *ImgHdr = (power_chip_hd_t *)ImgData;
-    INT32U FwSize = 0;
-    INT8U *DigestSign = NULL;
+	INT32U rec_size;
 
-    if (ImgHdr->HdrCRC32 != CalculateCRC32(ImgData, sizeof(power_chip_hd_t) - 4))
-    {
-        TWARN("Power chip Firmware Image Header CRC32 verify failed");
-        return CC_ERR_FW_IMG_HDR_CRC;
-    }
+	/* Firmware image verify */
+	entry->verdict = PDK_PowerChipFwImageVerify(ImgData, ImgSize);
+	if (CC_NORMAL != entry->verdict)
+		return entry->verdict;
 
-    if (0 != memcmp(POWER_CHIP_FW_IMG_SIGN, ImgHdr->Signature, FW_IDENTITY_LEN))
-    {
-        TWARN("Power chip Firmware Image Header Signature Invalid");
-        return CC_ERR_FW_IMG_SIGNATURE;
-    }
-	
-	if (0 != memcmp(DEVMODEL_MYDEV_POWER, ImgHdr->DevModel, strlen(DEVMODEL_MYDEV_POWER)))
+	memcpy(&entry->hdr, ImgData, sizeof(power_chip_hd_t));
+	//多镜像容器只检查目录，各芯片的section索引在选出对应镜像后建立
+	if(POWER_CHIP_IMG_TYPE_MULTI == entry->hdr.ImgType)
 	{
-		TWARN("Power chip Firmware Image Header Devmodel Invalid");
-		return CC_ERR_FW_IMG_MODEL;
+		entry->verdict = PDK_PowerChipMicDirCheck(ImgData, entry);
+		return entry->verdict;
 	}
-
-    if (ImgSize != (ImgHdr->ImgOffset + ImgHdr->ImgSize + POWER_CHIP_IMG_DIGEST_SIGN_SIZE))
-    {
-        TWARN("Power chip Firmware Image Size Invalid [%x + %x + %x != %x]", ImgHdr->ImgOffset, ImgHdr->ImgSize, POWER_CHIP_IMG_DIGEST_SIGN_SIZE, ImgSize);
-        return CC_FILE_SIZE_INVALID;
-    }
-
-    if (ImgHdr->ImgCRC32 != CalculateCRC32(&ImgData[ImgHdr->ImgOffset], ImgHdr->ImgSize))
-    {
-        TWARN("Power chip Firmware Image Data CRC32 verify failed");
-        return CC_FILE_CHKSUM_EER;
-    }
-
-    /* Firmware Image Digest Signature Verify */
-    FwSize = ImgSize - POWER_CHIP_IMG_DIGEST_SIGN_SIZE;
-    DigestSign = &ImgData[FwSize];
-    if (FwImageDigestSignVerify(POWER_CHIP_IMG_SIGN_PUBLIC_FILE, ImgData, FwSize, DigestSign) < 0)
-    {
-        TWARN("Power chip Firmware Image Digest Signature verification failed");
-        return CC_ERR_HASH_SIGNED_VERIFY;
-    }
-
-    return CC_NORMAL;
+	//差分镜像的寄存器记录之后是基线掩码
+	rec_size = entry->hdr.ImgSize;
+	if(POWER_CHIP_IMG_TYPE_DELTA == entry->hdr.ImgType)
+	{
+		if(entry->hdr.BaseMaskSize >= rec_size || 0 != (rec_size - entry->hdr.BaseMaskSize) % sizeof(power_chip_data_t))
+		{
+			TWARN("Power chip delta image size %u is invalid with %u baseline masks.\n", rec_size, entry->hdr.BaseMaskSize);
+			entry->verdict = CC_FILE_SIZE_INVALID;
+			return entry->verdict;
+		}
+		rec_size -= entry->hdr.BaseMaskSize;
+	}
+	entry->chip_inst = PDK_PowerChipBoardMatch(entry->hdr.SubModel);
+	if(entry->chip_inst < sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t))
+	{
+		entry->chip_mask = 1 << entry->chip_inst;
+		if(0 != PDK_PowerChipSecIndexBuild(ImgData + entry->hdr.ImgOffset, rec_size,
+			board_power_chip_info[entry->chip_inst].section_info, board_power_chip_info[entry->chip_inst].section_count, entry->sec_index,
+			POWER_CHIP_IMG_TYPE_DELTA == entry->hdr.ImgType))
+		{
+			TWARN("Power chip %d section info is illegal.\n", entry->chip_inst);
+			entry->verdict = CC_ERR_SETUP_FW_UPDATE;
+		}
+		else if(POWER_CHIP_IMG_TYPE_DELTA == entry->hdr.ImgType
+			&& entry->hdr.BaseMaskSize != PDK_PowerChipBaseRegCount(entry->chip_inst, entry->sec_index))
+		{
+			TWARN("Power chip %d delta image has %u baseline masks, but %u registers are digested.\n", entry->chip_inst,
+				entry->hdr.BaseMaskSize, PDK_PowerChipBaseRegCount(entry->chip_inst, entry->sec_index));
+			entry->verdict = CC_FILE_SIZE_INVALID;
+		}
+	}
+	return entry->verdict;
 }
 
 /*****************************************************************************
- * Function     : PDK_PowerChipFwImageRead
- * Description  : Read Power chip Firmware Image file and verify
+ * Function     : PDK_PowerChipFwImageLoad
+ * Description  : Read Power chip Firmware Image file and verify,
+ *                verification is skipped if the file has been verified and not changed
  * Params       : *file         -- Firmware image file name
- *                *pFwUpdate    -- Firmware update info
+ *                *origin       -- file which *file is copied from, NULL if none
+ *                *buf          -- output, image data, POWER_CHIP_FW_SIZE_MAX bytes
+ *                *entry        -- output, verified result of image
  * Return       : IPMI Completion Code
  * Author       : TeaFeng
- * Date         : 2024/11/27
+ * Date         : 2026/10/19
 *****************************************************************************/
-int PDK_PowerChipFwImageRead(char *file, power_chip_update_t *pFwUpdate)
+static int PDK_PowerChipFwImageLoad(char *file, char *origin, INT8U *buf, power_chip_img_cache_t *entry)
 {
     struct stat fs;
-    power_chip_hd_t *ImgHdr = NULL;
-    INT32U size, i;
-    INT8U *FwRev = NULL;
-    INT8U *buf = NULL;
+    INT32U size;
     int ret;
 
-    if ((NULL == file) || (NULL == pFwUpdate))
+    if ((NULL == file) || (NULL == buf) || (NULL == entry))
         return CC_UNSPECIFIED_ERR;
 
     /* Check firmware image not exist */
@@ -1527,272 +2648,2738 @@ int PDK_PowerChipFwImageRead(char *file, power_chip_update_t *pFwUpdate)
         return CC_FILE_SIZE_INVALID;
     }
 	TINFO("Power Chip Firmware Image File size %u Bytes.\n", size);
-    /* molloc memory for firmware image read */
-    buf = malloc(size);
-    if (NULL == buf)
-    {
-        TWARN("No memory for Power Chip Firmware Image");
-        return CC_NO_MEM;
-    }
 
     /* Read Firmware image file */
     if (PDK_FileRead(file, 0, size, buf) < 0)
     {
-        free(buf);
-		buf = NULL;
         TWARN("ERROR in read Power Chip Firmware Image File");
         return CC_ERR_FILE_READ;
     }
 
-    /* Firmware image verify */
-    ret = PDK_PowerChipFwImageVerify(buf, size);
-    if (CC_NORMAL != ret)
-    {
-        free(buf);
-		buf = NULL;
-        return ret;
-    }
-
-    ImgHdr = (power_chip_hd_t *)buf;
-	pFwUpdate->image_buf = buf + ImgHdr->ImgOffset;
-	pFwUpdate->imgSize = ImgHdr->ImgSize;
-	pFwUpdate->FwRev = ImgHdr->FwRev;
-
-	PRINT("%s %s %d Dev buf = %p,image_buf = %p.\n \n", __FILE__, __FUNCTION__, __LINE__, buf, pFwUpdate->image_buf);
+	/* 文件身份和内容SHA256都与缓存一致时，直接使用缓存的校验结果 */
+	memset(entry, 0, sizeof(power_chip_img_cache_t));
+	PDK_PowerChipImgKeyGet(&fs, &entry->key);
+	if(0 != PDK_PowerChipImgDigest(buf, size, entry->digest))
+	{
+		//无法确认内容与校验时一致，完整校验且不缓存结果
+		PDK_PowerChipFwImageParse(buf, size, entry);
+		return entry->verdict;
+	}
+	ret = PDK_PowerChipImgCacheLookup(entry);
 
-	for(i=0; i < sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t); i++)
+	/* 文件是从origin复制而来的，内容与未修改过的origin一致时，沿用origin的校验结果 */
+	if(0 != ret && NULL != origin && 0 == stat(origin, &fs))
 	{
-		if(0 == memcmp(board_power_chip_info[i].SubModel, ImgHdr->SubModel, strlen(board_power_chip_info[i].SubModel)))
-		{
-			pFwUpdate->chip_inst = i;
-			break;
-		}
-		else
+		power_chip_img_cache_t origin_entry;
+
+		memset(&origin_entry, 0, sizeof(origin_entry));
+		PDK_PowerChipImgKeyGet(&fs, &origin_entry.key);
+		memcpy(origin_entry.digest, entry->digest, POWER_CHIP_IMG_DIGEST_SIZE);
+		ret = PDK_PowerChipImgCacheLookup(&origin_entry);
+		if(0 == ret)
 		{
-			pFwUpdate->chip_inst = sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t);
+			origin_entry.key = entry->key;
+			memcpy(entry, &origin_entry, sizeof(power_chip_img_cache_t));
+			PDK_PowerChipImgCacheStore(entry);
 		}
 	}
-    return CC_NORMAL;
-}
 
+	if(0 == ret)
+	{
+		TINFO("Power Chip Firmware Image %s has been verified, result = 0x%x.\n", file, entry->verdict);
+	}
+	else
+	{
+		PDK_PowerChipFwImageParse(buf, size, entry);
+		PDK_PowerChipImgCacheStore(entry);
+	}
 
-static void PDK_ExitPowerChipUpdateModeFail(power_chip_update_t *FwUpdate, char *p_fw, INT8U error_code)
-{
-	FwUpdate->is_under_update = 0;
-	if(p_fw)free(p_fw);
-	p_fw = NULL;
-	FwUpdate->error_code = error_code;
-	FwUpdate->status = POWER_FW_UPDATE_STATUS_FAIL;
-	PDK_Irps5401MuxBlockLock(0);
+    return entry->verdict;
 }
-static void PDK_ExitPowerChipUpdateMode(power_chip_update_t *FwUpdate, char *p_fw, INT8U error_code)
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFwImageReadFrom
+ * Description  : Read Power chip Firmware Image file which is copied from origin and verify
+ * Params       : *file         -- Firmware image file name
+ *                *origin       -- file which *file is copied from, NULL if none
+ *                *pFwUpdate    -- Firmware update info, element of power_chip_update
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipFwImageReadFrom(char *file, char *origin, power_chip_update_t *pFwUpdate)
 {
-	FwUpdate->is_under_update = 0;
-	if(p_fw)free(p_fw);
-	p_fw = NULL;
-	FwUpdate->error_code = error_code;
-	PDK_Irps5401MuxBlockLock(0);
-}
+    power_chip_img_cache_t entry;
+    power_chip_arena_slot_t *slot = NULL;
+    INT8U *buf = NULL;
+    int ret;
 
+    if ((NULL == file) || (NULL == pFwUpdate))
+        return CC_UNSPECIFIED_ERR;
+    if (pFwUpdate < power_chip_update || pFwUpdate >= power_chip_update + POWER_CHIP_COUNT_MAX)
+        return CC_UNSPECIFIED_ERR;
 
-int PDK_PowerChipUpdate(INT8U Devinst, INT32U mask)
+    //镜像读取到该升级固定使用的slot中
+    slot = PDK_PowerChipArenaSlotGet(pFwUpdate - power_chip_update);
+    if (NULL == slot)
+    {
+        TWARN("No memory for Power Chip Firmware Image");
+        return CC_NO_MEM;
+    }
+    buf = slot->image;
+
+    ret = PDK_PowerChipFwImageLoad(file, origin, buf, &entry);
+    if (CC_NORMAL != ret)
+        return ret;
+
+    pFwUpdate->image_base = buf;
+    pFwUpdate->image_release = NULL;			//slot内存不需要释放
+    pFwUpdate->image_release_ctx = NULL;
+    ret = PDK_PowerChipFwImageSelect(pFwUpdate, pFwUpdate - power_chip_update, buf, &entry);
+    if (CC_NORMAL != ret)
+        return ret;
+
+    PRINT("%s %s %d Dev buf = %p,image_buf = %p.\n \n", __FILE__, __FUNCTION__, __LINE__, buf, pFwUpdate->image_buf);
+    return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFwImageRead
+ * Description  : Read Power chip Firmware Image file and verify
+ * Params       : *file         -- Firmware image file name
+ *                *pFwUpdate    -- Firmware update info
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/27
+*****************************************************************************/
+int PDK_PowerChipFwImageRead(char *file, power_chip_update_t *pFwUpdate)
+{
+	return PDK_PowerChipFwImageReadFrom(file, NULL, pFwUpdate);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipStagedImgVerify
+ * Description  : verify the uploaded firmware image and publish the result
+ * Params       : 
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipStagedImgVerify(void)
+{
+	power_chip_staged_img_t staged;
+	power_chip_img_cache_t entry;
+	power_chip_arena_slot_t *slot = NULL;
+	int LockRet = -1;
+	int ret;
+
+	memset(&staged, 0, sizeof(staged));
+	memset(&entry, 0, sizeof(entry));
+
+	slot = PDK_PowerChipArenaSlotGet(POWER_CHIP_ARENA_SLOT_STAGED);
+	if(NULL == slot)
+		return;
+
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipStagedImgMutex, LockRet);
+	if (LockRet == -1)
+		return;
+	power_chip_staged_img.state = POWER_FW_STAGED_IMG_VERIFYING;
+	OS_THREAD_MUTEX_RELEASE(&PowerChipStagedImgMutex);
+
+	pthread_mutex_lock(&PowerChipStagedSlotMutex);
+	ret = PDK_PowerChipFwImageLoad(POWER_CHIP_FILE, NULL, slot->image, &entry);
+	pthread_mutex_unlock(&PowerChipStagedSlotMutex);
+	if(CC_FILE_NOT_EXIST == ret)
+	{
+		staged.state = POWER_FW_STAGED_IMG_NONE;
+	}
+	else if(CC_NORMAL != ret)
+	{
+		staged.state = POWER_FW_STAGED_IMG_INVALID;
+		staged.verdict = ret;
+	}
+	else
+	{
+		staged.chip_inst = entry.chip_inst;
+		staged.chip_mask = entry.chip_mask;
+		staged.FwRev = entry.hdr.FwRev;
+		memcpy(staged.SubModel, entry.hdr.SubModel, sizeof(staged.SubModel));
+		if(entry.chip_inst >= sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t))
+		{
+			staged.state = POWER_FW_STAGED_IMG_INVALID;
+			staged.verdict = CC_FILE_MISMATCH;
+		}
+		else
+		{
+			staged.state = POWER_FW_STAGED_IMG_VALID;
+			staged.verdict = CC_NORMAL;
+		}
+	}
+
+	if(POWER_FW_STAGED_IMG_INVALID == staged.state)
+	{
+		TAUDIT(LOG_WARNING, "Power chip firmware file %s is invalid, error code 0x%x.\n", POWER_CHIP_FILE, staged.verdict);
+	}
+	else if(POWER_FW_STAGED_IMG_VALID == staged.state)
+	{
+		TINFO("Power chip firmware file %s is valid, submodel %s, fw ver 0x%x.\n", POWER_CHIP_FILE, staged.SubModel, staged.FwRev);
+	}
+
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipStagedImgMutex, LockRet);
+	if (LockRet == -1)
+		return;
+	memcpy(&power_chip_staged_img, &staged, sizeof(staged));
+	power_chip_staged_img_key = entry.key;
+	OS_THREAD_MUTEX_RELEASE(&PowerChipStagedImgMutex);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipStagedImgGet
+ * Description  : get the verified result of the uploaded firmware image
+ * Params       : staged:output
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipStagedImgGet(power_chip_staged_img_t *staged)
+{
+	int LockRet = -1;
+
+	if(NULL == staged)
+		return -1;
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipStagedImgMutex, LockRet);
+	if (LockRet == -1)
+		return -1;
+	memcpy(staged, &power_chip_staged_img, sizeof(power_chip_staged_img_t));
+	OS_THREAD_MUTEX_RELEASE(&PowerChipStagedImgMutex);
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipStagedImgCheck
+ * Description  : check update request with the verified result of the uploaded firmware image
+ * Params       : Devinst:power chip to be updated
+ * Return       : CC_NORMAL if image is valid or not verified yet, otherwise IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipStagedImgCheck(INT8U Devinst)
+{
+	power_chip_img_key_t key;
+	struct stat fs;
+	int LockRet = -1;
+	int ret = CC_NORMAL;
+
+	if(0 != stat(POWER_CHIP_FILE, &fs))
+		return CC_NORMAL;
+	PDK_PowerChipImgKeyGet(&fs, &key);
+
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipStagedImgMutex, LockRet);
+	if (LockRet == -1)
+		return CC_NORMAL;
+	//结果只在文件未再次修改时有效，否则交由升级流程重新校验
+	if(PDK_PowerChipImgKeyEqual(&key, &power_chip_staged_img_key))
+	{
+		//签名校验失败可能是公钥还未安装，交由升级流程重新校验
+		if(POWER_FW_STAGED_IMG_INVALID == power_chip_staged_img.state && CC_ERR_HASH_SIGNED_VERIFY != power_chip_staged_img.verdict)
+		{
+			ret = power_chip_staged_img.verdict;
+		}
+		else if(POWER_FW_STAGED_IMG_VALID == power_chip_staged_img.state && !(power_chip_staged_img.chip_mask & (1 << Devinst)))
+		{
+			ret = CC_ERR_FW_IMG_MODEL;
+		}
+	}
+	OS_THREAD_MUTEX_RELEASE(&PowerChipStagedImgMutex);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipImgWatchTask
+ * Description  : watch the upload directory, verify firmware image once it is written
+ * Params       : pArg:unused
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void *PDK_PowerChipImgWatchTask(void *pArg)
+{
+	char evbuf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev = NULL;
+	ssize_t len;
+	char *p;
+	int fd;
+
+	prctl(PR_SET_NAME, __FUNCTION__, 0, 0, 0);
+	pthread_detach(pthread_self());
+
+	fd = inotify_init1(IN_CLOEXEC);
+	if(fd < 0)
+	{
+		TWARN("Power chip firmware watcher init fail.\n");
+		return 0;
+	}
+	//上传程序可能直接写文件，也可能写临时文件后rename
+	if(inotify_add_watch(fd, IRPSFW_IMG_DIR, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0)
+	{
+		TWARN("Power chip firmware watcher add watch %s fail.\n", IRPSFW_IMG_DIR);
+		close(fd);
+		return 0;
+	}
+
+	//启动前已经上传的镜像
+	if(0 == access(POWER_CHIP_FILE, F_OK))
+		PDK_PowerChipStagedImgVerify();
+
+	while(1)
+	{
+		len = read(fd, evbuf, sizeof(evbuf));
+		if(len <= 0)
+		{
+			if(len < 0 && EINTR == errno)
+				continue;
+			TWARN("Power chip firmware watcher read event fail.\n");
+			break;
+		}
+		for(p = evbuf; p < evbuf + len; p += sizeof(struct inotify_event) + ev->len)
+		{
+			ev = (struct inotify_event *)p;
+			if(0 == ev->len || 0 != strcmp(ev->name, IRPSFW_IMG_NAME))
+				continue;
+			PDK_PowerChipStagedImgVerify();
+		}
+	}
+	close(fd);
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipInit
+ * Description  : init power chip update module, call once when PDK init
+ * Params       : 
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipInit(void)
+{
+	INT8U i;
+
+	//升级使用的内存在初始化时一次性预留
+	if(NULL == PDK_PowerChipArenaSlotGet(0))
+		return -1;
+	//按单板上的芯片生成各总线的锁，并启动各总线的升级线程
+	pthread_once(&power_chip_loop_once, PDK_PowerChipLoopStart);
+	//读取各芯片的版本信息，之后的版本查询不再访问总线
+	for(i = 0; i < sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t) && i < POWER_CHIP_COUNT_MAX; i++)
+	{
+		if(0 != PDK_PowerChipMuxBlockLock(i, 1))
+			continue;
+		if(0 != PDK_PowerChipInventoryRefresh(i))
+			TWARN("Read version of power chip %d fail.\n", i);
+		PDK_PowerChipMuxBlockLock(i, 0);
+	}
+
+	if(0 != PowerChipImgWatchThreadID)
+		return 0;
+	if(0 != pthread_create(&PowerChipImgWatchThreadID, NULL, PDK_PowerChipImgWatchTask, NULL))
+	{
+		TWARN("Create power chip firmware watcher fail.\n");
+		PowerChipImgWatchThreadID = 0;
+		return -1;
+	}
+	return 0;
+}
+
+
+static void PDK_PowerChipEventInit(void)
+{
+	pthread_condattr_t attr;
+	INT32U i;
+
+	for(i = 0; i < POWER_CHIP_EVENT_SUB_MAX; i++)
+		power_chip_event_sub[i].efd = -1;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&PowerChipEventCond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipEventNotify
+ * Description  : deliver events of one chip to subscribers and waiters
+ * Params       : Devinst:power chip; events:power_chip_event
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipEventNotify(INT8U Devinst, INT32U events)
+{
+	INT64U one = 1;
+	INT32U i;
+
+	pthread_once(&power_chip_event_once, PDK_PowerChipEventInit);
+	pthread_mutex_lock(&PowerChipEventMutex);
+	power_chip_event_seq++;
+	for(i = 0; i < POWER_CHIP_EVENT_SUB_MAX; i++)
+	{
+		if(power_chip_event_sub[i].efd < 0 || !(power_chip_event_sub[i].event_mask & events))
+			continue;
+		//未读取的事件合并，eventfd计数已经非零时不再写入
+		if(0 == power_chip_event_sub[i].pending)
+			write(power_chip_event_sub[i].efd, &one, sizeof(one));
+		power_chip_event_sub[i].pending |= power_chip_event_sub[i].event_mask & events;
+		power_chip_event_sub[i].Devinst_mask |= (1 << Devinst);
+	}
+	pthread_cond_broadcast(&PowerChipEventCond);
+	pthread_mutex_unlock(&PowerChipEventMutex);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipEventCheck
+ * Description  : find events between the last published state and the new one,
+ *                progress events are limited by POWER_CHIP_EVENT_PROGRESS_STEP and POWER_CHIP_EVENT_INTERVAL
+ * Params       : Devinst:power chip; old:last published state; new:state to be published
+ * Return       : power_chip_event
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static INT32U PDK_PowerChipEventCheck(INT8U Devinst, power_chip_update_state_t *old, power_chip_update_state_t *new)
+{
+	struct timespec now;
+	INT32U events = 0;
+
+	if(old->status != new->status || old->stage != new->stage || old->stage_mask != new->stage_mask)
+		events |= POWER_CHIP_EVENT_STAGE;
+	if(old->is_under_update && !new->is_under_update)
+		events |= POWER_CHIP_EVENT_DONE;
+	if(old->progress / POWER_CHIP_EVENT_PROGRESS_STEP != new->progress / POWER_CHIP_EVENT_PROGRESS_STEP)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		//状态变化时总是带上进度
+		if(events || (INT64U)(now.tv_sec - power_chip_event_last[Devinst].tv_sec) * 1000000
+			+ (now.tv_nsec - power_chip_event_last[Devinst].tv_nsec) / 1000 >= POWER_CHIP_EVENT_INTERVAL)
+		{
+			events |= POWER_CHIP_EVENT_PROGRESS;
+			power_chip_event_last[Devinst] = now;
+		}
+	}
+	return events;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipStatePublish
+ * Description  : publish update state of FwUpdate to the snapshot read by PDK_PowerChipUpdateStateGet,
+ *                called after a group of members are changed together, events are sent if any
+ * Params       : FwUpdate:element of power_chip_update
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipStatePublish(power_chip_update_t *FwUpdate)
+{
+	INT8U Devinst = FwUpdate - power_chip_update;
+	power_chip_state_seq_t *s = &power_chip_state[Devinst];
+	power_chip_update_state_t old;
+	INT32U seq, events;
+
+	//序号由偶数改为奇数的写者才能更新，写者之间互斥
+	do
+	{
+		seq = s->seq;
+	}while((seq & 1) || !__sync_bool_compare_and_swap(&s->seq, seq, seq + 1));
+
+	old = s->state;
+	s->state.status = FwUpdate->status;
+	s->state.stage = FwUpdate->stage;
+	s->state.progress = FwUpdate->progress;
+	s->state.error_code = FwUpdate->error_code;
+	s->state.is_under_update = FwUpdate->is_under_update;
+	s->state.image_verified_state = FwUpdate->image_verified_state;
+	s->state.FwRev = FwUpdate->FwRev;
+	s->state.stage_mask = FwUpdate->stage_mask;
+
+	events = PDK_PowerChipEventCheck(Devinst, &old, &s->state);
+
+	__sync_synchronize();
+	s->seq = seq + 2;
+
+	if(events)
+		PDK_PowerChipEventNotify(Devinst, events);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateStateGet
+ * Description  : get a consistent copy of update state without any lock, never blocks the update
+ * Params       : Devinst:power chip; state:output
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipUpdateStateGet(INT8U Devinst, power_chip_update_state_t *state)
+{
+	power_chip_state_seq_t *s;
+	INT32U seq;
+
+	if(NULL == state || Devinst >= POWER_CHIP_COUNT_MAX)
+		return -1;
+
+	s = &power_chip_state[Devinst];
+	do
+	{
+		seq = s->seq;
+		__sync_synchronize();
+		memcpy(state, &s->state, sizeof(power_chip_update_state_t));
+		__sync_synchronize();
+	}while((seq & 1) || seq != s->seq);
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipEventSubscribe
+ * Description  : subscribe update events, the returned eventfd becomes readable when any event
+ *                happens, then call PDK_PowerChipEventGet to get the events
+ * Params       : event_mask:power_chip_event
+ * Return       : eventfd, -1 if failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipEventSubscribe(INT32U event_mask)
+{
+	INT32U i;
+	int efd;
+
+	if(0 == (event_mask & POWER_CHIP_EVENT_ALL))
+		return -1;
+	pthread_once(&power_chip_event_once, PDK_PowerChipEventInit);
+	efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(efd < 0)
+	{
+		TWARN("Power chip event subscribe, create eventfd fail.\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&PowerChipEventMutex);
+	for(i = 0; i < POWER_CHIP_EVENT_SUB_MAX; i++)
+	{
+		if(power_chip_event_sub[i].efd < 0)
+		{
+			power_chip_event_sub[i].efd = efd;
+			power_chip_event_sub[i].event_mask = event_mask & POWER_CHIP_EVENT_ALL;
+			power_chip_event_sub[i].pending = 0;
+			power_chip_event_sub[i].Devinst_mask = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&PowerChipEventMutex);
+	if(i == POWER_CHIP_EVENT_SUB_MAX)
+	{
+		TWARN("Power chip event subscribe, too many subscribers.\n");
+		close(efd);
+		return -1;
+	}
+	return efd;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipEventUnsubscribe
+ * Description  : cancel subscription and close the eventfd
+ * Params       : efd:returned by PDK_PowerChipEventSubscribe
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipEventUnsubscribe(int efd)
+{
+	INT32U i;
+	int ret = -1;
+
+	pthread_once(&power_chip_event_once, PDK_PowerChipEventInit);
+	pthread_mutex_lock(&PowerChipEventMutex);
+	for(i = 0; efd >= 0 && i < POWER_CHIP_EVENT_SUB_MAX; i++)
+	{
+		if(power_chip_event_sub[i].efd == efd)
+		{
+			power_chip_event_sub[i].efd = -1;
+			close(efd);
+			ret = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&PowerChipEventMutex);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipEventGet
+ * Description  : get and clear events of a subscriber, current state of each chip can be read by
+ *                PDK_PowerChipUpdateStateGet afterwards
+ * Params       : efd:returned by PDK_PowerChipEventSubscribe; events:output, power_chip_event;
+ *                Devinst_mask:output, chips with events, bit n means Devinst n, can be NULL
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipEventGet(int efd, INT32U *events, INT8U *Devinst_mask)
+{
+	INT64U count;
+	INT32U i;
+	int ret = -1;
+
+	if(NULL == events)
+		return -1;
+	pthread_once(&power_chip_event_once, PDK_PowerChipEventInit);
+	pthread_mutex_lock(&PowerChipEventMutex);
+	for(i = 0; efd >= 0 && i < POWER_CHIP_EVENT_SUB_MAX; i++)
+	{
+		if(power_chip_event_sub[i].efd == efd)
+		{
+			read(efd, &count, sizeof(count));		//清除可读状态
+			*events = power_chip_event_sub[i].pending;
+			if(Devinst_mask)
+				*Devinst_mask = power_chip_event_sub[i].Devinst_mask;
+			power_chip_event_sub[i].pending = 0;
+			power_chip_event_sub[i].Devinst_mask = 0;
+			ret = 0;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&PowerChipEventMutex);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipEventWait
+ * Description  : wait for any update event without subscription
+ * Params       : seq:in, event sequence seen last time, 0 for the first call; out, current sequence
+ *                timeout_ms:max waiting time, negative means forever
+ * Return       : 0: event happened, -1: timeout
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipEventWait(INT32U *seq, int timeout_ms)
+{
+	struct timespec due;
+	int ret = 0;
+
+	if(NULL == seq)
+		return -1;
+	pthread_once(&power_chip_event_once, PDK_PowerChipEventInit);
+	clock_gettime(CLOCK_MONOTONIC, &due);
+	due.tv_sec += timeout_ms / 1000;
+	due.tv_nsec += (timeout_ms % 1000) * 1000000L;
+	if(due.tv_nsec >= 1000000000L)
+	{
+		due.tv_sec++;
+		due.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&PowerChipEventMutex);
+	while(*seq == power_chip_event_seq && 0 == ret)
+	{
+		if(timeout_ms < 0)
+			pthread_cond_wait(&PowerChipEventCond, &PowerChipEventMutex);
+		else if(ETIMEDOUT == pthread_cond_timedwait(&PowerChipEventCond, &PowerChipEventMutex, &due))
+			ret = -1;
+	}
+	*seq = power_chip_event_seq;
+	pthread_mutex_unlock(&PowerChipEventMutex);
+	return ret;
+}
+
+static void PDK_PowerChipImageRelease(power_chip_update_t *FwUpdate)
+{
+	if(FwUpdate->image_base && FwUpdate->image_release)
+		FwUpdate->image_release(FwUpdate->image_base, FwUpdate->image_release_ctx);
+	FwUpdate->image_base = NULL;
+	FwUpdate->image_buf = NULL;
+	FwUpdate->image_release = NULL;
+	FwUpdate->image_release_ctx = NULL;
+}
+
+//释放进入升级时加的总线锁，FwUpdate是power_chip_update的成员，下标即请求升级的Devinst
+//is_under_update最后清除，清除后其他请求才能进入升级
+static void PDK_ExitPowerChipUpdateModeFail(power_chip_update_t *FwUpdate, INT8U error_code)
+{
+	PDK_PowerChipImageRelease(FwUpdate);
+	FwUpdate->error_code = error_code;
+	FwUpdate->status = POWER_FW_UPDATE_STATUS_FAIL;
+	PDK_PowerChipInventoryRefresh(FwUpdate - power_chip_update);
+	PDK_PowerChipMuxBlockLock(FwUpdate - power_chip_update, 0);
+	__sync_lock_release(&FwUpdate->is_under_update);
+	PDK_PowerChipStatePublish(FwUpdate);
+}
+static void PDK_ExitPowerChipUpdateMode(power_chip_update_t *FwUpdate, INT8U error_code)
+{
+	PDK_PowerChipImageRelease(FwUpdate);
+	FwUpdate->error_code = error_code;
+	//释放总线前读取升级后的版本和剩余可写次数
+	PDK_PowerChipInventoryRefresh(FwUpdate - power_chip_update);
+	PDK_PowerChipMuxBlockLock(FwUpdate - power_chip_update, 0);
+	__sync_lock_release(&FwUpdate->is_under_update);
+	PDK_PowerChipStatePublish(FwUpdate);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateEnter
+ * Description  : check update request and enter update mode
+ * Params       : Devinst:power chip to be updated; mask:sections to be updated;
+ *                block:wait for the i2c bus, otherwise return CC_NODE_BUSY at once if the bus is in use
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipUpdateEnter(INT8U Devinst, INT32U mask, bool block)
+{
+	power_chip_update_t *FwUpdate;
+
+	if(Devinst >= sizeof(board_power_chip_info)/sizeof(board_power_chip_info_t) || Devinst >= POWER_CHIP_COUNT_MAX)
+	{
+		TWARN("Input Devinst = %d is larger.\n", Devinst);
+		return CC_ERR_FW_UPDATE;
+	}
+	
+	if(!(mask&POWER_CHIP_SECTION_CONF || mask&POWER_CHIP_SECTION_USER))
+	{
+		TWARN("Input mask = %d is illegal.\n", mask);
+		return CC_ERR_FW_UPDATE;
+	}
+
+	FwUpdate = &power_chip_update[Devinst];
+
+	//原子地占用is_under_update，同时到达的请求只有一个能进入升级，其余请求不修改正在升级的状态
+	if(!__sync_bool_compare_and_swap(&FwUpdate->is_under_update, 0, 1))
+	{
+		TWARN("Firmware is updating.\n");
+		return CC_ERR_EXECUTING;
+	}
+	if(FwUpdate->status == POWER_FW_UPDATE_STATUS_ING 
+		|| FwUpdate->status == POWER_FW_UPDATE_STATUS_VERIFY)
+	{
+		TWARN("Firmware is updating.\n");
+		__sync_lock_release(&FwUpdate->is_under_update);
+		return CC_ERR_EXECUTING;
+	}
+	if(block)
+	{
+		PDK_PowerChipMuxBlockLock(Devinst, 1);
+	}
+	else
+	{
+		//升级线程不能阻塞在总线上，总线被占用时稍后重试
+		if(0 != PDK_PowerChipBusTryLock(PDK_PowerChipBusGet(Devinst)))
+		{
+			__sync_lock_release(&FwUpdate->is_under_update);
+			return CC_NODE_BUSY;
+		}
+	}
+	TINFO("%s %s %d Dev [%d] enter update...\n", __FILE__, __FUNCTION__, __LINE__, Devinst);
+	//整体赋值清零，is_under_update始终为1，不会被其他请求占用
+	{
+		power_chip_update_t fresh;
+		memset(&fresh, 0, sizeof(fresh));
+		fresh.is_under_update = 1;
+		*FwUpdate = fresh;
+	}
+	__sync_add_and_fetch(&power_chip_update_gen[Devinst], 1);
+	PDK_PowerChipStatePublish(FwUpdate);
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipDelay
+ * Description  : sleep in the blocking update, may be longer than 1 second
+ * Params       : us:microseconds
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipDelay(INT32U us)
+{
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+	while(0 != nanosleep(&ts, &ts) && EINTR == errno);
+}
+
+static void PDK_PowerChipFsmFail(power_chip_fsm_t *fsm, INT8U exit_code, int ret)
+{
+	PDK_ExitPowerChipUpdateModeFail(fsm->FwUpdate, exit_code);
+	fsm->result = ret;
+	fsm->wait_us = 0;
+	fsm->state = POWER_CHIP_FSM_DONE;
+}
+
+static void PDK_PowerChipFsmStageFail(power_chip_fsm_t *fsm, int ret)
+{
+	fsm->FwUpdate->status = POWER_FW_UPDATE_STATUS_FAIL;
+	TWARN("Power chip %d firmware update %s section fail.\n", fsm->Devinst, fsm->section_name);
+	PDK_PowerChipFsmFail(fsm, ret, ret);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmBaseRead
+ * Description  : read the next page of the sections changed by the delta image into fsm->reg_value,
+ *                fsm->sec reaches section_count after the last page is read
+ * Params       : fsm:update state machine, fsm->sec is the next section to be read
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipFsmBaseRead(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *FwUpdate = fsm->FwUpdate;
+	irps5401_section_info *p_section_info = (irps5401_section_info *)board_power_chip_info[FwUpdate->chip_inst].section_info;
+	INT32U section_count = board_power_chip_info[FwUpdate->chip_inst].section_count;
+	INT32U page, reg;
+
+	while(fsm->sec < section_count && 0 == FwUpdate->sec_index[fsm->sec].count)
+		fsm->sec++;
+	if(fsm->sec >= section_count)
+		return 0;
+	page = p_section_info[fsm->sec].page;
+	if(0 != PDK_Irps5401SetPage(FwUpdate->chip, page))
+		return -1;
+	//同一页上相邻的section在一步中读取
+	for(; fsm->sec < section_count && p_section_info[fsm->sec].page == page; fsm->sec++)
+	{
+		if(0 == FwUpdate->sec_index[fsm->sec].count)
+			continue;
+		for(reg = p_section_info[fsm->sec].sec_start; reg <= p_section_info[fsm->sec].sec_end; reg++)
+		{
+			if(IRPS5401_PAGE_REG == (reg & 0xFF))
+				continue;
+			if(0 != PDK_Irps5401ReadByteWithoutPageSet(FwUpdate->chip, reg, &fsm->reg_value[reg]))
+				return -1;
+		}
+	}
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBaseDigest
+ * Description  : SHA256 of the registers in every section changed by the delta image, in section order,
+ *                page registers and verify_ignored_reg excluded. every value is ANDed with its baseline
+ *                mask carried in the image, so bits the firmware does not own never cause a mismatch,
+ *                txt2bin computes the same digest from the baseline image
+ * Params       : FwUpdate:update info; reg_value:registers read by PDK_PowerChipFsmBaseRead;
+ *                digest:output, POWER_CHIP_BASE_DIGEST_SIZE bytes
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipBaseDigest(power_chip_update_t *FwUpdate, INT8U *reg_value, INT8U *digest)
+{
+	irps5401_section_info *p_section_info = (irps5401_section_info *)board_power_chip_info[FwUpdate->chip_inst].section_info;
+	INT32U section_count = board_power_chip_info[FwUpdate->chip_inst].section_count;
+	INT8U value[IRPS5401_PAGE_SIZE];
+	EVP_MD_CTX *ctx = NULL;
+	INT32U i, reg, len, k = 0;
+	int ret = -1;
+
+	ctx = EVP_MD_CTX_new();
+	if(NULL == ctx || 1 != EVP_DigestInit_ex(ctx, EVP_sha256(), NULL))
+		goto out;
+	for(i = 0; i < section_count; i++)
+	{
+		if(0 == FwUpdate->sec_index[i].count)
+			continue;
+		len = 0;
+		for(reg = p_section_info[i].sec_start; reg <= p_section_info[i].sec_end; reg++)
+		{
+			if(!PDK_PowerChipBaseRegDigested(reg))
+				continue;
+			//掩码的数量已由PDK_PowerChipFwImageParse检查
+			value[len++] = reg_value[reg] & FwUpdate->BaseMask[k++];
+		}
+		if(1 != EVP_DigestUpdate(ctx, value, len))
+			goto out;
+	}
+	if(1 == EVP_DigestFinal_ex(ctx, digest, NULL))
+		ret = 0;
+out:
+	EVP_MD_CTX_free(ctx);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmDeltaCheck
+ * Description  : check that the registers of the changed sections read by PDK_PowerChipFsmBaseRead
+ *                still hold the baseline values of the delta image, sections without changed
+ *                registers are removed from fsm->mask so that no OTP write count is used for them
+ * Params       : fsm:update state machine, bus of the chip is locked
+ * Return       : 0: Success, -1: Failed, fsm is finished
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipFsmDeltaCheck(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *FwUpdate = fsm->FwUpdate;
+	irps5401_section_info *p_section_info = (irps5401_section_info *)board_power_chip_info[FwUpdate->chip_inst].section_info;
+	INT32U section_count = board_power_chip_info[FwUpdate->chip_inst].section_count;
+	INT8U digest[POWER_CHIP_BASE_DIGEST_SIZE];
+	INT32U mask = 0;
+	INT32U i;
+
+	//PREPARE中解锁使用的寄存器在page 0
+	if(0 != PDK_Irps5401SetPage(FwUpdate->chip, 0))
+	{
+		TWARN("Power chip %d firmware update, set page 0 fail.\n", fsm->Devinst);
+		PDK_PowerChipFsmFail(fsm, CC_BUS_ERR, CC_BUS_ERR);
+		return -1;
+	}
+	//固件版本相同但寄存器已被改过（如单独写过寄存器）时，只写改动的寄存器得不到新固件，必须在写入之前拒绝
+	if(0 != PDK_PowerChipBaseDigest(FwUpdate, fsm->reg_value, digest)
+		|| 0 != memcmp(digest, FwUpdate->BaseDigest, POWER_CHIP_BASE_DIGEST_SIZE))
+	{
+		TWARN("Power chip %d firmware update, registers of chip differ from the baseline of delta image.\n", fsm->Devinst);
+		PDK_PowerChipFsmFail(fsm, CC_FILE_MISMATCH, CC_FILE_MISMATCH);
+		return -1;
+	}
+
+	for(i = 0; i < section_count; i++)
+	{
+		if(FwUpdate->sec_index[i].count)
+			mask |= p_section_info[i].section;
+	}
+	if(!(fsm->mask & mask))
+	{
+		TWARN("Power chip %d firmware update, delta image has no register of sections 0x%x.\n", fsm->Devinst, fsm->mask);
+		PDK_PowerChipFsmFail(fsm, CC_FILE_MISMATCH, CC_FILE_MISMATCH);
+		return -1;
+	}
+	fsm->mask &= mask;
+	TINFO("Power chip %d firmware update, delta image 0x%x -> 0x%x, sections 0x%x.\n", fsm->Devinst, FwUpdate->BaseFwRev, FwUpdate->FwRev, fsm->mask);
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmLeftCheck
+ * Description  : check left written times of the sections in fsm->mask and start updating
+ * Params       : fsm:update state machine
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipFsmLeftCheck(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *FwUpdate = fsm->FwUpdate;
+	INT8U Devinst = fsm->Devinst;
+	INT32U mask = fsm->mask;
+
+	if(mask & POWER_CHIP_SECTION_CONF)
+	{
+		if(0 != PDK_Irps5401ConfWriteLeftGet(FwUpdate->chip, &FwUpdate->conf_wirte_left))
+		{
+			TWARN("Power chip %d firmware update, get conf write left count fail.\n", Devinst);
+			PDK_PowerChipFsmFail(fsm, CC_DEV_IN_FIRMWARE_PROTECT_MODE, CC_DEV_IN_FIRMWARE_PROTECT_MODE);
+			return;
+		}
+		TINFO("%s %s %d Dev [%d] FwUpdate->conf_wirte_left = %u \n", __FILE__, __FUNCTION__, __LINE__, Devinst,FwUpdate->conf_wirte_left);
+		if(FwUpdate->conf_wirte_left <= POWER_CHIP_CONF_WARN_COUNT)
+		{
+			TWARN("Power chip %d firmware update, conf section has reached the left warning limitation %d.\n", Devinst, POWER_CHIP_CONF_WARN_COUNT);
+			PDK_PowerChipFsmFail(fsm, CC_ERR_FW_UPDATE_CAPABILITY, CC_ERR_FW_UPDATE_CAPABILITY);
+			return;
+		}
+		if(FwUpdate->conf_wirte_left == 0)
+		{
+			TWARN("Power chip %d firmware update, conf section has used up all %d times update count.\n", Devinst, IRPS5401_CONF_WRITE_MAX_COUNT);
+			PDK_PowerChipFsmFail(fsm, CC_FWUPDATE_NOT_SUPPORTED, CC_FWUPDATE_NOT_SUPPORTED);
+			return;
+		}
+	}
+	
+	if(mask & POWER_CHIP_SECTION_USER)
+	{
+		if(0 != PDK_Irps5401UserWriteLeftGet(FwUpdate->chip, &FwUpdate->user_wirte_left))
+		{
+			TWARN("Power chip firmware update, get user write left count fail.\n", Devinst,FwUpdate->chip_inst);
+			PDK_PowerChipFsmFail(fsm, CC_ERR_FW_UPDATE_CAPABILITY, CC_ERR_FW_UPDATE_CAPABILITY);
+			return;
+		}
+		TINFO("%s %s %d Dev [%d] FwUpdate->user_wirte_left = %u \n", __FILE__, __FUNCTION__, __LINE__, Devinst, FwUpdate->user_wirte_left);
+		if(FwUpdate->user_wirte_left <= POWER_CHIP_USER_WARN_COUNT)
+		{
+			TWARN("Power chip %d firmware update, user section has reached the left warning limitation %d.\n", Devinst, POWER_CHIP_USER_WARN_COUNT);
+			PDK_PowerChipFsmFail(fsm, CC_ERR_FW_UPDATE_CAPABILITY, CC_ERR_FW_UPDATE_CAPABILITY);
+			return;
+		}
+		if(FwUpdate->user_wirte_left == 0)
+		{
+			TWARN("Power chip %d firmware update, user section has used up all %d times update count.\n", Devinst, IRPS5401_USER_WRITE_MAX_COUNT);
+			PDK_PowerChipFsmFail(fsm, CC_FWUPDATE_NOT_SUPPORTED, CC_FWUPDATE_NOT_SUPPORTED);
+			return;
+		}
+	}
+
+	FwUpdate->section_info = board_power_chip_info[FwUpdate->chip_inst].section_info;
+	FwUpdate->section_count = board_power_chip_info[FwUpdate->chip_inst].section_count;
+	fsm->section = (mask & POWER_CHIP_SECTION_CONF) ? POWER_CHIP_SECTION_CONF : POWER_CHIP_SECTION_USER;
+	fsm->state = POWER_CHIP_FSM_PREPARE;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmBaseStart
+ * Description  : check that the chip runs the baseline firmware of the delta image,
+ *                and start reading the registers of the changed sections page by page
+ * Params       : fsm:update state machine
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipFsmBaseStart(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *FwUpdate = fsm->FwUpdate;
+	power_chip_arena_slot_t *slot = NULL;
+	INT8U version = 0;
+
+	if(0 != PDK_Irps5401FWVersionGet(FwUpdate->chip, &version))
+	{
+		TWARN("Power chip %d firmware update, get firmware version fail.\n", fsm->Devinst);
+		PDK_PowerChipFsmFail(fsm, CC_BUS_ERR, CC_BUS_ERR);
+		return;
+	}
+	if(version != FwUpdate->BaseFwRev)
+	{
+		TWARN("Power chip %d firmware update, delta image is for fw ver 0x%x, but chip is 0x%x.\n", fsm->Devinst, FwUpdate->BaseFwRev, version);
+		PDK_PowerChipFsmFail(fsm, CC_FILE_MISMATCH, CC_FILE_MISMATCH);
+		return;
+	}
+	slot = PDK_PowerChipArenaSlotGet(FwUpdate->chip_inst);
+	if(NULL == slot)
+	{
+		TWARN("Power chip %d firmware update, no memory for reading baseline registers.\n", fsm->Devinst);
+		PDK_PowerChipFsmFail(fsm, CC_NO_MEM, CC_NO_MEM);
+		return;
+	}
+	fsm->reg_value = slot->reg_value;
+	fsm->sec = 0;
+	fsm->state = POWER_CHIP_FSM_BASE_READ;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmCheck
+ * Description  : check silicon version and left written times of the chip before update,
+ *                the baseline registers of a delta image are checked first
+ * Params       : fsm:update state machine
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipFsmCheck(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *FwUpdate = fsm->FwUpdate;
+	INT8U silcon_version = 0;
+	int ret  = 0;
+
+	ret = PDK_Irps5401SiliconVersionGet(FwUpdate->chip, &silcon_version);
+	if(ret != 0)
+	{
+		TWARN("Power chip firmware update, get chip silicon version  fail.\n");
+		PDK_PowerChipFsmFail(fsm, CC_ERR_FW_IMG_MODEL, CC_BUS_ERR);
+		return;
+	}
+	TINFO("Power chip firmware update, chip silicon version:0x%x\n", silcon_version);
+	if(silcon_version < IRPS5401_SILICON_VERSION_MIN)
+	{
+		TWARN("Power chip firmware update, chip silicon [0x%x] is lower than limition [0x%x].\n", silcon_version, IRPS5401_SILICON_VERSION_MIN);
+		PDK_PowerChipFsmFail(fsm, CC_ERR_FW_IMG_MODEL, CC_FWUPDATE_NOT_SUPPORTED);
+		return;
+	}
+
+	if(POWER_CHIP_IMG_TYPE_DELTA == FwUpdate->img_type)
+	{
+		PDK_PowerChipFsmBaseStart(fsm);
+		return;
+	}
+	PDK_PowerChipFsmLeftCheck(fsm);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmPrepare
+ * Description  : start updating the section fsm->section
+ * Params       : fsm:update state machine
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static int PDK_PowerChipFsmPrepare(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+	irps5401_section_info *p_section_info = NULL;
+	INT32U data_count = 0;
+	INT32U i;
+	power_fw_update_stage stage;
+	int (*PowerChipPrepareFunction)(power_chip_update_t *);
+
+	chip->stage_mask = fsm->section;
+	chip->progress = 0;
+	chip->status = POWER_FW_UPDATE_STATUS_IDLE;
+
+	if(POWER_CHIP_SECTION_CONF == fsm->section)
+	{
+		fsm->section_name = "conf";
+		stage = POWER_FW_UPDATE_STAGE_CONF;
+		PowerChipPrepareFunction = PDK_IrpsUpdateConfSectionPrepare;
+	}
+	else
+	{
+		fsm->section_name = "user";
+		stage = POWER_FW_UPDATE_STAGE_USER;
+		PowerChipPrepareFunction = PDK_IrpsUpdateUserSectionPrepare;
+	}
+
+	if(NULL == chip->image_buf || NULL == chip->section_info)
+	{
+		TWARN("Update power chip %d %s section fail,illegal parameter.\n", chip->chip_inst, fsm->section_name);
+		return CC_ERR_SETUP_FW_UPDATE;
+	}
+	//检测可升级的section中是否存在当前要升级的分区，如果不存在，则退出避免浪费升级次数
+	//检测固件中是否存在可升级分区的地址，并计算所需要写入的寄存器的数量，方便后续计算升级进度
+	//固件文件中存在多余的、不在升级范围内的寄存器地址，因此不能直接使用固件文件中的寄存器数量当做总的写入数据量
+	//各section范围内的寄存器数量在读取镜像时已经记录在sec_index中
+	p_section_info = (irps5401_section_info *)chip->section_info;
+	for(i = 0; i < chip->section_count; i++)
+	{
+		if(p_section_info[i].section == fsm->section)
+		{
+			data_count += chip->sec_index[i].count;
+		}
+	}
+	if(!data_count)
+	{
+		TWARN("Update power chip %d %s section fail,there is no %s section data in bin file or no %s section configuration.\n", chip->chip_inst, fsm->section_name, fsm->section_name, fsm->section_name);
+		return CC_FILE_MISMATCH;
+	}
+	PRINT("%s %s %d Dev [%d] data_count = %u \n", __FILE__, __FUNCTION__, __LINE__, chip->chip_inst, data_count);
+
+	//进入正式升级流程
+	chip->progress = 0;
+	chip->status = POWER_FW_UPDATE_STATUS_ING;
+	chip->stage = stage;
+#ifndef __PC_DBG
+	if(0 != PowerChipPrepareFunction(chip))
+	{
+		return CC_ERR_SETUP_FW_UPDATE;
+	}
+#endif
+	fsm->data_count = data_count;
+	fsm->written_count = 0;
+	fsm->sec = 0;
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmPageWrite
+ * Description  : write registers of the next otp section page of fsm->section,
+ *                fsm->sec reaches section_count after the last page is written
+ * Params       : fsm:update state machine
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static int PDK_PowerChipFsmPageWrite(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+	irps5401_section_info *p_section_info = (irps5401_section_info *)chip->section_info;
+	power_chip_data_t *p_chip_data = (power_chip_data_t *)chip->image_buf;
+	INT32U i, rec;
+
+	while(fsm->sec < chip->section_count && p_section_info[fsm->sec].section != fsm->section)
+		fsm->sec++;
+	if(fsm->sec >= chip->section_count)
+		return CC_NORMAL;
+
+	i = fsm->sec;
+	PRINT("%s %s %d Dev [%d] page = 0x%02x ,data = :\n", __FILE__, __FUNCTION__, __LINE__, chip->chip_inst, p_section_info[i].page);
+#ifndef __PC_DBG
+	//减少I2C开销，每次切换section时写一次page，写具体寄存器时不再写page寄存器
+	if(0 != PDK_Irps5401SetPage(chip->chip, p_section_info[i].page))
+	{
+		TWARN("Update power chip %d %s section fail,set page %u fail\n", chip->chip_inst, fsm->section_name, p_section_info[i].page);
+		return CC_ERR_FLASH_WRITE;
+	}		
+#endif
+	for(rec = chip->sec_index[i].start; rec < chip->sec_index[i].end; rec++)
+	{
+		if((p_chip_data[rec].reg >= p_section_info[i].sec_start) && (p_chip_data[rec].reg <= p_section_info[i].sec_end))
+		{
+#ifndef __PC_DBG
+			if(0 != PDK_Irps5401WriteByteWithoutPageSet(chip->chip, p_chip_data[rec].reg, p_chip_data[rec].value))
+			{
+				TWARN("Update power chip %d %s section fail,write reg 0x%x fail\n", chip->chip_inst, fsm->section_name, p_chip_data[rec].reg);
+				return CC_ERR_FLASH_WRITE;
+			}
+#endif
+			PRINT("%04X %02X %02X\n",p_chip_data[rec].reg, p_chip_data[rec].value, p_chip_data[rec].mask);
+
+			fsm->written_count++;
+		}
+	}
+	PRINT("\n\n");
+	chip->progress = fsm->written_count * 100 / fsm->data_count;
+
+	for(fsm->sec++; fsm->sec < chip->section_count && p_section_info[fsm->sec].section != fsm->section; fsm->sec++);
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmVerifyStart
+ * Description  : start verifying registers after update, send NVM command to reload user section
+ * Params       : fsm:update state machine
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static int PDK_PowerChipFsmVerifyStart(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+	power_chip_arena_slot_t *slot = NULL;
+
+	chip->progress = 0;
+	chip->status = POWER_FW_UPDATE_STATUS_VERIFY;
+
+	slot = PDK_PowerChipArenaSlotGet(chip->chip_inst);
+	if(NULL == slot)
+	{
+		TWARN("Update power chip %d fail, no memory for verifying.\n", chip->chip_inst);
+		return CC_NO_MEM;
+	}
+	fsm->reg_value = slot->reg_value;
+	return PDK_Irps5401VerifyPrepare(chip, &fsm->verify_reg_count);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmVerifyRead
+ * Description  : read registers of the current page into fsm->reg_value,
+ *                fsm->reg goes beyond IRPS5401_REG_END after the last page is read
+ * Params       : fsm:update state machine
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static void PDK_PowerChipFsmVerifyRead(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+	INT32U page = fsm->reg / IRPS5401_PAGE_SIZE;
+
+	//第一页在读取前已经设置
+	if(fsm->reg != IRPS5401_REG_START)
+		PDK_Irps5401SetPage(chip->chip, page);
+	for(; fsm->reg <= IRPS5401_REG_END && fsm->reg / IRPS5401_PAGE_SIZE == page; fsm->reg++)
+	{
+		PDK_Irps5401ReadByteWithoutPageSet(chip->chip, fsm->reg, &fsm->reg_value[fsm->reg]);
+	}
+	chip->progress = VERIFY_PROGRESS_PREPARE + (fsm->reg - 1 - IRPS5401_REG_START)  * (VERIFY_PROGRESS_REG_READ - VERIFY_PROGRESS_PREPARE) / (IRPS5401_REG_END - IRPS5401_REG_START) ;
+	PRINT("Verify progress %d.\n", chip->progress);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmVerifyCompare
+ * Description  : compare registers read back with the image
+ * Params       : fsm:update state machine
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2024/11/21
+*****************************************************************************/
+static void PDK_PowerChipFsmVerifyCompare(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+	INT8U *reg_value = fsm->reg_value;
+	INT16U verify_reg_count = fsm->verify_reg_count, error_count = 0, current_count = 0;
+	INT32U i, rec;
+	irps5401_section_info *p_section_info = NULL;
+	power_chip_data_t *p_chip_data = NULL;
+	otp_section section = POWER_CHIP_SECTION_USER;		//只能校验user分区，conf分区重新 powerup后才会更新
+
+	chip->progress = VERIFY_PROGRESS_REG_READ;
+	PRINT("Verify progress %d ,error count = %d.\n", chip->progress, error_count);
+
+	p_chip_data = (power_chip_data_t *)chip->image_buf;
+	p_section_info = (irps5401_section_info *)chip->section_info;
+	for(i = 0; i < chip->section_count; i++)
+	{
+		if(p_section_info[i].section != section)
+		{
+			continue;
+		}
+
+		for(rec = chip->sec_index[i].start; rec < chip->sec_index[i].end; rec++)
+		{
+			if((p_chip_data[rec].reg >= p_section_info[i].sec_start) && (p_chip_data[rec].reg <= p_section_info[i].sec_end))
+			{
+				if(PDK_IfRegNeedVerified(chip, p_chip_data[rec].reg))
+				{
+					if((reg_value[p_chip_data[rec].reg] ^ p_chip_data[rec].value) & p_chip_data[rec].mask)
+					{
+						error_count++;
+						PRINT("Error reg = 0x%04x, image value = 0x%02x, read value = 0x%02x, mask = 0x%02x \n", p_chip_data[rec].reg, p_chip_data[rec].value, reg_value[p_chip_data[rec].reg], p_chip_data[rec].mask);
+					}
+					current_count++;
+				}
+			}
+		}
+		chip->progress = VERIFY_PROGRESS_REG_READ + current_count * (VERIFY_PROGRESS_REG_COMPARE - VERIFY_PROGRESS_REG_READ) /verify_reg_count ;
+		PRINT("Verify progress %d ,error count = %d.\n", chip->progress, error_count);
+	}
+	chip->progress = VERIFY_PROGRESS_REG_COMPARE;
+	if(error_count == 0)
+	{
+		chip->status = POWER_FW_UPDATE_STATUS_SUCCESS;
+	}
+	else
+	{
+		chip->status = POWER_FW_UPDATE_STATUS_FAIL;
+	}
+}
+
+//校验结束，无论校验流程是否出错，校验未成功都按校验失败处理
+static void PDK_PowerChipFsmVerifyDone(power_chip_fsm_t *fsm)
+{
+	if(fsm->FwUpdate->status == POWER_FW_UPDATE_STATUS_SUCCESS)
+	{
+		PDK_PostRedisMsgSetFwRev(ENTITY_POWER_CHIP, fsm->Devinst, 0);
+		fsm->result = 0;
+	}
+	else
+	{
+		//退出时状态会恢复为IDLE，校验失败通过返回值和error_code告知调用者
+		fsm->result = CC_ERR_FLASH_VERIFY;
+	}
+	fsm->wait_us = POWER_CHIP_SETTLE_TIME;
+	fsm->state = POWER_CHIP_FSM_FINISH;
+}
+
+//取消结束，退出升级模式。ret为CC_NORMAL时芯片寄存器与OTP中的配置一致（未写入或已重新加载），
+//否则寄存器中可能残留本次写入的部分数据，以CC_ERR_FLASH_WRITE告知调用者；
+//conf分区已经编程、user分区还没有编程时已消耗一次conf的可写次数，新旧配置混合，以CC_ERR_FW_UPDATE告知调用者
+static void PDK_PowerChipFsmCancelDone(power_chip_fsm_t *fsm, int ret)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+
+	if(CC_NORMAL == ret && fsm->conf_committed)
+	{
+		TWARN("Power chip %d firmware update is cancelled after conf section is programmed.\n", fsm->Devinst);
+		TAUDIT(LOG_CRIT, "Power chip %d firmware update is cancelled after conf section is programmed, chip runs new conf with old user settings, need to update again.\n", fsm->Devinst);
+		fsm->result = CC_ERR_FW_UPDATE;
+	}
+	else if(CC_NORMAL == ret)
+	{
+		fsm->result = CC_ERR_EXIT_FW_UPDATE;
+	}
+	else
+	{
+		TWARN("Power chip %d registers are not restored after cancel, error code 0x%x.\n", fsm->Devinst, ret);
+		TAUDIT(LOG_CRIT, "Power chip %d registers are not restored after cancel, need to update again or power cycle.\n", fsm->Devinst);
+		fsm->result = CC_ERR_FLASH_WRITE;
+	}
+	chip->progress = 0;
+	chip->status = POWER_FW_UPDATE_STATUS_CANCEL;
+	PDK_ExitPowerChipUpdateMode(chip, fsm->result);
+	fsm->wait_us = 0;
+	fsm->state = POWER_CHIP_FSM_DONE;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmSafePoint
+ * Description  : check if the update can be cancelled before the step of state. it can be cancelled
+ *                before writing a page, before the OTP commit and during verify, but never between an
+ *                NVM command and the check of its result
+ * Params       : state:next step of the state machine
+ * Return       : true: safe point
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static bool PDK_PowerChipFsmSafePoint(power_chip_fsm_state state)
+{
+	switch(state)
+	{
+	case POWER_CHIP_FSM_CHECK:
+	case POWER_CHIP_FSM_BASE_READ:
+	case POWER_CHIP_FSM_BASE_COMPARE:
+	case POWER_CHIP_FSM_PREPARE:
+	case POWER_CHIP_FSM_PAGE_WRITE:
+	case POWER_CHIP_FSM_COMMIT:
+	case POWER_CHIP_FSM_VERIFY:
+	case POWER_CHIP_FSM_VERIFY_CRC:
+	case POWER_CHIP_FSM_VERIFY_READ:
+	case POWER_CHIP_FSM_VERIFY_COMPARE:
+		return true;
+	default:
+		//POLL、VERIFY_POLL之前芯片正在执行NVM命令
+		return false;
+	}
+}
+
+static bool PDK_PowerChipFsmCancelled(power_chip_fsm_t *fsm)
+{
+	return PDK_PowerChipFsmSafePoint(fsm->state) && power_chip_cancel_gen[fsm->Devinst] == fsm->gen;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusHoldMaxSet
+ * Description  : set the max time an update holds the i2c bus continuously, the bus is released at
+ *                the next page boundary of writing, verifying or reading the baseline of a delta image
+ *                when the time is exceeded
+ * Params       : hold_us:max hold time in microseconds, 0: hold the bus for the whole update
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+void PDK_PowerChipBusHoldMaxSet(INT32U hold_us)
+{
+	power_chip_bus_hold_max = hold_us;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipPhaseHookSet
+ * Description  : set the function called before every step of the update state machine and once when
+ *                the update is finished, so that a benchmark can account time and i2c transfers of
+ *                every phase. it is called in the thread which runs the update and must not block
+ * Params       : hook:called with Devinst, power_chip_phase of the next step and the wait before it,
+ *                NULL: not called
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+void PDK_PowerChipPhaseHookSet(power_chip_phase_hook_t hook)
+{
+	power_chip_phase_hook = hook;
+}
+
+static power_chip_phase PDK_PowerChipFsmPhase(power_chip_fsm_t *fsm)
+{
+	switch(fsm->state)
+	{
+	case POWER_CHIP_FSM_CHECK:
+	case POWER_CHIP_FSM_BASE_READ:
+	case POWER_CHIP_FSM_BASE_COMPARE:
+		return POWER_CHIP_PHASE_PREFLIGHT;
+	case POWER_CHIP_FSM_PREPARE:
+	case POWER_CHIP_FSM_PAGE_WRITE:
+		return POWER_CHIP_SECTION_CONF == fsm->section ? POWER_CHIP_PHASE_CONF_WRITE : POWER_CHIP_PHASE_USER_WRITE;
+	case POWER_CHIP_FSM_COMMIT:
+	case POWER_CHIP_FSM_POLL:
+		return POWER_CHIP_PHASE_COMMIT;
+	case POWER_CHIP_FSM_VERIFY:
+	case POWER_CHIP_FSM_VERIFY_POLL:
+	case POWER_CHIP_FSM_VERIFY_CRC:
+		return POWER_CHIP_PHASE_VERIFY_PREPARE;
+	case POWER_CHIP_FSM_VERIFY_READ:
+		return POWER_CHIP_PHASE_VERIFY_READ;
+	case POWER_CHIP_FSM_VERIFY_COMPARE:
+		return POWER_CHIP_PHASE_VERIFY_COMPARE;
+	case POWER_CHIP_FSM_FINISH:
+	case POWER_CHIP_FSM_CANCEL_RELOAD:
+	case POWER_CHIP_FSM_CANCEL_POLL:
+	case POWER_CHIP_FSM_CANCEL_CRC:
+		return POWER_CHIP_PHASE_FINISH;
+	default:
+		return POWER_CHIP_PHASE_DONE;
+	}
+}
+
+static void PDK_PowerChipFsmPhaseNotify(power_chip_fsm_t *fsm, INT32U wait_us)
+{
+	power_chip_phase_hook_t hook = power_chip_phase_hook;
+
+	if(NULL != hook)
+		hook(fsm->Devinst, PDK_PowerChipFsmPhase(fsm), wait_us);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmBusYield
+ * Description  : release the bus at page boundary if it is held longer than power_chip_bus_hold_max,
+ *                the page register is saved to be restored by PDK_PowerChipFsmBusReacquire
+ * Params       : fsm:update state machine
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipFsmBusYield(power_chip_fsm_t *fsm)
+{
+	struct timespec now;
+	INT32U hold_max = power_chip_bus_hold_max;
+
+	//只在逐页写入、逐页读取的页边界让出总线，NVM命令执行期间和其他步骤之间不让出
+	if(0 == hold_max || (POWER_CHIP_FSM_PAGE_WRITE != fsm->state && POWER_CHIP_FSM_VERIFY_READ != fsm->state
+		&& POWER_CHIP_FSM_BASE_READ != fsm->state))
+		return;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if((INT64U)(now.tv_sec - fsm->hold_start.tv_sec) * 1000000
+		+ (now.tv_nsec - fsm->hold_start.tv_nsec) / 1000 < hold_max)
+		return;
+
+	if(0 != PDK_Irps5401GetPage(fsm->FwUpdate->chip, &fsm->page))
+		fsm->page = 0;
+	PDK_PowerChipMuxBlockLock(fsm->Devinst, 0);
+	fsm->yielded = 1;
+	//留出间隔让等待总线的其他访问者先获取
+	if(fsm->wait_us < POWER_CHIP_BUS_RETRY_TIME)
+		fsm->wait_us = POWER_CHIP_BUS_RETRY_TIME;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmBusReacquire
+ * Description  : take the bus released by PDK_PowerChipFsmBusYield again without blocking, restore
+ *                the page register, and the unlock state of the chip when writing registers
+ * Params       : fsm:update state machine
+ * Return       : true: the bus is taken; false: the bus is in use and fsm->wait_us is set to retry,
+ *                or the chip can not be restored and fsm is finished with CC_BUS_ERR
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static bool PDK_PowerChipFsmBusReacquire(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+
+	if(0 != PDK_PowerChipBusTryLock(PDK_PowerChipBusGet(fsm->Devinst)))
+	{
+		fsm->wait_us = POWER_CHIP_BUS_RETRY_TIME;
+		return false;
+	}
+	fsm->yielded = 0;
+	clock_gettime(CLOCK_MONOTONIC, &fsm->hold_start);
+
+	//让出期间其他访问者可能修改了page和解锁状态，写入寄存器前重新解锁，解锁寄存器在page 0
+#ifndef __PC_DBG
+	if(POWER_CHIP_FSM_PAGE_WRITE == fsm->state
+		&& (0 != PDK_Irps5401SetPage(chip->chip, 0) || 0 != PDK_IrpsUpdatePrepareCommon(chip)))
+	{
+		TWARN("Update power chip %d, unlock again after bus yield fail.\n", chip->chip_inst);
+		PDK_PowerChipFsmFail(fsm, CC_BUS_ERR, CC_BUS_ERR);
+		return false;
+	}
+#endif
+	//page错误时后续读写会访问其他page的寄存器，不能继续
+	if(0 != PDK_Irps5401SetPage(chip->chip, fsm->page))
+	{
+		TWARN("Update power chip %d, restore page %u after bus yield fail.\n", chip->chip_inst, fsm->page);
+		PDK_PowerChipFsmFail(fsm, CC_BUS_ERR, CC_BUS_ERR);
+		return false;
+	}
+	return true;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFsmStep
+ * Description  : run one step of the update state machine. a step never sleeps, the caller should
+ *                wait fsm->wait_us before the next step, so one thread can drive many chips
+ * Params       : fsm:update state machine started by PDK_PowerChipUpdateBegin
+ * Return       : true: more steps, false: finished, result is in fsm->result and update mode is exited
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static bool PDK_PowerChipFsmStep(power_chip_fsm_t *fsm)
+{
+	power_chip_update_t *chip = fsm->FwUpdate;
+	bool done = true;
+	int ret = CC_NORMAL;
+
+	PDK_PowerChipFsmPhaseNotify(fsm, fsm->wait_us);
+	fsm->wait_us = 0;
+	if(fsm->yielded && !PDK_PowerChipFsmBusReacquire(fsm))
+	{
+		if(POWER_CHIP_FSM_DONE != fsm->state)
+			return true;
+		PDK_PowerChipFsmPhaseNotify(fsm, 0);
+		return false;
+	}
+	if(PDK_PowerChipFsmCancelled(fsm))
+	{
+		TWARN("Power chip %d firmware update is cancelled before step %d.\n", fsm->Devinst, fsm->state);
+		TAUDIT(LOG_WARNING, "Power chip %d firmware update is cancelled", fsm->Devinst);
+		if(!fsm->dirty)
+		{
+			PDK_PowerChipFsmCancelDone(fsm, CC_NORMAL);
+			PDK_PowerChipFsmPhaseNotify(fsm, 0);
+			return false;
+		}
+		//已写入的页还没有编程到OTP，重新加载user分区后再释放总线，不保留新旧混合的配置
+		chip->progress = 0;
+		chip->status = POWER_FW_UPDATE_STATUS_CANCEL;
+		fsm->state = POWER_CHIP_FSM_CANCEL_RELOAD;
+	}
+	switch(fsm->state)
+	{
+	case POWER_CHIP_FSM_CHECK:
+		PDK_PowerChipFsmCheck(fsm);
+		break;
+
+	case POWER_CHIP_FSM_BASE_READ:
+		if(0 != PDK_PowerChipFsmBaseRead(fsm))
+		{
+			TWARN("Power chip %d firmware update, read baseline registers fail.\n", fsm->Devinst);
+			PDK_PowerChipFsmFail(fsm, CC_BUS_ERR, CC_BUS_ERR);
+			break;
+		}
+		if(fsm->sec >= board_power_chip_info[chip->chip_inst].section_count)
+			fsm->state = POWER_CHIP_FSM_BASE_COMPARE;
+		break;
+
+	case POWER_CHIP_FSM_BASE_COMPARE:
+		if(0 == PDK_PowerChipFsmDeltaCheck(fsm))
+			PDK_PowerChipFsmLeftCheck(fsm);
+		break;
+
+	case POWER_CHIP_FSM_PREPARE:
+		ret = PDK_PowerChipFsmPrepare(fsm);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmStageFail(fsm, ret);
+			break;
+		}
+		fsm->state = POWER_CHIP_FSM_PAGE_WRITE;
+		break;
+
+	case POWER_CHIP_FSM_PAGE_WRITE:
+		ret = PDK_PowerChipFsmPageWrite(fsm);
+		if(fsm->written_count)
+			fsm->dirty = 1;
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmStageFail(fsm, ret);
+			break;
+		}
+		if(fsm->sec >= chip->section_count)
+		{
+			PRINT("%s %s %d Dev [%d] written_count = %u \n", __FILE__, __FUNCTION__, __LINE__, chip->chip_inst, fsm->written_count);
+			fsm->state = POWER_CHIP_FSM_COMMIT;
+		}
+		break;
+
+	case POWER_CHIP_FSM_COMMIT:
+#ifndef __PC_DBG
+		if(POWER_CHIP_SECTION_CONF == fsm->section)
+			ret = PDK_IrpsUpdateConfSectionCommit(chip);
+		else
+			ret = PDK_IrpsUpdateUserSectionCommit(chip);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmStageFail(fsm, ret);
+			break;
+		}
+		fsm->wait_us = POWER_CHIP_PROGRAM_TIME;		//等待寄存器写入
+#endif
+		fsm->state = POWER_CHIP_FSM_POLL;
+		break;
+
+	case POWER_CHIP_FSM_POLL:
+#ifndef __PC_DBG
+		if(POWER_CHIP_SECTION_CONF == fsm->section)
+			ret = PDK_IrpsUpdateConfSectionPoll(chip);
+		else
+			ret = PDK_IrpsUpdateUserSectionPoll(chip);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmStageFail(fsm, ret);
+			break;
+		}
+#endif
+		fsm->dirty = 0;
+		fsm->conf_committed = (POWER_CHIP_SECTION_CONF == fsm->section && (fsm->mask & POWER_CHIP_SECTION_USER));
+		chip->progress = 100;
+		chip->status = POWER_FW_UPDATE_STATUS_SUCCESS;
+		if(POWER_CHIP_SECTION_CONF == fsm->section && (fsm->mask & POWER_CHIP_SECTION_USER))
+		{
+			fsm->section = POWER_CHIP_SECTION_USER;
+			fsm->state = POWER_CHIP_FSM_PREPARE;
+			break;
+		}
+		//user分区编程后等待芯片稳定再校验
+		if(POWER_CHIP_SECTION_USER == fsm->section)
+			fsm->wait_us = POWER_CHIP_SETTLE_TIME;
+		fsm->state = POWER_CHIP_FSM_VERIFY;
+		break;
+
+	case POWER_CHIP_FSM_VERIFY:
+		TINFO("%s %s %d Dev [%d] exit update.. \n", __FILE__, __FUNCTION__, __LINE__, fsm->Devinst);	
+		TINFO("%s %s %d Dev [%d] enter verify.. \n", __FILE__, __FUNCTION__, __LINE__, fsm->Devinst);	
+		ret = PDK_PowerChipFsmVerifyStart(fsm);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmVerifyDone(fsm);
+			break;
+		}
+		fsm->wait_us = POWER_CHIP_PROGRAM_TIME;
+		fsm->state = POWER_CHIP_FSM_VERIFY_POLL;
+		break;
+
+	case POWER_CHIP_FSM_VERIFY_POLL:
+		ret = PDK_Irps5401VerifyPoll(chip, &done);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmVerifyDone(fsm);
+			break;
+		}
+		if(!done)
+			fsm->wait_us = POWER_CHIP_PROGRAM_TIME;
+		fsm->state = POWER_CHIP_FSM_VERIFY_CRC;
+		break;
+
+	case POWER_CHIP_FSM_VERIFY_CRC:
+		ret = PDK_Irps5401VerifyCrcCheck(chip);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmVerifyDone(fsm);
+			break;
+		}
+		if(0 == fsm->verify_reg_count)
+		{
+			//差分镜像可能没有改动user分区的寄存器，不需要校验
+			if(POWER_CHIP_IMG_TYPE_DELTA != chip->img_type)
+				TWARN("Update power chip %d fail, verify_reg_count = 0 .\n", chip->chip_inst);
+			PDK_PowerChipFsmVerifyDone(fsm);
+			break;
+		}
+		chip->progress = VERIFY_PROGRESS_PREPARE;
+		//读取寄存器
+		memset(fsm->reg_value, 0, IRPS5401_REG_END - IRPS5401_REG_START + 1);
+		if(0 != PDK_Irps5401SetPage(chip->chip, 0))
+		{
+			TWARN("Update power chip %d fail, set page to page 0 fail.\n", chip->chip_inst);
+			PDK_PowerChipFsmVerifyDone(fsm);
+			break;
+		}
+		fsm->reg = IRPS5401_REG_START;
+		fsm->state = POWER_CHIP_FSM_VERIFY_READ;
+		break;
+
+	case POWER_CHIP_FSM_VERIFY_READ:
+		PDK_PowerChipFsmVerifyRead(fsm);
+		if(fsm->reg > IRPS5401_REG_END)
+			fsm->state = POWER_CHIP_FSM_VERIFY_COMPARE;
+		break;
+
+	case POWER_CHIP_FSM_VERIFY_COMPARE:
+		PDK_PowerChipFsmVerifyCompare(fsm);
+		PDK_PowerChipFsmVerifyDone(fsm);
+		break;
+
+	case POWER_CHIP_FSM_FINISH:
+		TINFO("%s %s %d Dev [%d] exit verify.. \n", __FILE__, __FUNCTION__, __LINE__, fsm->Devinst);	
+		chip->progress = 0;
+		chip->status = POWER_FW_UPDATE_STATUS_IDLE;
+		chip->stage = POWER_FW_UPDATE_STAGE_IDLE;
+		PDK_ExitPowerChipUpdateMode(chip, fsm->result);
+		fsm->state = POWER_CHIP_FSM_DONE;
+		break;
+
+	case POWER_CHIP_FSM_CANCEL_RELOAD:
+		ret = PDK_Irps5401RestorePrepare(chip);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmCancelDone(fsm, ret);
+			break;
+		}
+		fsm->wait_us = POWER_CHIP_PROGRAM_TIME;
+		fsm->state = POWER_CHIP_FSM_CANCEL_POLL;
+		break;
+
+	case POWER_CHIP_FSM_CANCEL_POLL:
+		ret = PDK_Irps5401VerifyPoll(chip, &done);
+		if(CC_NORMAL != ret)
+		{
+			PDK_PowerChipFsmCancelDone(fsm, ret);
+			break;
+		}
+		if(!done)
+			fsm->wait_us = POWER_CHIP_PROGRAM_TIME;
+		fsm->state = POWER_CHIP_FSM_CANCEL_CRC;
+		break;
+
+	case POWER_CHIP_FSM_CANCEL_CRC:
+		PDK_PowerChipFsmCancelDone(fsm, PDK_Irps5401VerifyCrcCheck(chip));
+		break;
+
+	case POWER_CHIP_FSM_DONE:
+	default:
+		break;
+	}
+	//每一步结束时发布一次状态，快照中的进度和状态总是同一步的结果
+	if(POWER_CHIP_FSM_DONE != fsm->state)
+	{
+		PDK_PowerChipFsmBusYield(fsm);
+		PDK_PowerChipStatePublish(chip);
+	}
+	else
+	{
+		PDK_PowerChipFsmPhaseNotify(fsm, 0);
+	}
+	return POWER_CHIP_FSM_DONE != fsm->state;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateBegin
+ * Description  : check the verified image in FwUpdate and start the update state machine
+ * Params       : FwUpdate:update info with verified image; Devinst:power chip to be updated;
+ *                mask:sections to be updated; fsm:state machine to be started
+ * Return       : IPMI Completion Code, update mode is exited if failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipUpdateBegin(power_chip_update_t *FwUpdate, INT8U Devinst, INT32U mask, power_chip_fsm_t *fsm)
+{
+	TINFO("%s %s %d Dev [%d] image size = 0x%x, fw ver = 0x%x \n", __FILE__, __FUNCTION__, __LINE__, Devinst,FwUpdate->imgSize, FwUpdate->FwRev);
+
+	if(FwUpdate->chip_inst >= sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t))
+	{
+		power_chip_hd_t *p_temp = (power_chip_hd_t *)FwUpdate->image_base;
+		TWARN("Power chip firmware update, firmware submodel is %s, mismach board information\n", p_temp->SubModel);
+		PDK_ExitPowerChipUpdateModeFail(FwUpdate, CC_FILE_MISMATCH);
+		return CC_FILE_MISMATCH;
+	}
+	power_chip_hd_t *p_temp = (power_chip_hd_t *)FwUpdate->image_base;
+	TINFO("%s %s %d Dev [%d] firmware submodel is %s\n",  __FILE__, __FUNCTION__, __LINE__, Devinst, p_temp->SubModel);
+	if(FwUpdate->chip_inst != Devinst)
+	{
+		TWARN("Power chip firmware update, input devinst = %d, firmware devinst = %d\n", Devinst, FwUpdate->chip_inst);
+		PDK_ExitPowerChipUpdateModeFail(FwUpdate, CC_ERR_FW_IMG_MODEL);
+		return CC_ERR_FW_IMG_MODEL;
+	}
+
+	memcpy(&FwUpdate->chip, &board_power_chip_info[FwUpdate->chip_inst].chip_info, sizeof(power_chip_info_t));
+
+	memset(fsm, 0, sizeof(power_chip_fsm_t));
+	fsm->FwUpdate = FwUpdate;
+	fsm->Devinst = Devinst;
+	fsm->mask = mask;
+	fsm->state = POWER_CHIP_FSM_CHECK;
+	fsm->gen = power_chip_update_gen[Devinst];
+	clock_gettime(CLOCK_MONOTONIC, &fsm->hold_start);
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateRun
+ * Description  : update power chip with the verified image in FwUpdate, exit update mode at the end.
+ *                run the same state machine as the update thread, but sleep between steps
+ * Params       : FwUpdate:update info with verified image; Devinst:power chip to be updated; mask:sections to be updated
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipUpdateRun(power_chip_update_t *FwUpdate, INT8U Devinst, INT32U mask)
+{
+	power_chip_fsm_t fsm;
+	int ret;
+
+	ret = PDK_PowerChipUpdateBegin(FwUpdate, Devinst, mask, &fsm);
+	if(CC_NORMAL != ret)
+		return ret;
+	while(PDK_PowerChipFsmStep(&fsm))
+	{
+		if(fsm.wait_us)
+			PDK_PowerChipDelay(fsm.wait_us);
+	}
+	return fsm.result;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateLoadFile
+ * Description  : enter update mode and read the image file copied from the uploaded file
+ * Params       : Devinst:power chip to be updated; mask:sections to be updated; block:see PDK_PowerChipUpdateEnter
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipUpdateLoadFile(INT8U Devinst, INT32U mask, bool block)
+{
+	power_chip_update_t *FwUpdate;
+	char used_file[64] = {0};
+	int ret  = 0;
+
+	ret = PDK_PowerChipUpdateEnter(Devinst, mask, block);
+	if(CC_NORMAL != ret)
+		return ret;
+	FwUpdate = &power_chip_update[Devinst];
+		
+	snprintf(used_file, sizeof(used_file), POWER_CHIP_USED_FILE, Devinst);
+	ret = PDK_PowerChipFwImageReadFrom(used_file, POWER_CHIP_FILE, FwUpdate);
+	if(CC_NORMAL != ret)
+	{
+		FwUpdate->image_verified_state = ret;
+		TWARN("Power chip firmware update, read firmware fail.\n");
+		PDK_ExitPowerChipUpdateModeFail(FwUpdate, ret);
+		return ret;
+	}
+	FwUpdate->image_verified_state = CC_NORMAL;
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateLoadBuf
+ * Description  : enter update mode and verify the image in memory
+ * Params       : see PDK_PowerChipUpdateFromBuf; block:see PDK_PowerChipUpdateEnter
+ * Return       : IPMI Completion Code, buf is released if failed, except CC_NODE_BUSY when block is false
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipUpdateLoadBuf(INT8U Devinst, INT32U mask, INT8U *buf, INT32U len, power_chip_img_release_t release, void *ctx, bool block)
+{
+	power_chip_update_t *FwUpdate;
+	power_chip_img_cache_t entry;
+	int ret  = 0;
+
+	if(NULL == buf || POWER_CHIP_FW_SIZE_MAX < len)
+	{
+		TWARN("Power Chip Firmware Image size %u out-of-range %d", len, POWER_CHIP_FW_SIZE_MAX);
+		if(buf && release)
+			release(buf, ctx);
+		return CC_FILE_SIZE_INVALID;
+	}
+
+	ret = PDK_PowerChipUpdateEnter(Devinst, mask, block);
+	if(CC_NODE_BUSY == ret && !block)
+		return ret;
+	if(CC_NORMAL != ret)
+	{
+		if(release)
+			release(buf, ctx);
+		return ret;
+	}
+	FwUpdate = &power_chip_update[Devinst];
+	FwUpdate->image_base = buf;
+	FwUpdate->image_release = release;
+	FwUpdate->image_release_ctx = ctx;
+
+	memset(&entry, 0, sizeof(entry));
+	ret = PDK_PowerChipFwImageParse(buf, len, &entry);
+	if(CC_NORMAL != ret)
+	{
+		FwUpdate->image_verified_state = ret;
+		TWARN("Power chip firmware update, verify firmware in memory fail.\n");
+		PDK_ExitPowerChipUpdateModeFail(FwUpdate, ret);
+		return ret;
+	}
+	FwUpdate->image_verified_state = CC_NORMAL;
+
+	ret = PDK_PowerChipFwImageSelect(FwUpdate, Devinst, buf, &entry);
+	if(CC_NORMAL != ret)
+	{
+		PDK_ExitPowerChipUpdateModeFail(FwUpdate, ret);
+		return ret;
+	}
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdate
+ * Description  : update power chip with the image file copied from the uploaded file
+ * Params       : Devinst:power chip to be updated; mask:sections to be updated
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipUpdate(INT8U Devinst, INT32U mask)
+{
+	int ret;
+
+	ret = PDK_PowerChipUpdateLoadFile(Devinst, mask, true);
+	if(CC_NORMAL != ret)
+		return ret;
+	return PDK_PowerChipUpdateRun(&power_chip_update[Devinst], Devinst, mask);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateFromBuf
+ * Description  : update power chip with the image in memory, e.g. received by IPMI or redfish,
+ *                the image is verified and written without any file access
+ * Params       : Devinst:power chip to be updated; mask:sections to be updated;
+ *                buf:image with header; len:bytes of image;
+ *                release:called once when buf is no longer used, even if the request is rejected, can be NULL
+ *                ctx:parameter of release
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipUpdateFromBuf(INT8U Devinst, INT32U mask, INT8U *buf, INT32U len, power_chip_img_release_t release, void *ctx)
+{
+	int ret;
+
+	ret = PDK_PowerChipUpdateLoadBuf(Devinst, mask, buf, len, release, ctx, true);
+	if(CC_NORMAL != ret)
+		return ret;
+	return PDK_PowerChipUpdateRun(&power_chip_update[Devinst], Devinst, mask);
+}
+
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFwFileCheck
+ * Description  : check the uploaded image file before updating the power chip
+ * Params       : Devinst:power chip to be updated
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipFwFileCheck(INT8U Devinst)
+{
+	int ret;
+
+	if(access(POWER_CHIP_FILE, F_OK))
+	{
+		TAUDIT(LOG_WARNING,"Power chip firmware file %s does not exist.\n", POWER_CHIP_FILE);
+		TWARN("Power chip firmware file %s does not exist.\n", POWER_CHIP_FILE);
+		return CC_FILE_NOT_EXIST;
+	}
+
+	//上传时已经校验失败的镜像直接拒绝，不再复制和读取
+	ret = PDK_PowerChipStagedImgCheck(Devinst);
+	if(CC_NORMAL != ret)
+	{
+		TAUDIT(LOG_WARNING,"Power chip %d firmware file %s is rejected, error code 0x%x.\n", Devinst, POWER_CHIP_FILE, ret);
+		power_chip_update[Devinst].image_verified_state = ret;
+		power_chip_update[Devinst].error_code = ret;
+		power_chip_update[Devinst].status = POWER_FW_UPDATE_STATUS_FAIL;
+		PDK_PowerChipStatePublish(&power_chip_update[Devinst]);
+		return ret;
+	}
+	return CC_NORMAL;
+}
+
+static void PDK_PowerChipFwFileCopy(INT8U Devinst)
+{
+	char used_file[64] = {0};
+	char cmd[128] = {0};
+
+	snprintf(used_file, sizeof(used_file), POWER_CHIP_USED_FILE, Devinst);
+	snprintf(cmd, sizeof(cmd), "cp -p %s %s", POWER_CHIP_FILE, used_file);		//保留修改时间，文件未变化时可以复用校验结果
+	safe_system(cmd);
+}
+
+void *PDK_PowerChipFwUpdateTask(void *pArg)
+{
+    power_chip_req_t *pFwUpdate = (power_chip_req_t *)pArg;
+
+    prctl(PR_SET_NAME, __FUNCTION__, 0, 0, 0);
+    pthread_detach(pthread_self());
+
+	if(NULL == pFwUpdate)return 0;
+
+	//兼容原来每个请求一个线程的调用方式，请求交给总线升级线程执行
+	PDK_PowerChipFwUpdateEnqueue(pFwUpdate->Devinst, pFwUpdate->mask);
+    return 0;
+}
+
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFwUpdateBufTask
+ * Description  : thread of updating power chip with the image in memory
+ * Params       : pArg:power_chip_buf_req_t, e.g. element of power_chip_buf_req
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+void *PDK_PowerChipFwUpdateBufTask(void *pArg)
+{
+    power_chip_buf_req_t *pFwUpdate = (power_chip_buf_req_t *)pArg;
+
+    prctl(PR_SET_NAME, __FUNCTION__, 0, 0, 0);
+    pthread_detach(pthread_self());
+
+	if(NULL == pFwUpdate)return 0;
+
+	PDK_PowerChipFwUpdateBufEnqueue(pFwUpdate);
+    return 0;
+}
+
+
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipSchedJobProgress
+ * Description  : progress of one chip, conf/user section update and verify share 100 percent
+ * Params       : job:scheduled job
+ * Return       : progress, 0~100
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static INT8U PDK_PowerChipSchedJobProgress(power_chip_sched_job_t *job)
+{
+	power_chip_update_state_t state;
+	INT32U phase_count = 1, phase = 0;
+
+	if(POWER_CHIP_SCHED_JOB_WAIT == job->state)
+		return 0;
+	if(POWER_CHIP_SCHED_JOB_RUN != job->state)
+		return 100;
+	if(0 != PDK_PowerChipUpdateStateGet(job->req.Devinst, &state))
+		return 0;
+
+	//升级过程依次为conf、user、校验，每个阶段的progress都从0开始
+	if(job->req.mask & POWER_CHIP_SECTION_CONF)phase_count++;
+	if(job->req.mask & POWER_CHIP_SECTION_USER)phase_count++;
+	if(state.status == POWER_FW_UPDATE_STATUS_VERIFY)
+		phase = phase_count - 1;
+	else if(state.stage_mask == POWER_CHIP_SECTION_USER && (job->req.mask & POWER_CHIP_SECTION_CONF))
+		phase = 1;
+
+	return (phase * 100 + (state.progress > 100 ? 100 : state.progress)) / phase_count;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipSchedJobSet
+ * Description  : update state of scheduled job, wake up the scheduler when the job is finished
+ * Params       : job:scheduled job; state:new state; error_code:completion code of finished job
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipSchedJobSet(power_chip_sched_job_t *job, power_chip_sched_job_state state, INT8U error_code)
 {
-	power_chip_update_t *FwUpdate;
-	int ret  = 0;
-	char *p_fw = NULL;
-	INT8U silcon_version = 0;
+	pthread_mutex_lock(&PowerChipSchedMutex);
+	job->state = state;
+	job->error_code = error_code;
+	if(POWER_CHIP_SCHED_JOB_SUCCESS == state)
+		power_chip_sched.success_count++;
+	else if(POWER_CHIP_SCHED_JOB_FAIL == state)
+		power_chip_sched.fail_count++;
+	pthread_cond_broadcast(&PowerChipSchedCond);
+	pthread_mutex_unlock(&PowerChipSchedMutex);
+}
+
+static void PDK_PowerChipBusJobFinish(power_chip_bus_job_t *job, int ret)
+{
+	if(job->sched_job)
+		PDK_PowerChipSchedJobSet(job->sched_job, CC_NORMAL == ret ? POWER_CHIP_SCHED_JOB_SUCCESS : POWER_CHIP_SCHED_JOB_FAIL, ret);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusJobStep
+ * Description  : run one step of the running request of the i2c bus
+ * Params       : bus:i2c bus; wait_us:output, time to wait before the next step
+ * Return       : true: more steps, false: the request is finished
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static bool PDK_PowerChipBusJobStep(power_chip_bus_t *bus, INT32U *wait_us)
+{
+	power_chip_bus_job_t *job = &bus->running;
+	power_chip_buf_req_t *req = &job->req;
+	int ret;
 
-	if(Devinst > sizeof(board_power_chip_info)/sizeof(board_power_chip_info_t) || Devinst >= POWER_CHIP_COUNT_MAX)
+	*wait_us = 0;
+	if(bus->started)
 	{
-		TWARN("Input Devinst = %d is larger.\n", Devinst);
-		return CC_ERR_FW_UPDATE;
+		if(PDK_PowerChipFsmStep(&bus->fsm))
+		{
+			*wait_us = bus->fsm.wait_us;
+			return true;
+		}
+		PDK_PowerChipBusJobFinish(job, bus->fsm.result);
+		return false;
 	}
-	
-	if(!(mask&POWER_CHIP_SECTION_CONF || mask&POWER_CHIP_SECTION_USER))
+
+	//进入升级模式前被取消
+	pthread_mutex_lock(&PowerChipLoopMutex);
+	ret = bus->cancel;
+	pthread_mutex_unlock(&PowerChipLoopMutex);
+	if(ret)
 	{
-		TWARN("Input mask = %d is illegal.\n", mask);
-		return CC_ERR_FW_UPDATE;
+		TAUDIT(LOG_WARNING, "Power chip %d firmware update is cancelled", req->Devinst);
+		if(req->buf && req->release)
+			req->release(req->buf, req->ctx);
+		PDK_PowerChipBusJobFinish(job, CC_ERR_EXIT_FW_UPDATE);
+		return false;
 	}
 
-	FwUpdate = &power_chip_update[Devinst];
-
-	if(power_chip_update[Devinst].status == POWER_FW_UPDATE_STATUS_ING 
-		|| power_chip_update[Devinst].status == POWER_FW_UPDATE_STATUS_VERIFY 
-		|| power_chip_update[Devinst].is_under_update)
+	//进入升级模式，总线被占用时稍后重试，镜像文件只检查和复制一次
+	if(job->sched_job && POWER_CHIP_SCHED_JOB_WAIT == job->sched_job->state)
+		PDK_PowerChipSchedJobSet(job->sched_job, POWER_CHIP_SCHED_JOB_RUN, 0);
+	if(req->buf)
 	{
-		TWARN("Firmware is updating.\n");
-		FwUpdate->error_code = CC_ERR_EXECUTING;
-		FwUpdate->status = POWER_FW_UPDATE_STATUS_FAIL;
-		return CC_ERR_EXECUTING;
+		ret = PDK_PowerChipUpdateLoadBuf(req->Devinst, req->mask, req->buf, req->len, req->release, req->ctx, false);
 	}
-	TINFO("%s %s %d Dev [%d] enter update...\n", __FILE__, __FUNCTION__, __LINE__, Devinst);
-	PDK_Irps5401MuxBlockLock(1);
-	memset(FwUpdate, 0, sizeof(power_chip_update_t));
-	FwUpdate->is_under_update = 1;
-		
-	ret = PDK_PowerChipFwImageRead(POWER_CHIP_USED_FILE, FwUpdate);
-	if(CC_NORMAL != ret)
+	else
 	{
-		FwUpdate->image_verified_state = ret;
-		TWARN("Power chip firmware update, read firmware fail.\n");
-		PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, ret);
-		return ret;
+		if(!bus->file_ready)
+		{
+			ret = PDK_PowerChipFwFileCheck(req->Devinst);
+			if(CC_NORMAL != ret)
+			{
+				PDK_PowerChipBusJobFinish(job, ret);
+				return false;
+			}
+			PDK_PowerChipFwFileCopy(req->Devinst);
+			bus->file_ready = 1;
+		}
+		ret = PDK_PowerChipUpdateLoadFile(req->Devinst, req->mask, false);
 	}
-	FwUpdate->image_verified_state = CC_NORMAL;
-	TINFO("%s %s %d Dev [%d] image size = 0x%x, fw ver = 0x%x \n", __FILE__, __FUNCTION__, __LINE__, Devinst,FwUpdate->imgSize, FwUpdate->FwRev);
-
-	p_fw = FwUpdate->image_buf - sizeof(power_chip_hd_t);
-	if(FwUpdate->chip_inst >= sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t))
+	if(CC_NODE_BUSY == ret)
 	{
-		power_chip_hd_t *p_temp = (power_chip_hd_t *)p_fw;
-		TWARN("Power chip firmware update, firmware submodel is %s, mismach board information\n", p_temp->SubModel);
-		PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, CC_FILE_MISMATCH);
-		return CC_FILE_MISMATCH;
+		*wait_us = POWER_CHIP_BUS_RETRY_TIME;
+		return true;
 	}
-	power_chip_hd_t *p_temp = (power_chip_hd_t *)p_fw;
-	TINFO("%s %s %d Dev [%d] firmware submodel is %s\n",  __FILE__, __FUNCTION__, __LINE__, Devinst, p_temp->SubModel);
-	if(FwUpdate->chip_inst != Devinst)
+	if(CC_NORMAL == ret)
+		ret = PDK_PowerChipUpdateBegin(&power_chip_update[req->Devinst], req->Devinst, req->mask, &bus->fsm);
+	if(CC_NORMAL != ret)
 	{
-		TWARN("Power chip firmware update, input devinst = %d, firmware devinst = %d\n", Devinst, FwUpdate->chip_inst);
-		PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw,  CC_ERR_FW_IMG_MODEL);
-		return CC_ERR_FW_IMG_MODEL;
+		PDK_PowerChipBusJobFinish(job, ret);
+		return false;
 	}
+	TAUDIT(LOG_INFO, "Power chip %d firmware Firmware Update%s, update mask 0x%x", req->Devinst, req->buf ? " from memory" : "", req->mask);
+	bus->started = 1;
+	//加载期间到达的取消请求在下一个安全点生效
+	pthread_mutex_lock(&PowerChipLoopMutex);
+	if(bus->cancel)
+		power_chip_cancel_gen[req->Devinst] = bus->fsm.gen;
+	pthread_mutex_unlock(&PowerChipLoopMutex);
+	return true;
+}
 
-	memcpy(&FwUpdate->chip, &board_power_chip_info[FwUpdate->chip_inst].chip_info, sizeof(power_chip_info_t));
-	
-	ret = PDK_Irps5401SiliconVersionGet(FwUpdate->chip, &silcon_version);
-	if(ret != 0)
-	{
-		TWARN("Power chip firmware update, get chip silicon version  fail.\n");
-		PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw,  CC_ERR_FW_IMG_MODEL);
-		return CC_BUS_ERR;
-	}
-	TINFO("Power chip firmware update, chip silicon version:0x%x\n", silcon_version);
-	if(silcon_version < IRPS5401_SILICON_VERSION_MIN)
+static void PDK_PowerChipTimeAdd(struct timespec *t, INT32U us)
+{
+	t->tv_sec += us / 1000000;
+	t->tv_nsec += (us % 1000000) * 1000;
+	if(t->tv_nsec >= 1000000000)
 	{
-		TWARN("Power chip firmware update, chip silicon [0x%x] is lower than limition [0x%x].\n", silcon_version, IRPS5401_SILICON_VERSION_MIN);
-		PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw,  CC_ERR_FW_IMG_MODEL);
-		return CC_FWUPDATE_NOT_SUPPORTED;
+		t->tv_sec++;
+		t->tv_nsec -= 1000000000;
 	}
+}
 
-	if(mask & POWER_CHIP_SECTION_CONF)
+static bool PDK_PowerChipTimeBefore(struct timespec *a, struct timespec *b)
+{
+	return (a->tv_sec < b->tv_sec) || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipLoopTask
+ * Description  : update thread of one i2c bus, drive the running request of the bus step by step,
+ *                waiting between steps is done by timer. every bus has its own thread, so the i2c
+ *                transfers and file copy of one bus never delay the chips on other buses
+ * Params       : pArg:power_chip_bus_t of the thread
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void *PDK_PowerChipLoopTask(void *pArg)
+{
+	power_chip_bus_t *bus = (power_chip_bus_t *)pArg;
+	struct timespec now;
+	INT32U wait_us;
+
+	prctl(PR_SET_NAME, __FUNCTION__, 0, 0, 0);
+	pthread_detach(pthread_self());
+
+	while(1)
 	{
-		if(0 != PDK_Irps5401ConfWriteLeftGet(FwUpdate->chip, &FwUpdate->conf_wirte_left))
-		{
-			TWARN("Power chip %d firmware update, get conf write left count fail.\n", Devinst);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, CC_DEV_IN_FIRMWARE_PROTECT_MODE);
-			return CC_DEV_IN_FIRMWARE_PROTECT_MODE;
-		}
-		TINFO("%s %s %d Dev [%d] FwUpdate->conf_wirte_left = %u \n", __FILE__, __FUNCTION__, __LINE__, Devinst,FwUpdate->conf_wirte_left);
-		if(FwUpdate->conf_wirte_left <= POWER_CHIP_CONF_WARN_COUNT)
+		//取出新请求，等待下一步到期
+		pthread_mutex_lock(&PowerChipLoopMutex);
+		while(1)
 		{
-			TWARN("Power chip %d firmware update, conf section has reached the left warning limitation %d.\n", Devinst, POWER_CHIP_CONF_WARN_COUNT);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw,  CC_ERR_FW_UPDATE_CAPABILITY);
-			return CC_ERR_FW_UPDATE_CAPABILITY;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if(!bus->is_running && bus->queue_count)
+			{
+				bus->running = bus->queue[bus->queue_head];
+				bus->queue_head = (bus->queue_head + 1) % POWER_CHIP_BUS_QUEUE_LEN;
+				bus->queue_count--;
+				bus->is_running = 1;
+				bus->started = 0;
+				bus->file_ready = 0;
+				bus->cancel = 0;
+				bus->wake = 0;
+				bus->due = now;
+			}
+			//取消请求只在安全点提前执行，不缩短NVM命令的等待时间
+			if(bus->wake)
+			{
+				bus->wake = 0;
+				if(bus->is_running && (!bus->started || PDK_PowerChipFsmSafePoint(bus->fsm.state)))
+					bus->due = now;
+			}
+			if(bus->is_running && !PDK_PowerChipTimeBefore(&now, &bus->due))
+				break;
+			if(bus->is_running)
+				pthread_cond_timedwait(&bus->cond, &PowerChipLoopMutex, &bus->due);
+			else
+				pthread_cond_wait(&bus->cond, &PowerChipLoopMutex);
 		}
-		if(FwUpdate->conf_wirte_left == 0)
+		pthread_mutex_unlock(&PowerChipLoopMutex);
+
+		//is_running只由本线程修改，执行时不持有PowerChipLoopMutex，不影响提交请求
+		if(PDK_PowerChipBusJobStep(bus, &wait_us))
 		{
-			TWARN("Power chip %d firmware update, conf section has used up all %d times update count.\n", Devinst, IRPS5401_CONF_WRITE_MAX_COUNT);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, CC_FWUPDATE_NOT_SUPPORTED);
-			return CC_FWUPDATE_NOT_SUPPORTED;
+			clock_gettime(CLOCK_MONOTONIC, &bus->due);
+			PDK_PowerChipTimeAdd(&bus->due, wait_us);
+			continue;
 		}
+		pthread_mutex_lock(&PowerChipLoopMutex);
+		bus->is_running = 0;
+		pthread_mutex_unlock(&PowerChipLoopMutex);
 	}
-	
-	if(mask & POWER_CHIP_SECTION_USER)
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipLoopStart
+ * Description  : start the update thread of every i2c bus
+ * Params       : 
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static void PDK_PowerChipLoopStart(void)
+{
+	pthread_condattr_t attr;
+	INT32U i;
+
+	pthread_once(&power_chip_bus_once, PDK_PowerChipBusInit);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	for(i = 0; i < POWER_CHIP_COUNT_MAX && power_chip_bus[i].i2c_dev; i++)
 	{
-		if(0 != PDK_Irps5401UserWriteLeftGet(FwUpdate->chip, &FwUpdate->user_wirte_left))
+		pthread_cond_init(&power_chip_bus[i].cond, &attr);
+		if(0 != pthread_create(&power_chip_bus[i].thread, NULL, PDK_PowerChipLoopTask, &power_chip_bus[i]))
 		{
-			TWARN("Power chip firmware update, get user write left count fail.\n", Devinst,FwUpdate->chip_inst);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, CC_ERR_FW_UPDATE_CAPABILITY);
-			return CC_ERR_FW_UPDATE_CAPABILITY;
+			TWARN("Create power chip update thread of bus %s fail.\n", power_chip_bus[i].i2c_dev);
+			power_chip_bus[i].thread = 0;
 		}
-		TINFO("%s %s %d Dev [%d] FwUpdate->user_wirte_left = %u \n", __FILE__, __FUNCTION__, __LINE__, Devinst, FwUpdate->user_wirte_left);
-		if(FwUpdate->user_wirte_left <= POWER_CHIP_USER_WARN_COUNT)
+	}
+	pthread_condattr_destroy(&attr);
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusJobSame
+ * Description  : check if two update requests are the same
+ * Params       : a, b:update requests
+ * Return       : true: same
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static bool PDK_PowerChipBusJobSame(power_chip_bus_job_t *a, power_chip_bus_job_t *b)
+{
+	//只比较长度和内容SHA256，不访问另一个请求的镜像缓存，其可能正在被释放；
+	//上传文件的请求比较入队时文件的SHA256，升级过程中重新上传的不同文件不会被当作相同的请求丢弃
+	return (a->req.mask == b->req.mask)
+		&& ((NULL == a->req.buf) == (NULL == b->req.buf))
+		&& (a->req.len == b->req.len)
+		&& (0 == memcmp(a->digest, b->digest, POWER_CHIP_IMG_DIGEST_SIZE));
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipBusJobEnqueue
+ * Description  : put update request into the queue of the i2c bus which the chip is on.
+ *                a request same as the queued or running one of the chip is accepted without
+ *                being queued again; a different request of the chip, or a full queue, is rejected
+ * Params       : req:update request, ownership of req->buf is passed to the queue even if rejected
+ *                sched_job:scheduled job of req, NULL if not submitted by the scheduler
+ * Return       : IPMI Completion Code
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+static int PDK_PowerChipBusJobEnqueue(power_chip_buf_req_t *req, power_chip_sched_job_t *sched_job)
+{
+	power_chip_bus_t *bus;
+	power_chip_bus_job_t job, *other = NULL;
+	INT32U i;
+	int ret = CC_NORMAL;
+
+	memset(&job, 0, sizeof(job));
+	job.req = *req;
+	job.sched_job = sched_job;
+
+	bus = PDK_PowerChipBusGet(req->Devinst);
+	if(NULL == bus)
+	{
+		TWARN("Input Devinst = %d is larger.\n", req->Devinst);
+		ret = CC_ERR_FW_UPDATE;
+		goto release;
+	}
+	if(req->buf && POWER_CHIP_FW_SIZE_MAX < req->len)
+	{
+		TWARN("Power Chip Firmware Image size %u out-of-range %d", req->len, POWER_CHIP_FW_SIZE_MAX);
+		ret = CC_FILE_SIZE_INVALID;
+		goto release;
+	}
+	pthread_once(&power_chip_loop_once, PDK_PowerChipLoopStart);
+	if(0 == bus->thread)
+	{
+		ret = CC_UNSPECIFIED_ERR;
+		goto release;
+	}
+	if(req->buf && 0 != PDK_PowerChipImgDigest(req->buf, req->len, job.digest))
+	{
+		ret = CC_UNSPECIFIED_ERR;
+		goto release;
+	}
+	if(NULL == req->buf && 0 != PDK_PowerChipFileDigest(POWER_CHIP_FILE, job.digest))
+	{
+		TWARN("Power chip %d firmware update, read %s fail.\n", req->Devinst, POWER_CHIP_FILE);
+		ret = CC_FILE_NOT_EXIST;
+		goto release;
+	}
+
+	pthread_mutex_lock(&PowerChipLoopMutex);
+	if(bus->is_running && bus->running.req.Devinst == req->Devinst)
+		other = &bus->running;
+	for(i = 0; NULL == other && i < bus->queue_count; i++)
+	{
+		if(bus->queue[(bus->queue_head + i) % POWER_CHIP_BUS_QUEUE_LEN].req.Devinst == req->Devinst)
+			other = &bus->queue[(bus->queue_head + i) % POWER_CHIP_BUS_QUEUE_LEN];
+	}
+	if(other)
+	{
+		//多芯片升级需要等待自己提交的请求完成，不合并
+		if(NULL == sched_job && NULL == other->sched_job && PDK_PowerChipBusJobSame(&job, other))
 		{
-			TWARN("Power chip %d firmware update, user section has reached the left warning limitation %d.\n", Devinst, POWER_CHIP_USER_WARN_COUNT);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, CC_ERR_FW_UPDATE_CAPABILITY);
-			return CC_ERR_FW_UPDATE_CAPABILITY;
+			TINFO("Power chip %d firmware update request is duplicated, ignored.\n", req->Devinst);
+			if(req->buf != other->req.buf)
+				goto unlock_release;
+			pthread_mutex_unlock(&PowerChipLoopMutex);
+			return CC_NORMAL;
 		}
-		if(FwUpdate->user_wirte_left == 0)
+		TWARN("Power chip %d firmware update is pending.\n", req->Devinst);
+		ret = CC_ERR_EXECUTING;
+		goto unlock_release;
+	}
+	if(POWER_CHIP_BUS_QUEUE_LEN <= bus->queue_count)
+	{
+		TWARN("Power chip update queue of bus %s is full.\n", bus->i2c_dev);
+		ret = CC_NODE_BUSY;
+		goto unlock_release;
+	}
+	bus->queue[(bus->queue_head + bus->queue_count) % POWER_CHIP_BUS_QUEUE_LEN] = job;
+	bus->queue_count++;
+	pthread_cond_signal(&bus->cond);
+	pthread_mutex_unlock(&PowerChipLoopMutex);
+	return CC_NORMAL;
+
+unlock_release:
+	pthread_mutex_unlock(&PowerChipLoopMutex);
+release:
+	if(req->buf && req->release)
+		req->release(req->buf, req->ctx);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFwUpdateEnqueue
+ * Description  : request updating power chip with the uploaded image file, return at once
+ * Params       : Devinst:power chip to be updated; mask:sections to be updated
+ * Return       : IPMI Completion Code, CC_NORMAL means the request is queued or is the same as the pending one
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipFwUpdateEnqueue(INT8U Devinst, INT32U mask)
+{
+	power_chip_buf_req_t req;
+	int ret;
+
+	memset(&req, 0, sizeof(req));
+	req.Devinst = Devinst;
+	req.mask = mask;
+	ret = PDK_PowerChipBusJobEnqueue(&req, NULL);
+	if(CC_NORMAL != ret)
+		TAUDIT(LOG_WARNING, "Power chip %d firmware update request is rejected, error code 0x%x", Devinst, ret);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipFwUpdateBufEnqueue
+ * Description  : request updating power chip with the image in memory, return at once
+ * Params       : req:update request, ownership of req->buf is passed even if the request is rejected
+ * Return       : IPMI Completion Code, CC_NORMAL means the request is queued or is the same as the pending one
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipFwUpdateBufEnqueue(power_chip_buf_req_t *req)
+{
+	int ret;
+
+	if(NULL == req || NULL == req->buf)
+		return CC_PARAM_OUT_OF_RANGE;
+	ret = PDK_PowerChipBusJobEnqueue(req, NULL);
+	if(CC_NORMAL != ret)
+		TAUDIT(LOG_WARNING, "Power chip %d firmware update request is rejected, error code 0x%x", req->Devinst, ret);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipUpdateCancel
+ * Description  : cancel the queued or running update of power chip. a queued request is removed at
+ *                once, a running update stops at the next safe point: before writing a page, before
+ *                the OTP commit, or during verify, never in the middle of an NVM command
+ * Params       : Devinst:power chip
+ * Return       : IPMI Completion Code, CC_PARAM_OUT_OF_RANGE if no update of the chip
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipUpdateCancel(INT8U Devinst)
+{
+	power_chip_bus_t *bus;
+	power_chip_bus_job_t job;
+	INT32U i, idx;
+	bool removed = false, found = false;
+
+	bus = PDK_PowerChipBusGet(Devinst);
+	if(NULL == bus)
+		return CC_ERR_FW_UPDATE;
+
+	pthread_mutex_lock(&PowerChipLoopMutex);
+	for(i = 0; i < bus->queue_count; i++)
+	{
+		idx = (bus->queue_head + i) % POWER_CHIP_BUS_QUEUE_LEN;
+		if(bus->queue[idx].req.Devinst != Devinst)
+			continue;
+		job = bus->queue[idx];
+		for(; i + 1 < bus->queue_count; i++)
 		{
-			TWARN("Power chip %d firmware update, user section has used up all %d times update count.\n", Devinst, IRPS5401_USER_WRITE_MAX_COUNT);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, CC_FWUPDATE_NOT_SUPPORTED);
-			return CC_FWUPDATE_NOT_SUPPORTED;
+			bus->queue[(bus->queue_head + i) % POWER_CHIP_BUS_QUEUE_LEN] = bus->queue[(bus->queue_head + i + 1) % POWER_CHIP_BUS_QUEUE_LEN];
 		}
+		bus->queue_count--;
+		removed = true;
+		break;
 	}
-	
+	if(bus->is_running && bus->running.req.Devinst == Devinst)
+	{
+		bus->cancel = 1;
+		bus->wake = 1;
+		found = true;
+	}
+	//直接调用PDK_PowerChipUpdate的升级同样可以取消
+	if(power_chip_update[Devinst].is_under_update)
+	{
+		power_chip_cancel_gen[Devinst] = power_chip_update_gen[Devinst];
+		found = true;
+	}
+	if(bus->thread)
+		pthread_cond_signal(&bus->cond);
+	pthread_mutex_unlock(&PowerChipLoopMutex);
 
-	FwUpdate->section_info = board_power_chip_info[FwUpdate->chip_inst].section_info;
-	FwUpdate->section_count = board_power_chip_info[FwUpdate->chip_inst].section_count;
-	if(mask & POWER_CHIP_SECTION_CONF)
+	if(removed)
+	{
+		if(job.req.buf && job.req.release)
+			job.req.release(job.req.buf, job.req.ctx);
+		PDK_PowerChipBusJobFinish(&job, CC_ERR_EXIT_FW_UPDATE);
+	}
+	if(!removed && !found)
+		return CC_PARAM_OUT_OF_RANGE;
+	TAUDIT(LOG_INFO, "Power chip %d firmware update cancel is requested", Devinst);
+	return CC_NORMAL;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipSchedUpdate
+ * Description  : update several power chips, jobs are put into the queue of the i2c bus which each
+ *                chip is on, so chips on different buses are updated at the same time and chips on the
+ *                same bus one after another. return after all jobs are finished,
+ *                the whole progress can be queried by PDK_PowerChipSchedStatusGet meanwhile
+ * Params       : jobs:update requests, buf is NULL means the uploaded image file, ownership of buf is
+ *                passed to the scheduler as PDK_PowerChipUpdateFromBuf; job_count:number of jobs
+ * Return       : CC_NORMAL if all jobs succeed, otherwise completion code of the first failed job
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipSchedUpdate(power_chip_buf_req_t *jobs, INT8U job_count)
+{
+	power_chip_bus_t *bus[POWER_CHIP_COUNT_MAX];
+	INT32U i, j;
+	int ret = CC_NORMAL;
+
+	if(NULL == jobs)
+		return CC_PARAM_OUT_OF_RANGE;
+
+	pthread_mutex_lock(&PowerChipSchedMutex);
+	if(power_chip_sched.is_running)
+	{
+		TWARN("Power chip scheduled update is running.\n");
+		ret = CC_NODE_BUSY;
+	}
+	else if(0 == job_count || POWER_CHIP_COUNT_MAX < job_count)
 	{
-		FwUpdate->stage_mask = POWER_CHIP_SECTION_CONF;
-		FwUpdate->progress = 0;
-		FwUpdate->status = POWER_FW_UPDATE_STATUS_IDLE;
-		ret = PDK_Irps5401Update(FwUpdate);
-		if(0 != ret)
+		TWARN("Power chip scheduled update, job count %d is illegal.\n", job_count);
+		ret = CC_PARAM_OUT_OF_RANGE;
+	}
+	for(i = 0; CC_NORMAL == ret && i < job_count; i++)
+	{
+		for(j = 0; j < i; j++)
 		{
-			TWARN("Power chip %d firmware update conf section fail.\n", Devinst);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, ret);
-			return ret;
+			if(jobs[j].Devinst == jobs[i].Devinst)
+			{
+				TWARN("Power chip scheduled update, Devinst %d is requested more than once.\n", jobs[i].Devinst);
+				ret = CC_PARAM_OUT_OF_RANGE;
+			}
 		}
 	}
-	if(mask & POWER_CHIP_SECTION_USER)
+	if(CC_NORMAL != ret)
 	{
-		FwUpdate->stage_mask = POWER_CHIP_SECTION_USER;
-		FwUpdate->progress = 0;
-		FwUpdate->status = POWER_FW_UPDATE_STATUS_IDLE;
-		ret = PDK_Irps5401Update(FwUpdate);
-		sleep(2);
-		if(0 != ret)
+		pthread_mutex_unlock(&PowerChipSchedMutex);
+		//请求被拒绝时同样归还镜像缓存
+		for(i = 0; i < job_count && i < POWER_CHIP_COUNT_MAX; i++)
 		{
-			TWARN("Power chip %d firmware update user section fail.\n", Devinst);
-			PDK_ExitPowerChipUpdateModeFail(FwUpdate, p_fw, ret);
-			return ret;
+			if(jobs[i].buf && jobs[i].release)
+				jobs[i].release(jobs[i].buf, jobs[i].ctx);
 		}
+		return ret;
 	}
-	TINFO("%s %s %d Dev [%d] exit update.. \n", __FILE__, __FUNCTION__, __LINE__, Devinst);	
-	TINFO("%s %s %d Dev [%d] enter verify.. \n", __FILE__, __FUNCTION__, __LINE__, Devinst);	
-	PDK_Irps5401Verify(FwUpdate);
-	if(FwUpdate->status == POWER_FW_UPDATE_STATUS_SUCCESS)
+
+	memset(&power_chip_sched, 0, sizeof(power_chip_sched));
+	power_chip_sched.is_running = 1;
+	power_chip_sched.job_count = job_count;
+	for(i = 0; i < job_count; i++)
 	{
-		PDK_PostRedisMsgSetFwRev(ENTITY_POWER_CHIP, Devinst, 0);
+		power_chip_sched.job[i].req = jobs[i];
+		power_chip_sched.job[i].state = POWER_CHIP_SCHED_JOB_WAIT;
+		bus[i] = PDK_PowerChipBusGet(jobs[i].Devinst);
+		for(j = 0; j < i && bus[j] != bus[i]; j++);
+		if(j == i)
+			power_chip_sched.bus_count++;
 	}
-	sleep(2);
-	TINFO("%s %s %d Dev [%d] exit verify.. \n", __FILE__, __FUNCTION__, __LINE__, Devinst);	
-	FwUpdate->progress = 0;
-	FwUpdate->status = POWER_FW_UPDATE_STATUS_IDLE;
-	FwUpdate->stage = POWER_FW_UPDATE_STAGE_IDLE;
-	PDK_ExitPowerChipUpdateMode(FwUpdate, p_fw, 0);
-	return 0;
-}
+	pthread_mutex_unlock(&PowerChipSchedMutex);
 
+	for(i = 0; i < job_count; i++)
+	{
+		ret = PDK_PowerChipBusJobEnqueue(&power_chip_sched.job[i].req, &power_chip_sched.job[i]);
+		if(CC_NORMAL != ret)
+			PDK_PowerChipSchedJobSet(&power_chip_sched.job[i], POWER_CHIP_SCHED_JOB_FAIL, ret);
+	}
 
-void *PDK_PowerChipFwUpdateTask(void *pArg)
+	ret = CC_NORMAL;
+	pthread_mutex_lock(&PowerChipSchedMutex);
+	while(power_chip_sched.success_count + power_chip_sched.fail_count < job_count)
+		pthread_cond_wait(&PowerChipSchedCond, &PowerChipSchedMutex);
+	for(i = 0; i < job_count; i++)
+	{
+		if(CC_NORMAL == ret && POWER_CHIP_SCHED_JOB_SUCCESS != power_chip_sched.job[i].state)
+			ret = power_chip_sched.job[i].error_code;
+	}
+	power_chip_sched.is_running = 0;
+	pthread_mutex_unlock(&PowerChipSchedMutex);
+	TAUDIT(LOG_INFO, "Power chip scheduled update finished, %d success, %d fail", power_chip_sched.success_count, power_chip_sched.fail_count);
+	return ret;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipSchedUpdateTask
+ * Description  : thread of updating several power chips
+ * Params       : pArg:power_chip_sched_req_t, e.g. power_chip_sched_req
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+void *PDK_PowerChipSchedUpdateTask(void *pArg)
 {
-    power_chip_req_t *pFwUpdate = (power_chip_req_t *)pArg;
-	char cmd[64] = {0};
+	power_chip_sched_req_t *pReq = (power_chip_sched_req_t *)pArg;
 
     prctl(PR_SET_NAME, __FUNCTION__, 0, 0, 0);
     pthread_detach(pthread_self());
 
-	if(NULL == pFwUpdate)return 0;
+	if(NULL == pReq)return 0;
 
-	if(access(POWER_CHIP_FILE, F_OK))
+	PDK_PowerChipSchedUpdate(pReq->job, pReq->job_count);
+	return 0;
+}
+
+/*****************************************************************************
+ * Function     : PDK_PowerChipSchedStatusGet
+ * Description  : get state of every job and the whole progress of the scheduled update
+ * Params       : sched:output
+ * Return       : 0: Success, -1: Failed
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipSchedStatusGet(power_chip_sched_t *sched)
+{
+	INT32U i, progress = 0;
+
+	if(NULL == sched)
+		return -1;
+
+	pthread_mutex_lock(&PowerChipSchedMutex);
+	memcpy(sched, &power_chip_sched, sizeof(power_chip_sched_t));
+	for(i = 0; i < sched->job_count; i++)
 	{
-		TAUDIT(LOG_WARNING,"Power chip firmware file %s does not exist.\n", POWER_CHIP_FILE);
-		TWARN("Power chip firmware file %s does not exist.\n", POWER_CHIP_FILE);
-		return 0;
+		progress += PDK_PowerChipSchedJobProgress(&power_chip_sched.job[i]);
 	}
+	pthread_mutex_unlock(&PowerChipSchedMutex);
+	sched->progress = sched->job_count ? progress / sched->job_count : 0;
+	return 0;
+}
 
-	memset(cmd, 0, sizeof(cmd));
-	snprintf(cmd, sizeof(cmd), "cp %s %s", POWER_CHIP_FILE, POWER_CHIP_USED_FILE);
-	safe_system(cmd);
+/*****************************************************************************
+ * Function     : PDK_PowerChipBundleUpdate
+ * Description  : update every power chip which has an image in the uploaded file, e.g. a multi-image
+ *                container of the board. the file is verified once, then one job for each matching
+ *                chip is scheduled by PDK_PowerChipSchedUpdate, the jobs reuse the verified result
+ * Params       : mask:sections to be updated
+ * Return       : IPMI Completion Code, see PDK_PowerChipSchedUpdate
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+int PDK_PowerChipBundleUpdate(INT32U mask)
+{
+	power_chip_buf_req_t jobs[POWER_CHIP_COUNT_MAX];
+	power_chip_staged_img_t staged;
+	power_chip_img_key_t key;
+	struct stat fs;
+	INT8U chip_count = sizeof(board_power_chip_info) / sizeof(board_power_chip_info_t);
+	INT8U i, job_count = 0;
+	int LockRet = -1;
+	bool verified = false;
+
+	if(0 != stat(POWER_CHIP_FILE, &fs))
+		return CC_FILE_NOT_EXIST;
+	PDK_PowerChipImgKeyGet(&fs, &key);
+
+	//预校验结果对应当前文件时直接使用，否则（监视线程还未校验完，或者签名校验失败、公钥可能在之后才安装）在本线程中校验一次
+	OS_THREAD_MUTEX_ACQUIRE_LOCK(&PowerChipStagedImgMutex, LockRet);
+	if (LockRet == -1)
+		return CC_UNSPECIFIED_ERR;
+	verified = PDK_PowerChipImgKeyEqual(&key, &power_chip_staged_img_key)
+		&& (POWER_FW_STAGED_IMG_VALID == power_chip_staged_img.state
+			|| (POWER_FW_STAGED_IMG_INVALID == power_chip_staged_img.state && CC_ERR_HASH_SIGNED_VERIFY != power_chip_staged_img.verdict));
+	OS_THREAD_MUTEX_RELEASE(&PowerChipStagedImgMutex);
+	if(!verified)
+		PDK_PowerChipStagedImgVerify();
+
+	if(0 != PDK_PowerChipStagedImgGet(&staged))
+		return CC_UNSPECIFIED_ERR;
+	if(POWER_FW_STAGED_IMG_NONE == staged.state)
+		return CC_FILE_NOT_EXIST;
+	if(POWER_FW_STAGED_IMG_VERIFYING == staged.state)
+		return CC_NODE_BUSY;
+	if(POWER_FW_STAGED_IMG_INVALID == staged.state)
+	{
+		TAUDIT(LOG_WARNING, "Power chip bundle update is rejected, firmware file is invalid, error code 0x%x", staged.verdict);
+		return staged.verdict;
+	}
 
-    sleep(1);
-    TAUDIT(LOG_INFO, "Power chip %d firmware Firmware Update, update mask 0x%x", pFwUpdate->Devinst, pFwUpdate->mask);
- 	PDK_PowerChipUpdate(pFwUpdate->Devinst, pFwUpdate->mask);
-    return 0;
+	memset(jobs, 0, sizeof(jobs));
+	for(i = 0; i < chip_count && i < POWER_CHIP_COUNT_MAX; i++)
+	{
+		if(!(staged.chip_mask & (1 << i)))
+			continue;
+		//buf为NULL，各任务使用上传的文件，校验结果从缓存中获取，不再重复校验签名
+		jobs[job_count].Devinst = i;
+		jobs[job_count].mask = mask;
+		job_count++;
+	}
+	if(0 == job_count)
+		return CC_FILE_MISMATCH;
+
+	TAUDIT(LOG_INFO, "Power chip bundle update, submodel %s, %d chips are scheduled", staged.SubModel, job_count);
+	return PDK_PowerChipSchedUpdate(jobs, job_count);
 }
 
+/*****************************************************************************
+ * Function     : PDK_PowerChipBundleUpdateTask
+ * Description  : thread of updating every power chip in the uploaded file
+ * Params       : pArg:power_chip_req_t, e.g. power_chip_bundle_req, Devinst is not used
+ * Return       : 
+ * Author       : TeaFeng
+ * Date         : 2026/10/19
+*****************************************************************************/
+void *PDK_PowerChipBundleUpdateTask(void *pArg)
+{
+	power_chip_req_t *pReq = (power_chip_req_t *)pArg;
+
+    prctl(PR_SET_NAME, __FUNCTION__, 0, 0, 0);
+    pthread_detach(pthread_self());
+
+	if(NULL == pReq)return 0;
 
+	PDK_PowerChipBundleUpdate(pReq->mask);
+	return 0;
+}
@@ -6,6 +6,9 @@
 
 #define POWER_CHIP_COUNT_MAX			4
 #define POWER_CHIP_FW_VER_LEN			16
+#define POWER_CHIP_SECTION_MAX			32				//单个芯片otp section page信息的最大数量
+#define POWER_CHIP_SUBMODEL_LEN			16
+#define POWER_CHIP_BASE_DIGEST_SIZE		32				//差分镜像基线摘要（SHA256）的长度
 typedef enum{
 	POWER_CHIP_SECTION_CONF = 0x01 << 0,
 	POWER_CHIP_SECTION_TRIM = 0x01 << 1,
@@ -18,6 +21,20 @@ typedef struct
 	INT8U Devinst;
 	INT32U mask;
 }power_chip_req_t;
+
+//镜像缓存的释放函数，升级流程不再使用镜像缓存时调用且只调用一次
+typedef void (*power_chip_img_release_t)(INT8U *buf, void *ctx);
+
+//使用内存中的镜像升级的请求，镜像缓存的所有权随请求一起交给升级流程
+typedef struct
+{
+	INT8U	Devinst;
+	INT32U	mask;
+	INT8U	*buf;						//镜像起始地址（包含镜像头）
+	INT32U	len;						//镜像大小
+	power_chip_img_release_t release;	//镜像缓存的释放函数，可以为NULL
+	void	*ctx;						//传给release的参数
+}power_chip_buf_req_t;
 typedef enum
 {
     POWER_FW_UPDATE_STATUS_IDLE,
@@ -25,6 +42,7 @@ typedef enum
     POWER_FW_UPDATE_STATUS_VERIFY,
     POWER_FW_UPDATE_STATUS_SUCCESS,
     POWER_FW_UPDATE_STATUS_FAIL,
+    POWER_FW_UPDATE_STATUS_CANCEL,		//升级被PDK_PowerChipUpdateCancel取消
 } power_fw_update_status;
 
 typedef enum
@@ -34,6 +52,97 @@ typedef enum
    	POWER_FW_UPDATE_STAGE_USER,
 }power_fw_update_stage;
 
+//升级状态的一致快照，由PDK_PowerChipUpdateStateGet获取，各成员同时有效
+typedef struct
+{
+	power_fw_update_status status;		//升级状态
+	power_fw_update_stage stage;		//当前升级的section
+	INT8U	progress;					//升级进度
+	INT8U	error_code;					//升级时的错误状态
+	INT8U	is_under_update;			//当前是否处于升级状态
+	INT8U	image_verified_state;		//镜像签名校验状态
+	INT8U	FwRev;						//正在升级的固件版本
+	INT32U	stage_mask;					//当前升级的分区
+}power_chip_update_state_t;
+
+//芯片版本信息的缓存，由PDK_PowerChipInventoryGet获取，不访问I2C总线
+typedef struct
+{
+	INT8U	valid;						//1：至少从芯片读取成功过一次
+	INT8U	dirty;						//1：读取后芯片被写过（如正在升级），各成员为写入前的值
+	INT8U	FwRev;						//IRPS5401_VERSION_REG
+	INT8U	silicon_version;			//IRPS5401_SILICON_VERSION_REG
+	INT8U	conf_write_left;			//conf section剩余可写次数
+	INT8U	user_write_left;			//user section剩余可写次数
+}power_chip_inventory_t;
+
+#define POWER_CHIP_LOCK_HIST_COUNT		7				//时间直方图的区间数：<100us、<1ms、<10ms、<100ms、<1s、<10s、>=10s
+#define POWER_CHIP_LOCK_HOLDER_LEN		16
+
+//芯片所在I2C总线锁的统计，由PDK_PowerChipBusStatGet获取，时间单位微秒
+typedef struct
+{
+	INT32U	lock_count;					//获取锁成功的次数
+	INT32U	try_fail_count;				//非阻塞获取因锁被占用而失败的次数（调用者得到CC_NODE_BUSY）
+	INT32U	timeout_count;				//限时获取超时的次数
+	INT32U	long_wait_count;			//阻塞获取等待超过POWER_CHIP_BUS_LOCK_WARN_TIME的次数
+	INT64U	wait_total_us;
+	INT32U	wait_max_us;
+	INT64U	hold_total_us;
+	INT32U	hold_max_us;
+	INT32U	wait_hist[POWER_CHIP_LOCK_HIST_COUNT];		//成功获取锁的等待时间分布
+	INT32U	hold_hist[POWER_CHIP_LOCK_HIST_COUNT];		//释放锁时的占用时间分布
+	INT32U	holder_tid;					//当前持有锁的线程号，0表示未被持有
+	char	holder[POWER_CHIP_LOCK_HOLDER_LEN];		//当前持有锁的线程名
+	INT32U	held_us;					//当前持有者已经占用的时间
+}power_chip_bus_stat_t;
+
+//升级事件，订阅时按位组合
+typedef enum
+{
+	POWER_CHIP_EVENT_STAGE		= 0x01 << 0,	//升级状态或升级的分区变化
+	POWER_CHIP_EVENT_PROGRESS	= 0x01 << 1,	//进度变化，有限频
+	POWER_CHIP_EVENT_DONE		= 0x01 << 2,	//退出升级模式，升级结束
+	POWER_CHIP_EVENT_ALL		= 0x07,
+}power_chip_event;
+
+//升级流程的阶段，PDK_PowerChipPhaseHookSet设置的函数按阶段统计时间和总线访问
+typedef enum
+{
+	POWER_CHIP_PHASE_PREFLIGHT,			//检查芯片版本和剩余可编程次数（之前的镜像读取和校验由调用者计入）
+	POWER_CHIP_PHASE_CONF_WRITE,		//准备并逐页写入conf分区
+	POWER_CHIP_PHASE_USER_WRITE,		//准备并逐页写入user分区
+	POWER_CHIP_PHASE_COMMIT,			//发送NVM编程命令，等待并检查编程结果
+	POWER_CHIP_PHASE_VERIFY_PREPARE,	//重新加载user分区，检查CRC
+	POWER_CHIP_PHASE_VERIFY_READ,		//逐页读取寄存器
+	POWER_CHIP_PHASE_VERIFY_COMPARE,	//读回的寄存器与镜像比较
+	POWER_CHIP_PHASE_FINISH,			//退出升级模式，重新读取芯片信息
+	POWER_CHIP_PHASE_DONE,				//升级结束
+}power_chip_phase;
+
+//升级状态机每一步之前、以及结束时在执行升级的线程中调用，不能阻塞。
+//wait_us为上一步要求、在phase的这一步之前完成的等待（如编程OTP、等待芯片稳定），属于phase
+typedef void (*power_chip_phase_hook_t)(INT8U Devinst, power_chip_phase phase, INT32U wait_us);
+
+typedef enum
+{
+	POWER_FW_STAGED_IMG_NONE,		//没有上传镜像
+	POWER_FW_STAGED_IMG_VERIFYING,	//镜像上传完成，正在校验
+	POWER_FW_STAGED_IMG_VALID,		//镜像校验通过，可以用于升级
+	POWER_FW_STAGED_IMG_INVALID,	//镜像校验失败，升级请求会被直接拒绝
+}power_fw_staged_img_state;
+
+//上传到POWER_CHIP_FILE的镜像的预校验结果
+typedef struct
+{
+	power_fw_staged_img_state state;
+	INT8U	verdict;							//镜像校验结果，IPMI Completion Code
+	INT8U	chip_inst;							//镜像对应的power chip编号，多镜像容器为第一个匹配的镜像
+	INT32U	chip_mask;							//镜像中有对应数据的power chip，bit i对应编号i
+	INT8U	FwRev;								//镜像的固件版本
+	INT8U	SubModel[POWER_CHIP_SUBMODEL_LEN];	//镜像头中的SubModel
+}power_chip_staged_img_t;
+
 typedef struct power_chip_info{
 	char *i2c_dev;
 	INT8U slave_addr;
@@ -44,18 +153,35 @@ typedef struct power_chip_info{
 }power_chip_info_t;
 
 
+//镜像中每个section的数据位置，与section_info中的条目一一对应
+typedef struct
+{
+	INT32U	start;					//section的第一条记录在镜像中的序号
+	INT32U	end;					//section结束记录的下一条记录序号
+	INT32U	count;					//[start, end)中位于section地址范围内的寄存器数量
+}power_chip_sec_index_t;
+
 typedef struct
 {
     INT8U	chip_inst;				//power chip编号
     INT8U conf_wirte_left;			//conf分区剩余可编程次数
 	INT8U user_wirte_left;			//user分区剩余可编程次数
 	INT8U *image_buf;				//固件地址
+	INT8U *image_base;				//镜像缓存的起始地址（包含镜像头）
+	power_chip_img_release_t image_release;	//镜像缓存的释放函数
+	void *image_release_ctx;		//传给image_release的参数
     uint32 imgSize;					//固件大小
     INT8U FwRev;					//固件版本
+	INT8U img_type;					//镜像类型，差分镜像只写入有改动的寄存器
+	INT8U BaseFwRev;				//差分镜像要求芯片当前的固件版本
+	INT8U BaseDigest[POWER_CHIP_BASE_DIGEST_SIZE];	//差分镜像改动的section中基线寄存器值与掩码的SHA256
+	INT8U *BaseMask;				//差分镜像的基线掩码，位于镜像中寄存器记录之后，imgSize不包括它
 	void *section_info;				//每种电源芯片内部需要升级的otp section page的信息，如irps5401_sec
 	INT32U section_count;			//section的数量
+	power_chip_sec_index_t sec_index[POWER_CHIP_SECTION_MAX];	//镜像中各section数据的位置索引
 	uint32 stage_mask;				//升级掩码，确定需要升级的section
 	INT8U image_verified_state;		//镜像签名校验状态
+	INT8U reg_section_disable;		//未启用的switcher寄存器区，校验时跳过，以寄存器区编号为位号
 	INT8U is_under_update;			//当前是否处于升级状态
 	INT8U progress;					//升级进度
 	INT8U	error_code;				//升级时的错误状态
@@ -66,12 +192,76 @@ typedef struct
 
 
 
+typedef enum{
+	POWER_CHIP_SCHED_JOB_WAIT,			//等待所在总线空闲
+	POWER_CHIP_SCHED_JOB_RUN,			//正在升级
+	POWER_CHIP_SCHED_JOB_SUCCESS,
+	POWER_CHIP_SCHED_JOB_FAIL,
+}power_chip_sched_job_state;
+
+//调度器中的一个升级任务，req.buf为NULL时使用上传到/var下的镜像文件
+typedef struct
+{
+	power_chip_buf_req_t req;
+	power_chip_sched_job_state state;
+	INT8U	error_code;
+}power_chip_sched_job_t;
+
+//多芯片升级请求，不同总线上的芯片同时升级，同一总线上的芯片依次升级
+typedef struct
+{
+	INT8U	job_count;
+	power_chip_buf_req_t job[POWER_CHIP_COUNT_MAX];
+}power_chip_sched_req_t;
+
+//多芯片升级的整体状态
+typedef struct
+{
+	INT8U	is_running;					//当前是否有多芯片升级在进行
+	INT8U	job_count;
+	INT8U	success_count;
+	INT8U	fail_count;
+	INT8U	bus_count;					//同时升级的总线数量
+	INT8U	progress;					//所有任务的整体进度
+	power_chip_sched_job_t job[POWER_CHIP_COUNT_MAX];
+}power_chip_sched_t;
+
 extern power_chip_req_t power_chip_req[POWER_CHIP_COUNT_MAX];
-extern pthread_t PowerChipFwUpdateThreadID[POWER_CHIP_COUNT_MAX];
+extern power_chip_sched_req_t power_chip_sched_req;
+extern power_chip_req_t power_chip_bundle_req;
+extern power_chip_buf_req_t power_chip_buf_req[POWER_CHIP_COUNT_MAX];
+extern pthread_t PowerChipFwUpdateThreadID[POWER_CHIP_COUNT_MAX];		//已废弃，不再设置，见PDKPowerChip.c
 extern power_chip_update_t power_chip_update[POWER_CHIP_COUNT_MAX] ;
 extern void *PDK_PowerChipFwUpdateTask(void *pArg);
+extern void *PDK_PowerChipFwUpdateBufTask(void *pArg);
+extern int PDK_PowerChipUpdate(INT8U Devinst, INT32U mask);
+extern int PDK_PowerChipUpdateFromBuf(INT8U Devinst, INT32U mask, INT8U *buf, INT32U len, power_chip_img_release_t release, void *ctx);
 extern int PDK_PowerChipFWVersionGet(INT8U Devinst, INT8U *FwRevStr, INT16U *ResLen, int BMCInst);
 extern int PDK_PowerChipFWVersionGetWithoutLock(INT8U Devinst, INT8U *FwRevStr, INT16U *ResLen, int BMCInst);
+extern void PDK_PowerChipImgCacheFlush(void);
+extern int PDK_PowerChipInit(void);
+extern int PDK_PowerChipMuxLock(INT8U Devinst, int Lock);
+extern int PDK_PowerChipMuxBlockLock(INT8U Devinst, int Lock);
+extern int PDK_PowerChipMuxTimedLock(INT8U Devinst, INT32U timeout_ms);
+extern int PDK_PowerChipBusStatGet(INT8U Devinst, power_chip_bus_stat_t *stat);
+extern int PDK_PowerChipBusStatClear(INT8U Devinst);
+extern int PDK_PowerChipStagedImgGet(power_chip_staged_img_t *staged);
+extern int PDK_PowerChipUpdateStateGet(INT8U Devinst, power_chip_update_state_t *state);
+extern int PDK_PowerChipInventoryGet(INT8U Devinst, power_chip_inventory_t *inv);
+extern int PDK_PowerChipEventSubscribe(INT32U event_mask);
+extern int PDK_PowerChipEventUnsubscribe(int efd);
+extern int PDK_PowerChipEventGet(int efd, INT32U *events, INT8U *Devinst_mask);
+extern int PDK_PowerChipEventWait(INT32U *seq, int timeout_ms);
+extern int PDK_PowerChipFwUpdateEnqueue(INT8U Devinst, INT32U mask);
+extern int PDK_PowerChipFwUpdateBufEnqueue(power_chip_buf_req_t *req);
+extern int PDK_PowerChipUpdateCancel(INT8U Devinst);
+extern void PDK_PowerChipBusHoldMaxSet(INT32U hold_us);
+extern void PDK_PowerChipPhaseHookSet(power_chip_phase_hook_t hook);
+extern int PDK_PowerChipSchedUpdate(power_chip_buf_req_t *jobs, INT8U job_count);
+extern void *PDK_PowerChipSchedUpdateTask(void *pArg);
+extern int PDK_PowerChipSchedStatusGet(power_chip_sched_t *sched);
+extern int PDK_PowerChipBundleUpdate(INT32U mask);
+extern void *PDK_PowerChipBundleUpdateTask(void *pArg);
 #endif  /* __PDK_POWER_CHIP_H__*/
 
 
@@ -0,0 +1,20 @@
+/*
+ * AMI Debug.h的替代，打印到标准错误，host_log_level控制打印的级别。
+ */
+#ifndef __DEBUG_H__
+#define __DEBUG_H__
+#include <stdio.h>
+#include <syslog.h>
+
+#define HOST_LOG_NONE		0
+#define HOST_LOG_WARN		1
+#define HOST_LOG_INFO		2
+
+extern int host_log_level;			//默认HOST_LOG_WARN
+
+#define TCRIT(...)			do{ if(host_log_level >= HOST_LOG_WARN) fprintf(stderr, __VA_ARGS__); }while(0)
+#define TWARN(...)			do{ if(host_log_level >= HOST_LOG_WARN) fprintf(stderr, __VA_ARGS__); }while(0)
+#define TINFO(...)			do{ if(host_log_level >= HOST_LOG_INFO) fprintf(stderr, __VA_ARGS__); }while(0)
+#define TAUDIT(l, ...)		do{ if(host_log_level >= HOST_LOG_INFO) fprintf(stderr, __VA_ARGS__); }while(0)
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * AMI IPMIDefs.h的替代，只包含PDKPowerChip.c使用的completion code。
+ * 标准IPMI的取值与规范一致，OEM的取值只用于host编译，与BMC上的定义无关。
+ */
+#ifndef __IPMIDEFS_H__
+#define __IPMIDEFS_H__
+
+#define CC_NORMAL						0x00
+#define CC_NODE_BUSY					0xC0
+#define CC_PARAM_OUT_OF_RANGE			0xC9
+#define CC_UNSPECIFIED_ERR				0xFF
+
+#define CC_NO_MEM						0x80
+#define CC_FILE_NOT_EXIST				0x81
+#define CC_ERR_FILE_READ				0x82
+#define CC_FILE_SIZE_INVALID			0x83
+#define CC_ERR_FW_IMG_HDR_CRC			0x84
+#define CC_ERR_FW_IMG_SIGNATURE			0x85
+#define CC_ERR_FW_IMG_MODEL				0x86
+#define CC_FILE_CHKSUM_EER				0x87
+#define CC_ERR_HASH_SIGNED_VERIFY		0x88
+#define CC_BUS_ERR						0x89
+#define CC_DEV_IN_FIRMWARE_PROTECT_MODE	0x8A
+#define CC_ERR_EXIT_FW_UPDATE			0x8B
+#define CC_ERR_FLASH_VERIFY				0x8C
+#define CC_ERR_SETUP_FW_UPDATE			0x8D
+#define CC_FILE_MISMATCH				0x8E
+#define CC_ERR_FLASH_WRITE				0x8F
+#define CC_ERR_FW_UPDATE				0x90
+#define CC_ERR_EXECUTING				0x91
+#define CC_FWUPDATE_NOT_SUPPORTED		0x92
+#define CC_ERR_FW_UPDATE_CAPABILITY		0x93
+
+#endif
@@ -0,0 +1,6 @@
+/*
+ * AMI IPMI_OEMCmds.h的替代，PDKPowerChip.c不使用其中的内容。
+ */
+#ifndef __IPMI_OEMCMDS_H__
+#define __IPMI_OEMCMDS_H__
+#endif
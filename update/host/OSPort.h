@@ -0,0 +1,13 @@
+/*
+ * AMI OSPort.h的替代，只包含PDKPowerChip.c使用的线程锁宏。
+ */
+#ifndef __OSPORT_H__
+#define __OSPORT_H__
+#include <pthread.h>
+
+#define OS_THREAD_MUTEX_DEFINE(m)				pthread_mutex_t m = PTHREAD_MUTEX_INITIALIZER
+#define OS_THREAD_MUTEX_ACQUIRE_LOCK(m, r)		do{ r = pthread_mutex_lock(m) ? -1 : 0; }while(0)
+#define OS_THREAD_MUTEX_ACQUIRE_TRY(m, r)		do{ r = pthread_mutex_trylock(m) ? -1 : 0; }while(0)
+#define OS_THREAD_MUTEX_RELEASE(m)				pthread_mutex_unlock(m)
+
+#endif
@@ -0,0 +1,16 @@
+/*
+ * AMI PDKPlatform.h的替代，host上的实现在host_platform.c中。
+ */
+#ifndef __PDKPLATFORM_H__
+#define __PDKPLATFORM_H__
+#include "Types.h"
+
+#define ENTITY_POWER_CHIP		0x20
+
+extern int PDK_FileRead(char *file, INT32U offset, INT32U size, INT8U *buf);
+extern int PDK_PostRedisMsgSetFwRev(int entity, int inst, int bmcinst);
+//用公钥文件校验RSA SHA256签名，成功返回0
+extern int FwImageDigestSignVerify(char *pubkey, INT8U *data, INT32U size, INT8U *sig);
+extern int safe_system(char *cmd);
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * AMI Types.h的替代，只用于在host上编译PDKPowerChip.c（见README），BMC编译时使用AMI自己的头文件。
+ */
+#ifndef __TYPES_H__
+#define __TYPES_H__
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+typedef uint8_t		INT8U;
+typedef int8_t		INT8S;
+typedef uint16_t	INT16U;
+typedef int16_t		INT16S;
+typedef uint32_t	INT32U;
+typedef int32_t		INT32S;
+typedef uint64_t	INT64U;
+typedef uint16_t	uint16;
+typedef uint32_t	uint32;
+
+#define PACKED __attribute__ ((packed))
+
+#endif
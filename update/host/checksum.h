@@ -0,0 +1,10 @@
+/*
+ * AMI checksum.h的替代，CalculateCRC32与txt2bin中的相同（CRC-32，多项式0xEDB88320）。
+ */
+#ifndef __CHECKSUM_H__
+#define __CHECKSUM_H__
+#include "Types.h"
+
+extern INT32U CalculateCRC32(unsigned char *Buffer, INT32U Size);
+
+#endif
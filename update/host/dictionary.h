@@ -0,0 +1,6 @@
+/*
+ * AMI dictionary.h的替代，PDKPowerChip.c不使用其中的内容。
+ */
+#ifndef __DICTIONARY_H__
+#define __DICTIONARY_H__
+#endif
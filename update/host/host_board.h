@@ -0,0 +1,9 @@
+/*
+ * host编译使用的单板芯片列表（-DPOWER_CHIP_BOARD_FILE=\"host_board.h\"），被包含在PDKPowerChip.c的board_power_chip_info[]中：
+ * 两个芯片在同一条总线上，另外两个各在一条总线上，可以同时测试同总线依次升级和不同总线同时升级。
+ * 芯片由irps5401_model在第一次被访问时创建。
+ */
+	BOARD_IRPS5401(0, "IRPS5401_U1", "/dev/i2c4", 0x14),
+	BOARD_IRPS5401(1, "IRPS5401_U2", "/dev/i2c4", 0x16),
+	BOARD_IRPS5401(2, "IRPS5401_U3", "/dev/i2c5", 0x14),
+	BOARD_IRPS5401(3, "IRPS5401_U4", "/dev/i2c6", 0x14),
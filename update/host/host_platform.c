@@ -0,0 +1,110 @@
+/*
+ * host编译时AMI库函数的实现：I2C访问irps5401_model中的芯片模型，其余函数使用标准库和OpenSSL。
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include "Types.h"
+#include "Debug.h"
+#include "libi2c.h"
+#include "checksum.h"
+#include "PDKPlatform.h"
+#include "irps5401_model.h"
+
+int host_log_level = HOST_LOG_WARN;
+
+static INT32U crc32_table[256];
+static pthread_once_t crc32_once = PTHREAD_ONCE_INIT;
+
+ssize_t i2c_master_write(char *i2c_dev, INT8U slave, INT8U *data, size_t size)
+{
+	return irps5401_model_write(i2c_dev, slave, data, size);
+}
+
+int i2c_writeread(char *i2c_dev, INT8U slave, INT8U *wdata, INT8U *rdata, size_t wsize, size_t rsize)
+{
+	return irps5401_model_writeread(i2c_dev, slave, wdata, rdata, wsize, rsize);
+}
+
+static void crc32_table_init(void)
+{
+	INT32U i, j, crc;
+
+	for(i = 0; i < 256; i++)
+	{
+		crc = i;
+		for(j = 0; j < 8; j++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+		crc32_table[i] = crc;
+	}
+}
+
+INT32U CalculateCRC32(unsigned char *Buffer, INT32U Size)
+{
+	INT32U crc = 0xFFFFFFFF;
+	INT32U i;
+
+	pthread_once(&crc32_once, crc32_table_init);
+	for(i = 0; i < Size; i++)
+		crc = crc32_table[(crc ^ Buffer[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+//与BMC相同：对data做SHA256后用RSA公钥校验sig，sig长度为公钥长度
+int FwImageDigestSignVerify(char *pubkey, INT8U *data, INT32U size, INT8U *sig)
+{
+	EVP_PKEY *key = NULL;
+	EVP_MD_CTX *ctx = NULL;
+	FILE *fp;
+	int ret = -1;
+
+	fp = fopen(pubkey, "r");
+	if(NULL == fp)
+	{
+		TWARN("Open public key %s fail.\n", pubkey);
+		return -1;
+	}
+	key = PEM_read_PUBKEY(fp, NULL, NULL, NULL);
+	fclose(fp);
+	if(NULL == key)
+	{
+		TWARN("Read public key %s fail.\n", pubkey);
+		return -1;
+	}
+	ctx = EVP_MD_CTX_new();
+	if(NULL != ctx && 1 == EVP_DigestVerifyInit(ctx, NULL, EVP_sha256(), NULL, key)
+		&& 1 == EVP_DigestVerify(ctx, sig, EVP_PKEY_get_size(key), data, size))
+		ret = 0;
+	EVP_MD_CTX_free(ctx);
+	EVP_PKEY_free(key);
+	return ret;
+}
+
+int PDK_FileRead(char *file, INT32U offset, INT32U size, INT8U *buf)
+{
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(file, "rb");
+	if(NULL == fp)
+		return -1;
+	if(0 != fseek(fp, offset, SEEK_SET) || 1 != fread(buf, size, 1, fp))
+		ret = -1;
+	fclose(fp);
+	return ret;
+}
+
+//host上没有redis，版本变化只打印
+int PDK_PostRedisMsgSetFwRev(int entity, int inst, int bmcinst)
+{
+	TINFO("Firmware revision of entity 0x%x instance %d changed.\n", entity, inst);
+	(void)bmcinst;
+	return 0;
+}
+
+int safe_system(char *cmd)
+{
+	return system(cmd);
+}
@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "irps5401_model.h"
+
+//寄存器地址与PDKPowerChip.c中的IRPS5401_*_REG一致，高字节为page
+#define MODEL_PAGE_REG					0xFF
+#define MODEL_PAGE_MAX					0x17
+#define MODEL_PAGE_SIZE					256
+#define MODEL_VERSION_REG				0x002A
+#define MODEL_NVRAM_IMAGE_REG			0x0052
+#define MODEL_CONF_LEFT_REG				0x0056
+#define MODEL_USER_LEFT_REG0			0x0058
+#define MODEL_USER_LEFT_REG1			0x005A
+#define MODEL_PASSWD_REG				0x006C
+#define MODEL_NVM_CMD_REG				0x0088
+#define MODEL_NVM_CMD_REG_H				0x0089
+#define MODEL_TRIM_TRY_PWD_REG0			0x008A
+#define MODEL_TRIM_TRY_PWD_REG1			0x008B
+#define MODEL_SILICON_VERSION_REG		0x00FD
+
+#define MODEL_NVM_PROGRAM_CONF			0x12			//把寄存器编程到conf image，高字节为image编号
+#define MODEL_NVM_RELOAD_USER			0x41			//从user image重新加载寄存器
+#define MODEL_NVM_PROGRAM_USER			0x42			//把寄存器编程到user image
+#define MODEL_NVM_DONE					0x80			//NVM_CMD高字节bit7：命令执行完成
+#define MODEL_NVM_IMAGE_MASK			0x1F
+#define MODEL_NVRAM_CRC_ERR				0x40			//NVRAM_IMAGE bit6：user image有CRC错误
+#define MODEL_PASSWD_OK					0x02			//PASSWD bit1：已经解锁，可以编程OTP
+#define MODEL_PASSWD0					0x5A
+#define MODEL_PASSWD1					0xA5
+
+#define MODEL_SEC_CONF					1
+#define MODEL_SEC_USER					2
+
+//与PDKPowerChip.c中irps5401_sec一致，决定编程和重新加载时哪些寄存器属于conf/user分区
+static const struct
+{
+	INT8U section;
+	INT16U start;
+	INT16U end;
+}model_sec[] = {
+	{MODEL_SEC_CONF, 0x0000, 0x0001},
+	{MODEL_SEC_USER, 0x0020, 0x003B}, {MODEL_SEC_USER, 0x0420, 0x042B}, {MODEL_SEC_USER, 0x0600, 0x06FF},
+	{MODEL_SEC_USER, 0x0700, 0x07FF}, {MODEL_SEC_USER, 0x0820, 0x082B}, {MODEL_SEC_USER, 0x0A00, 0x0AFF},
+	{MODEL_SEC_USER, 0x0B00, 0x0BFF}, {MODEL_SEC_USER, 0x0C20, 0x0C2B}, {MODEL_SEC_USER, 0x0E00, 0x0EFF},
+	{MODEL_SEC_USER, 0x0F00, 0x0FFF}, {MODEL_SEC_USER, 0x1020, 0x102B}, {MODEL_SEC_USER, 0x1200, 0x12FF},
+	{MODEL_SEC_USER, 0x1300, 0x13FF}, {MODEL_SEC_USER, 0x1420, 0x1421}, {MODEL_SEC_USER, 0x1600, 0x16FF},
+	{MODEL_SEC_USER, 0x1700, 0x17FF},
+};
+
+typedef struct
+{
+	char	i2c_dev[32];
+	INT8U	slave;
+	pthread_mutex_t mutex;
+	irps5401_model_cfg_t cfg;
+	INT8U	page;
+	INT8U	reg[IRPS5401_MODEL_REG_COUNT];
+	INT8U	conf_otp[IRPS5401_MODEL_CONF_MAX][IRPS5401_MODEL_REG_COUNT];
+	INT8U	user_otp[IRPS5401_MODEL_USER_MAX][IRPS5401_MODEL_REG_COUNT];
+	INT8U	conf_used;
+	INT8U	user_used;
+	INT64U	nvm_done_us;				//NVM命令完成的时间
+	irps5401_model_stat_t stat;
+}irps5401_model_t;
+
+static irps5401_model_t *models[IRPS5401_MODEL_MAX];
+static int model_count = 0;
+static pthread_mutex_t model_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static INT8U model_reg_sec[IRPS5401_MODEL_REG_COUNT];		//各寄存器所在的分区
+static pthread_once_t model_sec_once = PTHREAD_ONCE_INIT;
+
+static irps5401_model_cfg_t model_default = {
+	.silicon_version = 2,
+	.fw_rev = 0x10,
+	.conf_used = 1,
+	.user_used = 1,
+	.crc_error = 0,
+	.latency_us = 0,
+	.byte_us = 0,
+	.nvm_busy_us = 0,
+};
+
+static INT64U model_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (INT64U)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void model_sec_init(void)
+{
+	INT32U i, reg;
+
+	for(i = 0; i < sizeof(model_sec) / sizeof(model_sec[0]); i++)
+	{
+		for(reg = model_sec[i].start; reg <= model_sec[i].end; reg++)
+			model_reg_sec[reg] = model_sec[i].section;
+	}
+}
+
+void irps5401_model_default_set(const irps5401_model_cfg_t *cfg)
+{
+	pthread_mutex_lock(&model_list_mutex);
+	model_default = *cfg;
+	pthread_mutex_unlock(&model_list_mutex);
+}
+
+void irps5401_model_default_get(irps5401_model_cfg_t *cfg)
+{
+	pthread_mutex_lock(&model_list_mutex);
+	*cfg = model_default;
+	pthread_mutex_unlock(&model_list_mutex);
+}
+
+//剩余可写次数的位域：从bit0开始连续的1表示已经使用的image，user分区的低16位在0x5A，高16位在0x58
+static void model_left_update(irps5401_model_t *m)
+{
+	INT32U conf = (1u << m->conf_used) - 1;
+	INT32U user = (1u << m->user_used) - 1;
+
+	m->reg[MODEL_CONF_LEFT_REG] = conf & 0xFF;
+	m->reg[MODEL_CONF_LEFT_REG + 1] = (conf >> 8) & 0xFF;
+	m->reg[MODEL_USER_LEFT_REG0] = (user >> 16) & 0xFF;
+	m->reg[MODEL_USER_LEFT_REG0 + 1] = (user >> 24) & 0xFF;
+	m->reg[MODEL_USER_LEFT_REG1] = user & 0xFF;
+	m->reg[MODEL_USER_LEFT_REG1 + 1] = (user >> 8) & 0xFF;
+}
+
+//按cfg设置芯片的初始状态，不改变访问统计
+static void model_init(irps5401_model_t *m, const irps5401_model_cfg_t *cfg)
+{
+	INT32U i;
+
+	memset(m->reg, 0, sizeof(m->reg));
+	memset(m->conf_otp, 0, sizeof(m->conf_otp));
+	memset(m->user_otp, 0, sizeof(m->user_otp));
+	m->page = 0;
+	m->nvm_done_us = 0;
+	m->cfg = *cfg;
+	m->reg[MODEL_VERSION_REG] = m->cfg.fw_rev;
+	m->reg[MODEL_SILICON_VERSION_REG] = m->cfg.silicon_version;
+	m->reg[MODEL_NVM_CMD_REG_H] = MODEL_NVM_DONE;
+	m->conf_used = m->cfg.conf_used > IRPS5401_MODEL_CONF_MAX ? IRPS5401_MODEL_CONF_MAX : m->cfg.conf_used;
+	m->user_used = m->cfg.user_used > IRPS5401_MODEL_USER_MAX ? IRPS5401_MODEL_USER_MAX : m->cfg.user_used;
+	//出厂时已经编程的image内容与初始寄存器相同
+	for(i = 0; i < m->conf_used; i++)
+		memcpy(m->conf_otp[i], m->reg, IRPS5401_MODEL_REG_COUNT);
+	for(i = 0; i < m->user_used; i++)
+		memcpy(m->user_otp[i], m->reg, IRPS5401_MODEL_REG_COUNT);
+	model_left_update(m);
+}
+
+static irps5401_model_t *model_create(const char *i2c_dev, INT8U slave)
+{
+	irps5401_model_t *m;
+
+	m = calloc(1, sizeof(irps5401_model_t));
+	if(NULL == m)
+		return NULL;
+	snprintf(m->i2c_dev, sizeof(m->i2c_dev), "%s", i2c_dev);
+	m->slave = slave;
+	pthread_mutex_init(&m->mutex, NULL);
+	model_init(m, &model_default);
+	return m;
+}
+
+//按总线和地址找到芯片，第一次访问时按默认配置创建
+static irps5401_model_t *model_get(const char *i2c_dev, INT8U slave)
+{
+	irps5401_model_t *m = NULL;
+	int i;
+
+	if(NULL == i2c_dev)
+		return NULL;
+	pthread_once(&model_sec_once, model_sec_init);
+	pthread_mutex_lock(&model_list_mutex);
+	for(i = 0; i < model_count; i++)
+	{
+		if(models[i]->slave == slave && 0 == strcmp(models[i]->i2c_dev, i2c_dev))
+		{
+			m = models[i];
+			break;
+		}
+	}
+	if(NULL == m && model_count < IRPS5401_MODEL_MAX)
+	{
+		m = model_create(i2c_dev, slave);
+		if(NULL != m)
+			models[model_count++] = m;
+	}
+	pthread_mutex_unlock(&model_list_mutex);
+	return m;
+}
+
+static void model_nvm_exec(irps5401_model_t *m)
+{
+	INT8U cmd = m->reg[MODEL_NVM_CMD_REG];
+	INT8U image = m->reg[MODEL_NVM_CMD_REG_H] & MODEL_NVM_IMAGE_MASK;
+	bool unlocked = (m->reg[MODEL_PASSWD_REG] & MODEL_PASSWD_OK) != 0;
+	INT32U reg;
+
+	switch(cmd)
+	{
+	case MODEL_NVM_PROGRAM_CONF:
+		//只能按顺序编程下一个空的image，未解锁时命令完成但不编程
+		if(unlocked && image == m->conf_used && m->conf_used < IRPS5401_MODEL_CONF_MAX)
+		{
+			memcpy(m->conf_otp[image], m->reg, IRPS5401_MODEL_REG_COUNT);
+			m->conf_used++;
+		}
+		break;
+	case MODEL_NVM_PROGRAM_USER:
+		if(unlocked && image == m->user_used && m->user_used < IRPS5401_MODEL_USER_MAX)
+		{
+			memcpy(m->user_otp[image], m->reg, IRPS5401_MODEL_REG_COUNT);
+			m->user_used++;
+		}
+		break;
+	case MODEL_NVM_RELOAD_USER:
+		if(image < m->user_used)
+		{
+			for(reg = 0; reg < IRPS5401_MODEL_REG_COUNT; reg++)
+			{
+				if(MODEL_SEC_USER == model_reg_sec[reg])
+					m->reg[reg] = m->user_otp[image][reg];
+			}
+			m->reg[MODEL_NVRAM_IMAGE_REG] = m->cfg.crc_error ? MODEL_NVRAM_CRC_ERR : 0;
+		}
+		else
+		{
+			m->reg[MODEL_NVRAM_IMAGE_REG] = MODEL_NVRAM_CRC_ERR;
+		}
+		break;
+	default:
+		break;
+	}
+	model_left_update(m);
+	m->reg[MODEL_NVM_CMD_REG_H] = image;
+	m->nvm_done_us = model_now_us() + m->cfg.nvm_busy_us;
+	m->stat.nvm_count++;
+}
+
+static void model_reg_write(irps5401_model_t *m, INT32U reg, INT8U value)
+{
+	//只读寄存器
+	if(MODEL_NVRAM_IMAGE_REG == reg || MODEL_PASSWD_REG == reg || MODEL_SILICON_VERSION_REG == reg
+		|| (reg >= MODEL_CONF_LEFT_REG && reg <= MODEL_USER_LEFT_REG1 + 1))
+		return;
+	m->reg[reg] = value;
+	if((MODEL_TRIM_TRY_PWD_REG0 == reg || MODEL_TRIM_TRY_PWD_REG1 == reg)
+		&& MODEL_PASSWD0 == m->reg[MODEL_TRIM_TRY_PWD_REG0] && MODEL_PASSWD1 == m->reg[MODEL_TRIM_TRY_PWD_REG1])
+		m->reg[MODEL_PASSWD_REG] |= MODEL_PASSWD_OK;
+	//按字写NVM_CMD时高字节最后写入，写入后执行命令
+	if(MODEL_NVM_CMD_REG_H == reg)
+		model_nvm_exec(m);
+}
+
+static INT8U model_reg_read(irps5401_model_t *m, INT32U reg)
+{
+	if(MODEL_NVM_CMD_REG_H == reg)
+	{
+		if(model_now_us() >= m->nvm_done_us)
+			m->reg[reg] |= MODEL_NVM_DONE;
+		else
+			m->stat.busy_poll_count++;
+	}
+	return m->reg[reg];
+}
+
+//模拟传输时间，不持有芯片的锁
+static void model_delay(irps5401_model_t *m, size_t bytes)
+{
+	INT64U us = m->cfg.latency_us + (INT64U)m->cfg.byte_us * bytes;
+	struct timespec ts;
+
+	m->stat.bytes += bytes;
+	m->stat.bus_us += us;
+	if(0 == us)
+		return;
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+	while(0 != nanosleep(&ts, &ts) && EINTR == errno);
+}
+
+/*
+ * 写传输：第一个字节为当前page内的寄存器地址，之后的字节依次写入连续的寄存器；
+ * 写0xFF为设置page，page超出范围时芯片不应答。
+ */
+ssize_t irps5401_model_write(const char *i2c_dev, INT8U slave, const INT8U *data, size_t size)
+{
+	irps5401_model_t *m = model_get(i2c_dev, slave);
+	ssize_t ret = size;
+	size_t i;
+
+	if(NULL == m || NULL == data || size < 1)
+		return -1;
+	pthread_mutex_lock(&m->mutex);
+	m->stat.write_count++;
+	if(MODEL_PAGE_REG == data[0])
+	{
+		if(2 == size && data[1] <= MODEL_PAGE_MAX)
+		{
+			m->page = data[1];
+			m->stat.page_count++;
+		}
+		else
+		{
+			ret = -1;
+		}
+	}
+	else
+	{
+		for(i = 1; i < size && data[0] + i - 1 < MODEL_PAGE_REG; i++)
+			model_reg_write(m, m->page * MODEL_PAGE_SIZE + data[0] + i - 1, data[i]);
+	}
+	pthread_mutex_unlock(&m->mutex);
+	model_delay(m, size);
+	return ret;
+}
+
+//读传输：写一个字节的寄存器地址后连续读取rsize个寄存器，地址0xFF读到的是page
+int irps5401_model_writeread(const char *i2c_dev, INT8U slave, const INT8U *wdata, INT8U *rdata, size_t wsize, size_t rsize)
+{
+	irps5401_model_t *m = model_get(i2c_dev, slave);
+	size_t i;
+	INT32U addr;
+
+	if(NULL == m || NULL == wdata || NULL == rdata || 1 != wsize)
+		return -1;
+	pthread_mutex_lock(&m->mutex);
+	m->stat.read_count++;
+	for(i = 0; i < rsize; i++)
+	{
+		addr = wdata[0] + i;
+		if(MODEL_PAGE_REG == addr)
+			rdata[i] = m->page;
+		else if(addr < MODEL_PAGE_REG)
+			rdata[i] = model_reg_read(m, m->page * MODEL_PAGE_SIZE + addr);
+		else
+			rdata[i] = 0xFF;
+	}
+	pthread_mutex_unlock(&m->mutex);
+	model_delay(m, wsize + rsize);
+	return 0;
+}
+
+int irps5401_model_count(void)
+{
+	return model_count;
+}
+
+const char *irps5401_model_name(int index, INT8U *slave)
+{
+	if(index < 0 || index >= model_count)
+		return NULL;
+	if(NULL != slave)
+		*slave = models[index]->slave;
+	return models[index]->i2c_dev;
+}
+
+int irps5401_model_stat_get(int index, irps5401_model_stat_t *stat)
+{
+	if(index < 0 || index >= model_count || NULL == stat)
+		return -1;
+	pthread_mutex_lock(&models[index]->mutex);
+	*stat = models[index]->stat;
+	pthread_mutex_unlock(&models[index]->mutex);
+	return 0;
+}
+
+void irps5401_model_stat_clear(int index)
+{
+	if(index < 0 || index >= model_count)
+		return;
+	pthread_mutex_lock(&models[index]->mutex);
+	memset(&models[index]->stat, 0, sizeof(irps5401_model_stat_t));
+	pthread_mutex_unlock(&models[index]->mutex);
+}
+
+//按当前的默认配置恢复芯片的初始状态（相当于换一个新芯片），用于重复测试，访问统计保留
+void irps5401_model_reset(int index)
+{
+	irps5401_model_cfg_t cfg;
+
+	if(index < 0 || index >= model_count)
+		return;
+	irps5401_model_default_get(&cfg);
+	pthread_mutex_lock(&models[index]->mutex);
+	model_init(models[index], &cfg);
+	pthread_mutex_unlock(&models[index]->mutex);
+}
+
+//直接读取寄存器，不计入统计，reg为包含page的地址
+int irps5401_model_reg_get(int index, INT16U reg, INT8U *value)
+{
+	if(index < 0 || index >= model_count || reg >= IRPS5401_MODEL_REG_COUNT || NULL == value)
+		return -1;
+	pthread_mutex_lock(&models[index]->mutex);
+	*value = models[index]->reg[reg];
+	pthread_mutex_unlock(&models[index]->mutex);
+	return 0;
+}
+
+//直接修改寄存器，不计入统计，reg为包含page的地址，用于模拟芯片自己改变的位
+int irps5401_model_reg_set(int index, INT16U reg, INT8U value)
+{
+	if(index < 0 || index >= model_count || reg >= IRPS5401_MODEL_REG_COUNT)
+		return -1;
+	pthread_mutex_lock(&models[index]->mutex);
+	models[index]->reg[reg] = value;
+	pthread_mutex_unlock(&models[index]->mutex);
+	return 0;
+}
+
+int irps5401_model_otp_get(int index, INT8U *conf_used, INT8U *user_used)
+{
+	if(index < 0 || index >= model_count)
+		return -1;
+	pthread_mutex_lock(&models[index]->mutex);
+	if(NULL != conf_used)
+		*conf_used = models[index]->conf_used;
+	if(NULL != user_used)
+		*user_used = models[index]->user_used;
+	pthread_mutex_unlock(&models[index]->mutex);
+	return 0;
+}
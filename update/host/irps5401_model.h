@@ -0,0 +1,53 @@
+/*
+ * 进程内的IRPS5401芯片模型，host编译时i2c_master_write/i2c_writeread访问的就是该模型。
+ * 模型包括：page寄存器（0xFF）、0x0000-0x17FF寄存器、密码解锁、NVM_CMD命令（编程conf/user分区、重新加载user分区）
+ * 及其执行时间、conf/user剩余可写次数的位域、NVRAM_IMAGE的CRC错误标志、silicon版本，以及每次传输的延迟。
+ */
+#ifndef __IRPS5401_MODEL_H__
+#define __IRPS5401_MODEL_H__
+#include "Types.h"
+
+#define IRPS5401_MODEL_MAX				8				//最多模拟的芯片数量
+#define IRPS5401_MODEL_REG_COUNT		0x1800			//0x0000-0x17FF
+#define IRPS5401_MODEL_CONF_MAX			5				//与IRPS5401_CONF_WRITE_MAX_COUNT一致
+#define IRPS5401_MODEL_USER_MAX			26				//与IRPS5401_USER_WRITE_MAX_COUNT一致
+
+//芯片的初始状态和时序，第一次访问芯片时按irps5401_model_default_set设置的配置创建
+typedef struct
+{
+	INT8U	silicon_version;			//0x00FD
+	INT8U	fw_rev;						//0x002A的初始值
+	INT8U	conf_used;					//已经编程的conf image数量
+	INT8U	user_used;					//已经编程的user image数量
+	INT8U	crc_error;					//1：重新加载user image后NVRAM_IMAGE报告CRC错误
+	INT32U	latency_us;					//每次I2C传输的固定时间
+	INT32U	byte_us;					//每个字节的传输时间，100KHz约为90us
+	INT32U	nvm_busy_us;				//NVM命令的执行时间，执行期间NVM_CMD高字节的bit7为0
+}irps5401_model_cfg_t;
+
+//芯片的访问统计
+typedef struct
+{
+	INT32U	write_count;				//i2c_master_write次数
+	INT32U	read_count;					//i2c_writeread次数
+	INT32U	page_count;					//其中写page寄存器的次数
+	INT32U	nvm_count;					//NVM命令次数
+	INT32U	busy_poll_count;			//NVM命令执行期间读取状态的次数
+	INT64U	bytes;						//传输的字节数，包括寄存器地址
+	INT64U	bus_us;						//按latency_us、byte_us计算的传输时间
+}irps5401_model_stat_t;
+
+extern void irps5401_model_default_set(const irps5401_model_cfg_t *cfg);
+extern void irps5401_model_default_get(irps5401_model_cfg_t *cfg);
+extern ssize_t irps5401_model_write(const char *i2c_dev, INT8U slave, const INT8U *data, size_t size);
+extern int irps5401_model_writeread(const char *i2c_dev, INT8U slave, const INT8U *wdata, INT8U *rdata, size_t wsize, size_t rsize);
+extern int irps5401_model_count(void);
+extern const char *irps5401_model_name(int index, INT8U *slave);
+extern int irps5401_model_stat_get(int index, irps5401_model_stat_t *stat);
+extern void irps5401_model_stat_clear(int index);
+extern void irps5401_model_reset(int index);
+extern int irps5401_model_reg_get(int index, INT16U reg, INT8U *value);
+extern int irps5401_model_reg_set(int index, INT16U reg, INT8U value);
+extern int irps5401_model_otp_get(int index, INT8U *conf_used, INT8U *user_used);
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * AMI libi2c.h的替代，host上的实现在host_platform.c中，访问的是irps5401_model中的芯片模型。
+ */
+#ifndef __LIBI2C_H__
+#define __LIBI2C_H__
+#include "Types.h"
+
+//返回写入的字节数，失败返回-1
+extern ssize_t i2c_master_write(char *i2c_dev, INT8U slave, INT8U *data, size_t size);
+//先写wsize字节再读rsize字节，成功返回0，失败返回-1
+extern int i2c_writeread(char *i2c_dev, INT8U slave, INT8U *wdata, INT8U *rdata, size_t wsize, size_t rsize);
+
+#endif
@@ -0,0 +1,398 @@
+/*
+ * 升级流程的性能测试：用irps5401_model模拟指定速率的I2C总线，多次调用PDK_PowerChipUpdate升级同一个芯片，
+ * 按阶段统计时间、传输次数、page切换次数和字节数，并可以与保存的基线比较，传输数量超过基线时返回失败。见README。
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "Types.h"
+#include "Debug.h"
+#include "IPMIDefs.h"
+#include "PDKPowerChip.h"
+#include "irps5401_model.h"
+
+//与PDKPowerChip.c中的IRPSFW_IMG_FILE、IRPSFW_IMG_USED_FILE一致，编译时使用相同的-DIRPSFW_IMG_DIR
+#ifndef IRPSFW_IMG_DIR
+#define IRPSFW_IMG_DIR					"/var"
+#endif
+#define BENCH_IMG_FILE					IRPSFW_IMG_DIR "/powerChip.bin"
+#define BENCH_IMG_USED_FILE				IRPSFW_IMG_DIR "/powerChip.bin_used%d.bin"
+
+#define BENCH_ITERATIONS				3
+#define BENCH_BUS_KHZ					100
+#define BENCH_XFER_OVERHEAD_US			20				//驱动每次传输的固定开销
+#define BENCH_BITS_PER_BYTE				9				//8位数据加ACK
+#define BENCH_MASK_DEFAULT				(POWER_CHIP_SECTION_CONF | POWER_CHIP_SECTION_USER)
+#define BENCH_STAGED_WAIT_MS			5000
+#define BENCH_LINE_LEN					128
+
+#define PHASE_COUNT						POWER_CHIP_PHASE_DONE
+
+static const char *phase_names[PHASE_COUNT] = {
+	"preflight", "conf_write", "user_write", "commit", "verify_prepare", "verify_read", "verify_compare", "finish",
+};
+
+//一个阶段的累计值
+typedef struct
+{
+	double	seconds;
+	double	wait_seconds;			//其中状态机要求的等待时间
+	INT64U	transactions;			//写和读的次数之和
+	INT64U	writes;
+	INT64U	reads;
+	INT64U	pages;
+	INT64U	nvm;
+	INT64U	bytes;
+	INT64U	bus_us;
+}bench_phase_t;
+
+static bench_phase_t g_phase_sum[PHASE_COUNT];
+static power_chip_phase g_phase = POWER_CHIP_PHASE_DONE;	//当前阶段，DONE表示不在升级中
+static irps5401_model_stat_t g_mark;						//当前阶段开始时的访问统计
+static double g_mark_time;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//所有芯片统计的和，只有被升级的芯片会被访问
+static void stat_sum(irps5401_model_stat_t *sum)
+{
+	irps5401_model_stat_t stat;
+	int i;
+
+	memset(sum, 0, sizeof(irps5401_model_stat_t));
+	for(i = 0; i < irps5401_model_count(); i++)
+	{
+		irps5401_model_stat_get(i, &stat);
+		sum->write_count += stat.write_count;
+		sum->read_count += stat.read_count;
+		sum->page_count += stat.page_count;
+		sum->nvm_count += stat.nvm_count;
+		sum->bytes += stat.bytes;
+		sum->bus_us += stat.bus_us;
+	}
+}
+
+//结束当前阶段，把阶段开始以来的时间和访问计入该阶段，并开始phase；wait为刚结束的等待，计入phase
+static void phase_switch(power_chip_phase phase, double wait)
+{
+	irps5401_model_stat_t stat;
+	bench_phase_t *p;
+	double t = now() - wait;
+
+	stat_sum(&stat);
+	if(g_phase < PHASE_COUNT)
+	{
+		p = &g_phase_sum[g_phase];
+		p->seconds += t - g_mark_time;
+		p->writes += stat.write_count - g_mark.write_count;
+		p->reads += stat.read_count - g_mark.read_count;
+		p->transactions += stat.write_count - g_mark.write_count + stat.read_count - g_mark.read_count;
+		p->pages += stat.page_count - g_mark.page_count;
+		p->nvm += stat.nvm_count - g_mark.nvm_count;
+		p->bytes += stat.bytes - g_mark.bytes;
+		p->bus_us += stat.bus_us - g_mark.bus_us;
+	}
+	g_phase = phase;
+	g_mark = stat;
+	g_mark_time = t;
+}
+
+static void phase_hook(INT8U Devinst, power_chip_phase phase, INT32U wait_us)
+{
+	(void)Devinst;
+	//等待是为下一步做准备（如user分区编程后等待稳定再校验），与其实际时间一起计入phase
+	if(phase != g_phase)
+		phase_switch(phase, wait_us / 1e6);
+	if(phase < PHASE_COUNT)
+		g_phase_sum[phase].wait_seconds += wait_us / 1e6;
+}
+
+static int file_copy(const char *src, const char *dst)
+{
+	char buf[4096];
+	FILE *in, *out;
+	size_t n;
+	int ret = 0;
+
+	in = fopen(src, "rb");
+	if(NULL == in)
+		return -1;
+	out = fopen(dst, "wb");
+	if(NULL == out)
+	{
+		fclose(in);
+		return -1;
+	}
+	while(0 < (n = fread(buf, 1, sizeof(buf), in)))
+	{
+		if(n != fwrite(buf, 1, n, out))
+		{
+			ret = -1;
+			break;
+		}
+	}
+	fclose(in);
+	if(0 != fclose(out))
+		ret = -1;
+	return ret;
+}
+
+//与上传镜像后的流程相同：镜像放到上传目录，每个芯片使用一份拷贝，等待后台预校验结束
+static int image_stage(const char *bin, INT8U Devinst)
+{
+	power_chip_staged_img_t staged;
+	char used_file[64];
+	int i;
+
+	snprintf(used_file, sizeof(used_file), BENCH_IMG_USED_FILE, Devinst);
+	if(0 != file_copy(bin, BENCH_IMG_FILE) || 0 != file_copy(bin, used_file))
+	{
+		fprintf(stderr, "Copy %s to %s fail.\n", bin, IRPSFW_IMG_DIR);
+		return -1;
+	}
+	for(i = 0; i < BENCH_STAGED_WAIT_MS; i++)
+	{
+		if(0 == PDK_PowerChipStagedImgGet(&staged) && POWER_FW_STAGED_IMG_VERIFYING != staged.state
+			&& POWER_FW_STAGED_IMG_NONE != staged.state)
+			return 0;
+		usleep(1000);
+	}
+	return 0;
+}
+
+static void report(int iterations)
+{
+	bench_phase_t total;
+	bench_phase_t *p;
+	int i;
+
+	memset(&total, 0, sizeof(total));
+	printf("per update, average of %d updates:\n", iterations);
+	printf("%-16s %10s %10s %10s %8s %8s %8s %7s %5s %9s\n",
+		"phase", "wall_ms", "wait_ms", "bus_ms", "xfers", "writes", "reads", "pages", "nvm", "bytes");
+	for(i = 0; i <= PHASE_COUNT; i++)
+	{
+		p = i < PHASE_COUNT ? &g_phase_sum[i] : &total;
+		printf("%-16s %10.3f %10.3f %10.3f %8.0f %8.0f %8.0f %7.0f %5.0f %9.0f\n", i < PHASE_COUNT ? phase_names[i] : "total",
+			p->seconds * 1000 / iterations, p->wait_seconds * 1000 / iterations, p->bus_us / 1000.0 / iterations, (double)p->transactions / iterations,
+			(double)p->writes / iterations, (double)p->reads / iterations, (double)p->pages / iterations,
+			(double)p->nvm / iterations, (double)p->bytes / iterations);
+		if(i < PHASE_COUNT)
+		{
+			total.seconds += p->seconds;
+			total.wait_seconds += p->wait_seconds;
+			total.transactions += p->transactions;
+			total.writes += p->writes;
+			total.reads += p->reads;
+			total.pages += p->pages;
+			total.nvm += p->nvm;
+			total.bytes += p->bytes;
+			total.bus_us += p->bus_us;
+		}
+	}
+}
+
+//基线每行一个阶段："阶段 传输次数 page切换次数 字节数"，均为每次升级的值
+static int baseline_write(const char *path, const char *bin, INT32U mask, int iterations)
+{
+	FILE *fp;
+	int i;
+
+	fp = fopen(path, "w");
+	if(NULL == fp)
+		return -1;
+	fprintf(fp, "#per update of %s, mask 0x%x\n", bin, mask);
+	fprintf(fp, "#phase transactions pages bytes\n");
+	for(i = 0; i < PHASE_COUNT; i++)
+	{
+		fprintf(fp, "%s %llu %llu %llu\n", phase_names[i], (unsigned long long)(g_phase_sum[i].transactions / iterations),
+			(unsigned long long)(g_phase_sum[i].pages / iterations), (unsigned long long)(g_phase_sum[i].bytes / iterations));
+	}
+	return fclose(fp);
+}
+
+static int over(const char *phase, const char *name, INT64U value, unsigned long long base, int tolerance)
+{
+	if(value * 100 <= base * (100 + tolerance))
+		return 0;
+	printf("REGRESSION %s %s: %llu, baseline %llu\n", phase, name, (unsigned long long)value, base);
+	return 1;
+}
+
+//返回超过基线的项数，-1为基线无法读取
+static int baseline_check(const char *path, int iterations, int tolerance)
+{
+	char line[BENCH_LINE_LEN], name[BENCH_LINE_LEN];
+	unsigned long long xfers, pages, bytes;
+	FILE *fp;
+	int i, fail = 0;
+
+	fp = fopen(path, "r");
+	if(NULL == fp)
+		return -1;
+	while(NULL != fgets(line, sizeof(line), fp))
+	{
+		if('#' == line[0] || 4 != sscanf(line, "%127s %llu %llu %llu", name, &xfers, &pages, &bytes))
+			continue;
+		for(i = 0; i < PHASE_COUNT && 0 != strcmp(name, phase_names[i]); i++);
+		if(i == PHASE_COUNT)
+		{
+			fprintf(stderr, "Unknown phase %s in baseline.\n", name);
+			continue;
+		}
+		fail += over(name, "transactions", g_phase_sum[i].transactions / iterations, xfers, tolerance);
+		fail += over(name, "pages", g_phase_sum[i].pages / iterations, pages, tolerance);
+		fail += over(name, "bytes", g_phase_sum[i].bytes / iterations, bytes, tolerance);
+	}
+	fclose(fp);
+	return fail;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-d devinst] [-i iterations] [-m mask] [-k bus_khz] [-l overhead_us] [-t nvm_busy_us]\n", prog);
+	printf("          [-y hold_max_us] [-v fw_rev] [-w baseline] [-c baseline] [-T tolerance] [-V] bin_file\n");
+	printf("  -d devinst      chip to update, default is 0\n");
+	printf("  -i iterations   updates to run, the chip is reset to the initial state before each one, default is %d\n", BENCH_ITERATIONS);
+	printf("  -m mask         sections to update, default is 0x%x (conf and user)\n", BENCH_MASK_DEFAULT);
+	printf("  -k bus_khz      i2c clock, default is %d, a byte takes %d clocks\n", BENCH_BUS_KHZ, BENCH_BITS_PER_BYTE);
+	printf("  -l overhead_us  driver time of every transfer besides the address byte, default is %d\n", BENCH_XFER_OVERHEAD_US);
+	printf("  -t nvm_busy_us  time of every nvm command, default is 0\n");
+	printf("  -y hold_max_us  see PDK_PowerChipBusHoldMaxSet, default is the built-in value, or 0 with -w/-c\n");
+	printf("  -v fw_rev       initial firmware revision of the chip, default is 0x10\n");
+	printf("  -w baseline     write transactions, page switches and bytes of every phase to baseline\n");
+	printf("  -c baseline     fail if any of them is greater than baseline\n");
+	printf("  -T tolerance    percent allowed above baseline, default is 0\n");
+	printf("  -V              print logs of the update\n");
+	printf("Image is copied to %s before updating, PDK_PowerChipUpdate is called in this thread.\n", IRPSFW_IMG_DIR);
+}
+
+int main(int argc, char *argv[])
+{
+	irps5401_model_cfg_t cfg;
+	char *write_path = NULL, *check_path = NULL;
+	INT32U mask = BENCH_MASK_DEFAULT, khz = BENCH_BUS_KHZ, overhead = BENCH_XFER_OVERHEAD_US;
+	int opt, i, iterations = BENCH_ITERATIONS, tolerance = 0, hold_max = -1, ret;
+	INT8U Devinst = 0;
+
+	host_log_level = HOST_LOG_NONE;
+	irps5401_model_default_get(&cfg);
+	while(-1 != (opt = getopt(argc, argv, "d:i:m:k:l:t:y:v:w:c:T:Vh")))
+	{
+		switch(opt)
+		{
+		case 'd':
+			Devinst = atoi(optarg);
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 'm':
+			mask = strtoul(optarg, NULL, 0);
+			break;
+		case 'k':
+			khz = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			overhead = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			cfg.nvm_busy_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'y':
+			hold_max = atoi(optarg);
+			break;
+		case 'v':
+			cfg.fw_rev = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			write_path = optarg;
+			break;
+		case 'c':
+			check_path = optarg;
+			break;
+		case 'T':
+			tolerance = atoi(optarg);
+			break;
+		case 'V':
+			host_log_level = HOST_LOG_INFO;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	if(optind + 1 != argc || iterations <= 0 || 0 == khz || Devinst >= POWER_CHIP_COUNT_MAX)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+
+	//每个字节BENCH_BITS_PER_BYTE个时钟，每次传输另有从机地址字节和驱动开销
+	cfg.byte_us = BENCH_BITS_PER_BYTE * 1000 / khz;
+	cfg.latency_us = overhead + cfg.byte_us;
+	irps5401_model_default_set(&cfg);
+	if(0 != PDK_PowerChipInit())
+	{
+		fprintf(stderr, "PDK_PowerChipInit fail.\n");
+		return -1;
+	}
+	//让出总线的次数取决于时间，写入或比较基线时默认不让出，各阶段的传输数量只取决于镜像
+	if(hold_max < 0 && (NULL != write_path || NULL != check_path))
+		hold_max = 0;
+	if(hold_max >= 0)
+		PDK_PowerChipBusHoldMaxSet(hold_max);
+	if(0 != image_stage(argv[optind], Devinst))
+		return -1;
+	PDK_PowerChipPhaseHookSet(phase_hook);
+
+	printf("bus %u KHz, %u us per byte, %u us per transfer, nvm busy %u us\n", khz, cfg.byte_us, cfg.latency_us, cfg.nvm_busy_us);
+	for(i = 0; i < iterations; i++)
+	{
+		//每次升级都从相同的芯片状态开始，OTP次数不会耗尽，传输数量可以与基线比较
+		for(ret = 0; ret < irps5401_model_count(); ret++)
+			irps5401_model_reset(ret);
+		//镜像读取和签名校验发生在状态机之前，计入preflight
+		phase_switch(POWER_CHIP_PHASE_PREFLIGHT, 0);
+		ret = PDK_PowerChipUpdate(Devinst, mask);
+		phase_switch(POWER_CHIP_PHASE_DONE, 0);
+		if(CC_NORMAL != ret)
+		{
+			fprintf(stderr, "Update %d fail, completion code 0x%x.\n", i, ret);
+			return 1;
+		}
+	}
+	PDK_PowerChipPhaseHookSet(NULL);
+	report(iterations);
+
+	if(NULL != write_path)
+	{
+		if(0 != baseline_write(write_path, argv[optind], mask, iterations))
+		{
+			fprintf(stderr, "Write baseline %s fail.\n", write_path);
+			return -1;
+		}
+		printf("baseline written to %s\n", write_path);
+	}
+	if(NULL != check_path)
+	{
+		ret = baseline_check(check_path, iterations, tolerance);
+		if(ret < 0)
+		{
+			fprintf(stderr, "Read baseline %s fail.\n", check_path);
+			return -1;
+		}
+		printf("%s baseline %s\n", ret ? "REGRESSION against" : "within", check_path);
+		return ret ? 1 : 0;
+	}
+	return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * 在host上用irps5401_model中的芯片模型运行PDKPowerChip.c的升级流程，见README。
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "Types.h"
+#include "Debug.h"
+#include "IPMIDefs.h"
+#include "PDKPowerChip.h"
+#include "irps5401_model.h"
+
+#define PC_HOST_MASK_DEFAULT		(POWER_CHIP_SECTION_CONF | POWER_CHIP_SECTION_USER)
+
+static const char *status_names[] = {"idle", "updating", "verify", "success", "fail", "cancel"};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void buf_release(INT8U *buf, void *ctx)
+{
+	(void)ctx;
+	free(buf);
+}
+
+static INT8U *file_load(const char *path, INT32U *len)
+{
+	struct stat st;
+	INT8U *buf;
+	FILE *fp;
+
+	if(0 != stat(path, &st) || 0 == st.st_size)
+		return NULL;
+	buf = malloc(st.st_size);
+	fp = fopen(path, "rb");
+	if(NULL == buf || NULL == fp || 1 != fread(buf, st.st_size, 1, fp))
+	{
+		free(buf);
+		buf = NULL;
+	}
+	if(NULL != fp)
+		fclose(fp);
+	*len = st.st_size;
+	return buf;
+}
+
+//把txt中每个寄存器掩码之外的位取反，模拟芯片自己改变的、不属于固件的位（如状态位），掩码为FF的寄存器不变
+static int mask_drift(const char *path)
+{
+	char line[128];
+	unsigned int reg, value, mask;
+	INT8U cur;
+	FILE *fp;
+	int i;
+
+	fp = fopen(path, "r");
+	if(NULL == fp)
+		return -1;
+	while(NULL != fgets(line, sizeof(line), fp))
+	{
+		if(3 != sscanf(line, "%x %x %x", &reg, &value, &mask) || 0xFF == mask)
+			continue;
+		for(i = 0; i < irps5401_model_count(); i++)
+		{
+			if(0 == irps5401_model_reg_get(i, reg, &cur))
+				irps5401_model_reg_set(i, reg, cur ^ (~mask & 0xFF));
+		}
+	}
+	fclose(fp);
+	return 0;
+}
+
+//升级流程结束时释放镜像，每个任务使用自己的副本
+static INT8U *buf_dup(const INT8U *buf, INT32U len)
+{
+	INT8U *copy = malloc(len);
+
+	if(NULL != copy)
+		memcpy(copy, buf, len);
+	return copy;
+}
+
+static void report(INT8U *devinst, int count)
+{
+	power_chip_update_state_t state;
+	power_chip_inventory_t inv;
+	irps5401_model_stat_t stat;
+	INT8U slave, conf_used, user_used;
+	const char *name;
+	int i;
+
+	for(i = 0; i < count; i++)
+	{
+		PDK_PowerChipUpdateStateGet(devinst[i], &state);
+		printf("chip %d: %s, error 0x%x, fw 0x%x", devinst[i],
+			state.status < sizeof(status_names) / sizeof(status_names[0]) ? status_names[state.status] : "unknown", state.error_code, state.FwRev);
+		if(0 == PDK_PowerChipInventoryGet(devinst[i], &inv) && inv.valid)
+			printf(", inventory fw 0x%x silicon %d conf left %d user left %d", inv.FwRev, inv.silicon_version, inv.conf_write_left, inv.user_write_left);
+		printf("\n");
+	}
+	printf("%-12s %4s %8s %8s %8s %6s %6s %10s %12s %6s %6s\n",
+		"bus", "addr", "writes", "reads", "pages", "nvm", "busy", "bytes", "bus_ms", "conf", "user");
+	for(i = 0; i < irps5401_model_count(); i++)
+	{
+		name = irps5401_model_name(i, &slave);
+		irps5401_model_stat_get(i, &stat);
+		irps5401_model_otp_get(i, &conf_used, &user_used);
+		printf("%-12s 0x%02x %8u %8u %8u %6u %6u %10llu %12.3f %6u %6u\n", name, slave,
+			stat.write_count, stat.read_count, stat.page_count, stat.nvm_count, stat.busy_poll_count,
+			(unsigned long long)stat.bytes, stat.bus_us / 1000.0, conf_used, user_used);
+	}
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-d devinsts] [-m mask] [-l latency_us] [-b byte_us] [-t nvm_busy_us]\n", prog);
+	printf("          [-s silicon] [-v fw_rev] [-c conf_used] [-u user_used] [-p base_bin] [-x base_txt]\n");
+	printf("          [-e] [-q|-V] bin_file\n");
+	printf("  -d devinsts     chips to update, e.g. 0 or 0,1,2, default is 0, several chips use the scheduler\n");
+	printf("  -m mask         sections to update, default is 0x%x (conf and user)\n", PC_HOST_MASK_DEFAULT);
+	printf("  -l latency_us   fixed time of every i2c transfer, default is 0\n");
+	printf("  -b byte_us      time of every byte, about 90 at 100KHz, default is 0\n");
+	printf("  -t nvm_busy_us  time of every nvm command, default is 0\n");
+	printf("  -s silicon      silicon version of the chips, default is 2\n");
+	printf("  -v fw_rev       initial firmware revision of the chips, default is 0x10\n");
+	printf("  -c conf_used    programmed conf images, default is 1\n");
+	printf("  -u user_used    programmed user images, default is 1\n");
+	printf("  -p base_bin     update the chips with base_bin first, e.g. the baseline of a delta image\n");
+	printf("  -x base_txt     then invert the bits outside the mask of every register in base_txt\n");
+	printf("  -e              user image reports crc error after reload\n");
+	printf("  -q / -V         no log / info log, default prints warnings\n");
+}
+
+int main(int argc, char *argv[])
+{
+	power_chip_buf_req_t jobs[POWER_CHIP_COUNT_MAX];
+	INT8U devinst[POWER_CHIP_COUNT_MAX];
+	irps5401_model_cfg_t cfg;
+	INT32U mask = PC_HOST_MASK_DEFAULT, len = 0;
+	int opt, i, count = 0, ret;
+	char *dev_list = "0", *base = NULL, *drift = NULL, *p;
+	INT8U *buf, *base_buf = NULL;
+	INT32U base_len = 0;
+	double t;
+
+	irps5401_model_default_get(&cfg);
+	while(-1 != (opt = getopt(argc, argv, "d:m:l:b:t:s:v:c:u:p:x:eqVh")))
+	{
+		switch(opt)
+		{
+		case 'd':
+			dev_list = optarg;
+			break;
+		case 'm':
+			mask = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			cfg.latency_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			cfg.byte_us = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			cfg.nvm_busy_us = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			cfg.silicon_version = strtoul(optarg, NULL, 0);
+			break;
+		case 'v':
+			cfg.fw_rev = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			cfg.conf_used = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			cfg.user_used = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			base = optarg;
+			break;
+		case 'x':
+			drift = optarg;
+			break;
+		case 'e':
+			cfg.crc_error = 1;
+			break;
+		case 'q':
+			host_log_level = HOST_LOG_NONE;
+			break;
+		case 'V':
+			host_log_level = HOST_LOG_INFO;
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	if(optind + 1 != argc)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+	for(p = strtok(dev_list, ","); NULL != p; p = strtok(NULL, ","))
+	{
+		if(count >= POWER_CHIP_COUNT_MAX || atoi(p) < 0 || atoi(p) >= POWER_CHIP_COUNT_MAX)
+		{
+			fprintf(stderr, "Illegal devinst list.\n");
+			return -1;
+		}
+		devinst[count++] = atoi(p);
+	}
+	if(0 == count)
+	{
+		usage(argv[0]);
+		return -1;
+	}
+	buf = file_load(argv[optind], &len);
+	if(NULL == buf)
+	{
+		fprintf(stderr, "Read %s fail.\n", argv[optind]);
+		return -1;
+	}
+	if(NULL != base && NULL == (base_buf = file_load(base, &base_len)))
+	{
+		fprintf(stderr, "Read %s fail.\n", base);
+		free(buf);
+		return -1;
+	}
+
+	//芯片在PDK_PowerChipInit读取版本时按该配置创建
+	irps5401_model_default_set(&cfg);
+	if(0 != PDK_PowerChipInit())
+	{
+		fprintf(stderr, "PDK_PowerChipInit fail.\n");
+		free(buf);
+		free(base_buf);
+		return -1;
+	}
+	//芯片的寄存器先升级为基线，不计入统计和耗时
+	for(i = 0; NULL != base_buf && i < count; i++)
+	{
+		ret = PDK_PowerChipUpdateFromBuf(devinst[i], mask, buf_dup(base_buf, base_len), base_len, buf_release, NULL);
+		if(CC_NORMAL != ret)
+		{
+			fprintf(stderr, "Update chip %d with %s fail, completion code 0x%x.\n", devinst[i], base, ret);
+			free(buf);
+			free(base_buf);
+			return -1;
+		}
+	}
+	free(base_buf);
+	if(NULL != drift && 0 != mask_drift(drift))
+	{
+		fprintf(stderr, "Read %s fail.\n", drift);
+		free(buf);
+		return -1;
+	}
+	for(i = 0; i < irps5401_model_count(); i++)
+		irps5401_model_stat_clear(i);
+
+	t = now();
+	if(1 == count)
+	{
+		ret = PDK_PowerChipUpdateFromBuf(devinst[0], mask, buf_dup(buf, len), len, buf_release, NULL);
+	}
+	else
+	{
+		memset(jobs, 0, sizeof(jobs));
+		for(i = 0; i < count; i++)
+		{
+			jobs[i].Devinst = devinst[i];
+			jobs[i].mask = mask;
+			jobs[i].buf = buf_dup(buf, len);
+			jobs[i].len = len;
+			jobs[i].release = buf_release;
+		}
+		ret = PDK_PowerChipSchedUpdate(jobs, count);
+	}
+	t = now() - t;
+
+	printf("update %s, completion code 0x%x, %.3f s\n", CC_NORMAL == ret ? "success" : "fail", ret, t);
+	report(devinst, count);
+	free(buf);
+	return CC_NORMAL == ret ? 0 : 1;
+}